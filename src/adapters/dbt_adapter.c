@@ -0,0 +1,136 @@
+#include <dlfcn.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../dbt.h"
+
+
+/* Definitions */
+#define DBT_ADAPTER_MAX_PLUGINS 8
+
+
+/* Loaded plugins (failed loads are cached too, so a missing backend is only searched once) */
+static struct {
+	char type[32];
+	void *handle;
+	const struct dbt_adapter_plugin *plugin;
+} adapter_plugins[DBT_ADAPTER_MAX_PLUGINS];
+static size_t adapter_plugin_count = 0;
+
+
+/* Helper functions */
+static void adapter_plugin_dir(char *dir, size_t dir_size) {
+	/* DBT_ADAPTER_PATH, otherwise 'adapters' next to the executable */
+	const char *env_dir = getenv("DBT_ADAPTER_PATH");
+	if (env_dir) {
+		snprintf(dir, dir_size, "%s", env_dir);
+		return;
+	}
+
+	char exe_path[4096];
+	ssize_t exe_len = readlink("/proc/self/exe", exe_path, sizeof(exe_path) - 1);
+	if (exe_len <= 0) {
+		snprintf(dir, dir_size, "adapters");
+		return;
+	}
+
+	exe_path[exe_len] = 0;
+	snprintf(dir, dir_size, "%s/adapters", dirname(exe_path));
+}
+
+static const struct dbt_adapter_plugin *adapter_plugin_load(const char *type) {
+	/* Reuse earlier load */
+	for (size_t i=0; i < adapter_plugin_count; i++) {
+		if (!strcmp(adapter_plugins[i].type, type)) return adapter_plugins[i].plugin;
+	}
+
+
+	/* Type becomes part of a file name, only plain identifiers are accepted */
+	size_t type_len = strlen(type);
+	if (!type_len || type_len >= sizeof(adapter_plugins[0].type) || strspn(type, "abcdefghijklmnopqrstuvwxyz0123456789_") != type_len) return 0;
+	else if (adapter_plugin_count >= DBT_ADAPTER_MAX_PLUGINS) return 0;
+
+
+	/* Open shared object on first use of this server type */
+	char dir[4096], path[4200];
+	adapter_plugin_dir(dir, sizeof(dir));
+	snprintf(path, sizeof(path), "%s/dbt_adapter_%s.so", dir, type);
+
+	void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	const struct dbt_adapter_plugin *plugin = handle ? (const struct dbt_adapter_plugin *)dlsym(handle, "dbt_adapter_plugin") : 0;
+
+
+	/* Reject plugins built against another ABI */
+	if (plugin && (plugin->abi_version != DBT_ADAPTER_ABI_VERSION || plugin->adapter_size != sizeof(struct dbt_adapter) || !plugin->init || strcmp(plugin->type, type))) plugin = 0;
+	if (!plugin && handle) {
+		dlclose(handle);
+		handle = 0;
+	}
+
+
+	/* Remember outcome */
+	strcpy(adapter_plugins[adapter_plugin_count].type, type);
+	adapter_plugins[adapter_plugin_count].handle = handle;
+	adapter_plugins[adapter_plugin_count].plugin = plugin;
+	adapter_plugin_count++;
+
+
+	return plugin;
+}
+
+
+
+
+int dbt_adapter_init(json_t *server_info, struct dbt_adapter *adapter) {
+	/* Check input */
+	if (!server_info || !adapter) return 1;
+
+
+	/* Replayed sessions answer from the trace instead of a server */
+	if (dbt_trace_replaying()) return dbt_trace_replay_init(server_info, adapter);
+
+
+	/* Load server type */
+	const char *server_type = json_string_value(json_object_get(server_info, "type"));
+	if (!server_type) return 1;
+
+
+	/* Init adapter for server (backend is loaded on first use, e.g. dbt_adapter_psql.so) */
+	memset(adapter, 0, sizeof(*adapter));
+	const struct dbt_adapter_plugin *plugin = adapter_plugin_load(server_type);
+	if (!plugin || plugin->init(server_info, adapter)) return 1;
+
+
+	/* Record traffic when a trace is being recorded */
+	dbt_trace_wrap(adapter);
+
+
+	return 0;
+}
+
+
+void dbt_adapter_close(struct dbt_adapter *adapter) {
+	/* Check input */
+	if (!adapter || !adapter->close_connection) return;
+
+
+	/* Close catalog connections */
+	adapter->close_connection(adapter->db_conn_handle, adapter);
+	adapter->close_connection(adapter->conn_handle, adapter);
+	adapter->db_conn_handle = 0;
+	adapter->conn_handle = 0;
+}
+
+
+void dbt_adapter_unload(void) {
+	/* Unload plugins (every adapter must be closed before) */
+	for (size_t i=0; i < adapter_plugin_count; i++) {
+		if (adapter_plugins[i].handle) dlclose(adapter_plugins[i].handle);
+	}
+
+	memset(adapter_plugins, 0, sizeof(adapter_plugins));
+	adapter_plugin_count = 0;
+}
@@ -1,9 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <libpq-fe.h>
 
 #include "../dbt.h"
 
 
-static json_t *load_database_list(struct dbt_adapter *adapter) {
+/* Helper functions */
+static json_t *result_to_json(PGresult *res) {
+	/* Prepare result */
+	json_t *result = json_object();
+
+
+	/* Add columns to result */
+	int cols = PQnfields(res);
+	json_t *column_list = json_array();
+	for (int i=0; i < cols; i++) {
+		json_array_append_new(column_list, json_string(PQfname(res, i)));
+	}
+	json_object_set_new(result, "columns", column_list);
+
+
+	/* Add rows to result */
+	int rows = PQntuples(res);
+	json_t *row_list = json_array();
+	for (int i=0; i < rows; i++) {
+		json_t *row_values = json_array();
+		for (int j=0; j < cols; j++) {
+			json_array_append_new(row_values, PQgetisnull(res, i, j) ? json_null() : json_string(PQgetvalue(res, i, j)));
+		}
+		json_array_append_new(row_list, row_values);
+	}
+	json_object_set_new(result, "rows", row_list);
+
+
+	return result;
+}
+static int result_to_names(PGresult *res, struct dbt_name_list *list, struct dbt_strings *strings) {
+	/* Intern first column of every row */
+	list->count = 0;
+	int row_count = PQntuples(res);
+	for (int i=0; i < row_count; i++) {
+		uint32_t name = dbt_strings_intern(strings, PQgetvalue(res, i, 0), PQgetlength(res, i, 0));
+		if (dbt_catalog_names_append(list, name)) return 1;
+	}
+
+	return 0;
+}
+static json_t *error_to_json(const char *message) {
+	json_t *result = json_object();
+	json_object_set_new(result, "error", json_string(message ? message : "unknown error"));
+
+	return result;
+}
+
+
+/* Change feed state (one dedicated connection per feed) */
+struct psql_change_feed {
+	PGconn *conn;
+	int poll_mode;
+
+
+	/* Poll mode round in flight (1 schema list, 2 tables of pending_schema), answers are read without blocking */
+	int poll_step;
+	char *pending_schema;
+	uint64_t pending_fingerprint;
+	PGresult *pending_result;
+
+
+	/* Poll mode snapshot: relation names sorted bytewise with fingerprints */
+	char *schema;
+	char **names;
+	uint64_t *fingerprints;
+	size_t count;
+	uint64_t schema_fingerprint;
+	int has_snapshot;
+};
+
+static uint64_t fingerprint_row(PGresult *res, int row, int first_col) {
+	/* FNV-1a (64 bit) over remaining columns */
+	uint64_t hash = 0xcbf29ce484222325ull;
+	int cols = PQnfields(res);
+	for (int j=first_col; j < cols; j++) {
+		const char *value = PQgetvalue(res, row, j);
+		for (int i=0; value[i]; i++) {
+			hash ^= (unsigned char)value[i];
+			hash *= 0x100000001b3ull;
+		}
+		hash ^= '|';
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+static void feed_clear_snapshot(struct psql_change_feed *feed) {
+	for (size_t i=0; i < feed->count; i++) free(feed->names[i]);
+	free(feed->names);
+	free(feed->fingerprints);
+	free(feed->schema);
+	feed->names = 0;
+	feed->fingerprints = 0;
+	feed->schema = 0;
+	feed->count = 0;
+	feed->has_snapshot = 0;
+}
+static size_t feed_add_change(struct dbt_catalog_change *changes, size_t count, size_t max, char op, const char *schema, const char *table) {
+	if (count >= max) return count;
+
+	changes[count].op = op;
+	snprintf(changes[count].schema, sizeof(changes[count].schema), "%s", schema ? schema : "");
+	snprintf(changes[count].table, sizeof(changes[count].table), "%s", table ? table : "");
+
+	return count + 1;
+}
+
+
+static const char *connection_options(char *options, size_t options_size, struct dbt_adapter *adapter) {
+	/* Server side settings for every session (timeout and read-only defaults) */
+	int len = 0;
+	options[0] = 0;
+	if (adapter->statement_timeout > 0) len += snprintf(options, options_size, "-c statement_timeout=%lld ", (long long)adapter->statement_timeout);
+	if (adapter->read_only && len < (int)options_size) snprintf(options + len, options_size - len, "-c default_transaction_read_only=on");
+
+	return options[0] ? options : 0;
+}
+static void append_single_row(json_t **result, PGresult *res, struct dbt_adapter *adapter) {
+	/* First row of a result set starts a new streamed result (row limit counts from here) */
+	if (!json_is_true(json_object_get(*result, "streaming"))) {
+		json_decref(*result);
+		*result = result_to_json(res);
+		json_object_set_new(*result, "streaming", json_true());
+		json_object_set_new(*result, "fetch_until", json_integer(adapter->row_limit));
+		return;
+	}
+
+
+	/* Append row */
+	int cols = PQnfields(res);
+	json_t *row_values = json_array();
+	for (int j=0; j < cols; j++) json_array_append_new(row_values, PQgetisnull(res, 0, j) ? json_null() : json_string(PQgetvalue(res, 0, j)));
+	json_array_append_new(json_object_get(*result, "rows"), row_values);
+}
+static int result_at_limit(json_t *result) {
+	json_t *fetch_until = json_object_get(result, "fetch_until");
+	return fetch_until && json_array_size(json_object_get(result, "rows")) >= (size_t)json_integer_value(fetch_until);
+}
+static void drain_connection(PGconn *conn) {
+	/* Abandon statement still streaming (e.g. stopped at row limit) */
+	if (PQtransactionStatus(conn) != PQTRANS_ACTIVE) return;
+
+	PGcancel *cancel = PQgetCancel(conn);
+	if (cancel) {
+		char error[256];
+		PQcancel(cancel, error, sizeof(error));
+		PQfreeCancel(cancel);
+	}
+
+	PGresult *res;
+	while ((res = PQgetResult(conn))) PQclear(res);
+}
+
+
+static PGconn *connect_with_params(const char *database, int non_blocking, struct dbt_adapter *adapter) {
+	/* Keepalives find dead peers while idle, tcp_user_timeout bounds blocked writes, connect_timeout bounds (re)connects */
+	char options[128], keepalive_idle[16];
+	snprintf(keepalive_idle, sizeof(keepalive_idle), "%d", adapter->keepalive_idle > 0 ? adapter->keepalive_idle : 30);
+
+	const char *keywords[] = {
+		"host", "user", "password", "dbname", "options",
+		"keepalives", "keepalives_idle", "keepalives_interval", "keepalives_count", "tcp_user_timeout", "connect_timeout", 0
+	};
+	const char *values[] = {
+		adapter->host, adapter->user, adapter->pass, database, connection_options(options, sizeof(options), adapter),
+		"1", keepalive_idle, "10", "3", "30000", "5", 0
+	};
+
+
+	return non_blocking ? PQconnectStartParams(keywords, values, 0) : PQconnectdbParams(keywords, values, 0);
+}
+static void *open_connection(const char *database, struct dbt_adapter *adapter) {
+	/* Connect to database (failure reason kept for the status line, first line only) */
+	PGconn *conn = connect_with_params(database, 0, adapter);
+	if (PQstatus(conn) != CONNECTION_OK) {
+		const char *message = conn ? PQerrorMessage(conn) : "out of memory";
+		snprintf(adapter->connect_error, sizeof(adapter->connect_error), "%.*s", (int)strcspn(message, "\n"), message);
+		PQfinish(conn);
+		return 0;
+	}
+
+	return conn;
+}
+static void *start_connection(const char *database, struct dbt_adapter *adapter) {
+	/* Start non-blocking connect */
+	PGconn *conn = connect_with_params(database, 1, adapter);
+	if (!conn || PQstatus(conn) == CONNECTION_BAD) {
+		PQfinish(conn);
+		return 0;
+	}
+
+	return conn;
+}
+static int poll_connection(void *conn, struct dbt_adapter *adapter) {
+	/* Advance connect (0 ready, 1 wants read, 2 wants write, -1 failed), ready connections never block on send */
+	switch (PQconnectPoll(conn)) {
+		case PGRES_POLLING_OK:
+			return PQsetnonblocking(conn, 1) ? -1 : 0;
+		case PGRES_POLLING_READING:
+			return 1;
+		case PGRES_POLLING_WRITING:
+			return 2;
+		default:
+			return -1;
+	}
+}
+static void close_connection(void *conn, struct dbt_adapter *adapter) {
+	if (conn) PQfinish(conn);
+}
+static int load_database_list(struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	/* Connect to server */
+	if (!adapter->conn_handle) adapter->conn_handle = open_connection("postgres", adapter);
+	if (!adapter->conn_handle) return 1;
+
+
 	/* Fetch databases */
 	const char *sql = 
 		" SELECT datname FROM pg_database"
@@ -14,35 +233,33 @@ static json_t *load_database_list(struct dbt_adapter *adapter) {
 	PGresult *res = PQexec(adapter->conn_handle, sql);
 	if (PQresultStatus(res) != PGRES_TUPLES_OK) {
 		PQclear(res);
-		return 0;
+		return 1;
 	}
 
 
-	/* Append database names to array */
-	json_t *database_list = json_array();
-	int row_count = PQntuples(res);
-	for (int i=0; i < row_count; i++) {
-		char *db_name = PQgetvalue(res, i, 0);
-		json_array_append_new(database_list, json_string(db_name));
-	}
+	/* Intern database names */
+	int failed = result_to_names(res, list, strings);
 
 
 	/* Clear result */
 	PQclear(res);
 
 
-	return database_list;
+	return failed;
 }
-static void connect_to_db(const char *database, struct dbt_adapter *adapter) {
+static int connect_to_db(const char *database, struct dbt_adapter *adapter) {
 	/* Connect to database */
-	PGconn *conn = PQsetdbLogin(adapter->host, 0, 0, 0, database, adapter->user, adapter->pass);
-	if (PQstatus(conn) != CONNECTION_OK) {
-		/* TODO: handle */
-		return;
-	}
+	PGconn *conn = open_connection(database, adapter);
+
+
+	/* Replace previous database connection (dropped on failure, it belongs to the database no longer selected) */
+	close_connection(adapter->db_conn_handle, adapter);
 	adapter->db_conn_handle = conn;
+
+
+	return !conn;
 }
-static json_t *load_schema_list(struct dbt_adapter *adapter) {
+static int load_schema_list(struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
 	/* Fetch schemas */
 	const char *sql =
 		" SELECT schema_name FROM information_schema.schemata"
@@ -52,31 +269,26 @@ static json_t *load_schema_list(struct dbt_adapter *adapter) {
 	PGresult *res = PQexec(adapter->db_conn_handle, sql);
 	if (PQresultStatus(res) != PGRES_TUPLES_OK) {
 		PQclear(res);
-		return 0;
+		return 1;
 	}
 
 
-	/* Append schema names to array */
-	json_t *schema_list = json_array();
-	int row_count = PQntuples(res);
-	for (int i=0; i < row_count; i++) {
-		char *schema_name = PQgetvalue(res, i, 0);
-		json_array_append_new(schema_list, json_string(schema_name));
-	}
+	/* Intern schema names */
+	int failed = result_to_names(res, list, strings);
 
 
 	/* Clear result */
 	PQclear(res);
 
 
-	return schema_list;
+	return failed;
 }
-static json_t *load_table_list(const char *schema, struct dbt_adapter *adapter) {
+static int load_table_list(const char *schema, struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
 	/* Fetch tables */
 	const char *sql =
 		" SELECT tablename FROM pg_catalog.pg_tables"
 		" WHERE tableowner = current_user AND schemaname = $1"
-		" ORDER BY tablename;";
+		" ORDER BY tablename COLLATE \"C\";";
 	
 	const char **params = {
 		&schema
@@ -85,29 +297,24 @@ static json_t *load_table_list(const char *schema, struct dbt_adapter *adapter)
 	PGresult *res = PQexecParams(adapter->db_conn_handle, sql, 1, 0, params, 0, 0, 0);
 	if (PQresultStatus(res) != PGRES_TUPLES_OK) {
 		PQclear(res);
-		return 0;
+		return 1;
 	}
 
 
-	/* Append table names to array */
-	json_t *table_list = json_array();
-	int row_count = PQntuples(res);
-	for (int i=0; i < row_count; i++) {
-		char *table_name = PQgetvalue(res, i, 0);
-		json_array_append_new(table_list, json_string(table_name));
-	}
+	/* Intern table names */
+	int failed = result_to_names(res, list, strings);
 
 
 	/* Clear result */
 	PQclear(res);
 
 
-	return table_list;
+	return failed;
 }
-static json_t *load_column_list(const char *schema, const char *table, struct dbt_adapter *adapter) {
+static int load_column_list(const char *schema, const char *table, struct dbt_column_table *columns, struct dbt_strings *strings, struct dbt_adapter *adapter) {
 	/* Fetch columns */
 	const char *sql =
-		" SELECT column_name, ordinal_position, is_nullable, udt_name, character_maximum_length, is_identity"
+		" SELECT column_name, is_nullable, udt_name, character_maximum_length, is_identity"
 		" FROM information_schema.columns"
 		" WHERE table_schema = $1 AND table_name = $2"
 		" ORDER BY ordinal_position;";
@@ -120,23 +327,24 @@ static json_t *load_column_list(const char *schema, const char *table, struct db
 	PGresult *res = PQexecParams(adapter->db_conn_handle, sql, 2, 0, params, 0, 0, 0);
 	if (PQresultStatus(res) != PGRES_TUPLES_OK) {
 		PQclear(res);
-		return 0;
+		return 1;
 	}
 
 
-	/* Append columns to array */
-	json_t *column_list = json_array();
+	/* Append columns to table (names and types interned) */
+	columns->count = 0;
+	int failed = 0;
 	int row_count = PQntuples(res);
-	for (int i=0; i < row_count; i++) {
-		json_t *column = json_object();
-		json_object_set_new(column, "name", json_string(PQgetvalue(res, i, 0)));
-		json_object_set_new(column, "ordinal", json_string(PQgetvalue(res, i, 1)));
-		json_object_set_new(column, "nullable", json_string(PQgetvalue(res, i, 2)));
-		json_object_set_new(column, "datatype", json_string(PQgetvalue(res, i, 3)));
-		json_object_set_new(column, "max_length", json_string(PQgetvalue(res, i, 4)));
-		json_object_set_new(column, "is_identity", json_string(PQgetvalue(res, i, 5)));
+	for (int i=0; i < row_count && !failed; i++) {
+		uint32_t name = dbt_strings_intern(strings, PQgetvalue(res, i, 0), PQgetlength(res, i, 0));
+		uint32_t datatype = dbt_strings_intern(strings, PQgetvalue(res, i, 2), PQgetlength(res, i, 2));
+		int32_t max_length = PQgetisnull(res, i, 3) ? -1 : atoi(PQgetvalue(res, i, 3));
+
+		uint8_t flags = 0;
+		if (!strcmp(PQgetvalue(res, i, 1), "YES")) flags |= DBT_COLUMN_NULLABLE;
+		if (!strcmp(PQgetvalue(res, i, 4), "YES")) flags |= DBT_COLUMN_IDENTITY;
 
-		json_array_append_new(column_list, column);
+		failed = dbt_catalog_columns_append(columns, name, datatype, max_length, flags);
 	}
 
 
@@ -144,84 +352,941 @@ static json_t *load_column_list(const char *schema, const char *table, struct db
 	PQclear(res);
 
 
-	return column_list;
+	return failed;
 }
 static json_t *perform_query(const char *query, struct dbt_adapter *adapter) {
-	/* Perform query */
-	PGresult *res = PQexec(adapter->db_conn_handle, query);
-	if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+	/* Without row limit fetch whole result */
+	if (adapter->row_limit <= 0) {
+		PGresult *res = PQexec(adapter->db_conn_handle, query);
+		if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+			PQclear(res);
+			return 0;
+		}
+
+		json_t *result = result_to_json(res);
+		PQclear(res);
+
+		return result;
+	}
+
+
+	/* Stream rows and stop at the limit (statement is cancelled, not fetched) */
+	if (!PQsendQuery(adapter->db_conn_handle, query)) return 0;
+	PQsetSingleRowMode(adapter->db_conn_handle);
+
+	json_t *result = 0;
+	int failed = 0;
+	PGresult *res;
+	while (!result_at_limit(result) && (res = PQgetResult(adapter->db_conn_handle))) {
+		ExecStatusType status = PQresultStatus(res);
+		if (status == PGRES_SINGLE_TUPLE) append_single_row(&result, res, adapter);
+		else if (status == PGRES_TUPLES_OK && !result) result = result_to_json(res);
+		else if (status != PGRES_TUPLES_OK) failed = 1;
 		PQclear(res);
+	}
+
+	if (result_at_limit(result)) json_object_set_new(result, "truncated", json_true());
+	drain_connection(adapter->db_conn_handle);
+	json_object_del(result, "streaming");
+	json_object_del(result, "fetch_until");
+
+	if (failed) {
+		json_decref(result);
 		return 0;
 	}
 
 
-	/* Prepare result */
-	json_t *result = json_object();
+	return result;
+}
+static json_t *load_table_properties(const char *schema, const char *table, struct dbt_adapter *adapter) {
+	/* Fetch planner statistics, sizes, maintenance times and indexes in one round trip (no table scan) */
+	const char *sql =
+		" SELECT c.reltuples::bigint AS reltuples, c.relpages,"
+		" pg_total_relation_size(c.oid) AS total_size, pg_relation_size(c.oid) AS table_size, pg_indexes_size(c.oid) AS index_size,"
+		" s.n_live_tup, s.n_dead_tup, s.last_vacuum, s.last_autovacuum, s.last_analyze, s.last_autoanalyze,"
+		" (SELECT json_agg(json_build_array(i.relname, pg_relation_size(i.oid), x.indisprimary, x.indisunique) ORDER BY i.relname)"
+		"  FROM pg_catalog.pg_index x JOIN pg_catalog.pg_class i ON i.oid = x.indexrelid WHERE x.indrelid = c.oid) AS indexes"
+		" FROM pg_catalog.pg_class c JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+		" LEFT JOIN pg_catalog.pg_stat_user_tables s ON s.relid = c.oid"
+		" WHERE n.nspname = $1 AND c.relname = $2;";
 
+	const char *params[2] = {
+		schema,
+		table
+	};
 
-	/* Add columns to result */
-	int cols = PQnfields(res);
-	json_t *column_list = json_array();
-	for (int i=0; i < cols; i++) {
-		json_array_append_new(column_list, json_string(PQfname(res, i)));
+	PGresult *res = PQexecParams(adapter->db_conn_handle, sql, 2, 0, params, 0, 0, 0);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1) {
+		PQclear(res);
+		return 0;
 	}
-	json_object_set_new(result, "columns", column_list);
 
 
-	/* Add rows to result */
+	/* Row to object (NULL stays null, index list is parsed) */
+	json_t *properties = json_object();
+	for (int j=0; j < PQnfields(res); j++) {
+		json_t *value;
+		if (PQgetisnull(res, 0, j)) value = json_null();
+		else if (!strcmp(PQfname(res, j), "indexes")) value = json_loads(PQgetvalue(res, 0, j), 0, 0);
+		else value = json_string(PQgetvalue(res, 0, j));
+
+		json_object_set_new(properties, PQfname(res, j), value ? value : json_null());
+	}
+
+	long long relpages = atoll(PQgetvalue(res, 0, 1));
+	PQclear(res);
+
+
+	/* Sampled preview reads about 4 pages (TABLESAMPLE SYSTEM picks whole blocks), caller runs it in background */
+	double percent = relpages > 4 ? 400.0 / relpages : 100;
+	if (percent < 0.0001) percent = 0.0001;
+
+	char *schema_ident = PQescapeIdentifier(adapter->db_conn_handle, schema, strlen(schema));
+	char *table_ident = PQescapeIdentifier(adapter->db_conn_handle, table, strlen(table));
+	if (schema_ident && table_ident) {
+		char sample_sql[1024];
+		snprintf(sample_sql, sizeof(sample_sql), "SELECT * FROM %s.%s TABLESAMPLE SYSTEM (%.4f) LIMIT 20;", schema_ident, table_ident, percent);
+
+		json_object_set_new(properties, "sample_query", json_string(sample_sql));
+		json_object_set_new(properties, "sample_percent", json_real(percent));
+	}
+
+	PQfreemem(schema_ident);
+	PQfreemem(table_ident);
+
+
+	return properties;
+}
+static int connection_fd(void *conn, struct dbt_adapter *adapter) {
+	return PQsocket(conn);
+}
+static int send_query(const char *query, void *conn, struct dbt_adapter *adapter) {
+	/* Drop rest of a previous result stopped at the row limit */
+	drain_connection(conn);
+
+
+	/* Dispatch without waiting for results (rows arrive one by one when limited) */
+	if (!PQsendQuery(conn, query)) return 1;
+	if (adapter->row_limit > 0) PQsetSingleRowMode(conn);
+
+
+	return 0;
+}
+static int poll_query(void *conn, json_t **result, struct dbt_adapter *adapter) {
+	/* Push rest of a query non-blocking connections could not send at once, read whatever arrived on the socket */
+	if (PQflush(conn) < 0 || !PQconsumeInput(conn)) {
+		json_decref(*result);
+		*result = error_to_json(PQerrorMessage(conn));
+		return 0;
+	}
+
+
+	/* Collect finished statement results without blocking */
+	while (!PQisBusy(conn)) {
+		/* Row limit reached, leave remaining rows on the connection until more are requested */
+		if (result_at_limit(*result)) {
+			json_object_set_new(*result, "truncated", json_true());
+			return 0;
+		}
+
+		PGresult *res = PQgetResult(conn);
+		if (!res) {
+			json_object_del(*result, "streaming");
+			json_object_del(*result, "fetch_until");
+			return 0;
+		}
+
+
+		/* Keep latest result (first error wins) */
+		ExecStatusType status = PQresultStatus(res);
+		if (json_object_get(*result, "error")) {
+			PQclear(res);
+			continue;
+		}
+
+		if (status == PGRES_SINGLE_TUPLE) append_single_row(result, res, adapter);
+		else if (status == PGRES_TUPLES_OK && json_is_true(json_object_get(*result, "streaming"))) {
+			/* End of streamed result set */
+			json_object_del(*result, "streaming");
+			json_object_del(*result, "fetch_until");
+		} else {
+			json_t *converted;
+			if (status == PGRES_TUPLES_OK) converted = result_to_json(res);
+			else if (status == PGRES_COMMAND_OK) {
+				converted = json_object();
+				json_object_set_new(converted, "columns", json_array());
+				json_object_set_new(converted, "rows", json_array());
+				json_object_set_new(converted, "command", json_string(PQcmdStatus(res)));
+			} else converted = error_to_json(PQresultErrorMessage(res));
+
+			json_decref(*result);
+			*result = converted;
+		}
+
+		PQclear(res);
+	}
+
+
+	return 1;
+}
+static int fetch_more(void *conn, json_t *result, struct dbt_adapter *adapter) {
+	/* Raise limit of a paused result by another batch past the rows it holds (consumers may drain rows in between) */
+	json_t *fetch_until = json_object_get(result, "fetch_until");
+	if (!fetch_until || !json_is_true(json_object_get(result, "truncated"))) return 1;
+
+	json_object_set_new(result, "fetch_until", json_integer(json_array_size(json_object_get(result, "rows")) + adapter->row_limit));
+	json_object_del(result, "truncated");
+
+
+	return 0;
+}
+static int cancel_query(void *conn, struct dbt_adapter *adapter) {
+	/* Ask server to cancel running statement */
+	PGcancel *cancel = PQgetCancel(conn);
+	if (!cancel) return 1;
+
+	char error[256];
+	int ok = PQcancel(cancel, error, sizeof(error));
+	PQfreeCancel(cancel);
+
+
+	return !ok;
+}
+
+static int check_connection(void *conn, struct dbt_adapter *adapter) {
+	/* Send round trip that also snapshots session state to restore after a reconnect (answer is read by poll_check) */
+	if (PQstatus(conn) != CONNECTION_OK) return 1;
+
+	const char *sql =
+		" SELECT current_setting('search_path'),"
+		" (SELECT json_agg(statement ORDER BY prepare_time) FROM pg_catalog.pg_prepared_statements WHERE from_sql);";
+
+
+	return !PQsendQuery(conn, sql);
+}
+static int poll_check(void *conn, json_t **state, struct dbt_adapter *adapter) {
+	/* Read health check or restore answers without blocking (0 done, 1 busy, -1 connection lost) */
+	if (PQflush(conn) < 0 || !PQconsumeInput(conn)) return -1;
+
+	while (!PQisBusy(conn)) {
+		PGresult *res = PQgetResult(conn);
+		if (!res) return PQstatus(conn) != CONNECTION_OK ? -1 : 0;
+
+		/* Health check answer replaces snapshot (errors on a live connection, e.g. aborted transaction, keep the previous one) */
+		if (state && PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) == 1 && PQnfields(res) == 2) {
+			json_t *snapshot = json_object();
+			json_object_set_new(snapshot, "search_path", json_string(PQgetvalue(res, 0, 0)));
+			json_t *prepared = PQgetisnull(res, 0, 1) ? 0 : json_loads(PQgetvalue(res, 0, 1), 0, 0);
+			json_object_set_new(snapshot, "prepared", prepared ? prepared : json_array());
+
+			json_decref(*state);
+			*state = snapshot;
+		}
+
+		PQclear(res);
+	}
+
+
+	return 1;
+}
+static int reset_connection(void *conn, struct dbt_adapter *adapter) {
+	/* Reconnect with the same parameters (continued by poll_reset) */
+	return !PQresetStart(conn);
+}
+static int poll_reset(void *conn, struct dbt_adapter *adapter) {
+	/* Advance reconnect (0 ready, 1 wants read, 2 wants write, -1 failed) */
+	switch (PQresetPoll(conn)) {
+		case PGRES_POLLING_OK:
+			return 0;
+		case PGRES_POLLING_READING:
+			return 1;
+		case PGRES_POLLING_WRITING:
+			return 2;
+		default:
+			return -1;
+	}
+}
+static int restore_connection(void *conn, json_t *state, size_t *step, struct dbt_adapter *adapter) {
+	/* Send next restore statement from step on, 1 once none is left (answers are read by poll_check) */
+	const char *search_path = json_string_value(json_object_get(state, "search_path"));
+	if (!search_path) return 1;
+
+
+	/* Restore search_path first */
+	if (!*step) {
+		const char *params[1] = { search_path };
+		*step = 1;
+
+		return !PQsendQueryParams(conn, "SELECT pg_catalog.set_config('search_path', $1, false);", 1, 0, params, 0, 0, 0);
+	}
+
+
+	/* Re-run PREPARE statements one by one (only single statements, a batch could repeat other work) */
+	json_t *prepared = json_object_get(state, "prepared");
+	while (*step <= json_array_size(prepared)) {
+		const char *statement = json_string_value(json_array_get(prepared, *step - 1));
+		(*step)++;
+		if (!statement || strncasecmp(statement, "PREPARE", 7)) continue;
+
+		size_t statement_len = strlen(statement);
+		while (statement_len && (statement[statement_len-1] == ';' || statement[statement_len-1] == ' ' || statement[statement_len-1] == '\n')) statement_len--;
+		if (memchr(statement, ';', statement_len)) continue;
+
+		return !PQsendQuery(conn, statement);
+	}
+
+
+	return 1;
+}
+static void export_ctid_ranges(json_t *ranges, long long blocks, size_t range_count) {
+	/* Equal block ranges, outer ranges open-ended (TID range scans read only their blocks) */
+	size_t count = blocks < (long long)range_count ? (size_t)(blocks > 0 ? blocks : 1) : range_count;
+	char predicate[128];
+	for (size_t i=0; i < count; i++) {
+		long long low = blocks * (long long)i / (long long)count;
+		long long high = blocks * (long long)(i + 1) / (long long)count;
+
+		if (count == 1) snprintf(predicate, sizeof(predicate), "true");
+		else if (!i) snprintf(predicate, sizeof(predicate), "ctid < '(%lld,0)'::tid", high);
+		else if (i == count - 1) snprintf(predicate, sizeof(predicate), "ctid >= '(%lld,0)'::tid", low);
+		else snprintf(predicate, sizeof(predicate), "ctid >= '(%lld,0)'::tid AND ctid < '(%lld,0)'::tid", low, high);
+
+		json_array_append_new(ranges, json_string(predicate));
+	}
+}
+static int export_key_ranges(json_t *ranges, const char *schema, const char *table, const char *key, size_t range_count, PGconn *conn) {
+	/* Column type, so histogram bounds can be cast back from anyarray */
+	const char *params[3] = { schema, table, key };
+	PGresult *res = PQexecParams(conn,
+		" SELECT pg_catalog.format_type(a.atttypid, a.atttypmod)"
+		" FROM pg_catalog.pg_attribute a JOIN pg_catalog.pg_class c ON c.oid = a.attrelid JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+		" WHERE n.nspname = $1 AND c.relname = $2 AND a.attname = $3 AND a.attnum > 0 AND NOT a.attisdropped;", 3, 0, params, 0, 0, 0);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1) {
+		PQclear(res);
+		return 1;
+	}
+
+	char sql[512];
+	snprintf(sql, sizeof(sql), "SELECT quote_literal(v) FROM unnest((SELECT histogram_bounds::text::%s[] FROM pg_catalog.pg_stats WHERE schemaname = $1 AND tablename = $2 AND attname = $3)) v;", PQgetvalue(res, 0, 0));
+	PQclear(res);
+
+
+	/* Equi-depth bounds of the planner histogram (no table scan), picked evenly */
+	res = PQexecParams(conn, sql, 3, 0, params, 0, 0, 0);
+	int bound_count = PQresultStatus(res) == PGRES_TUPLES_OK ? PQntuples(res) : 0;
+	char *key_ident = PQescapeIdentifier(conn, key, strlen(key));
+	if (bound_count < 3 || !key_ident) {
+		PQfreemem(key_ident);
+		PQclear(res);
+		return 1;
+	}
+
+	const char *previous = 0;
+	size_t predicate_size = 2 * strlen(key_ident) + 64;
+	for (size_t i=1; i <= range_count; i++) {
+		/* Last range takes everything from the previous bound on, repeated bounds (skew) are merged */
+		const char *bound = i < range_count ? PQgetvalue(res, (int)((bound_count - 1) * i / range_count), 0) : 0;
+		if (bound && previous && !strcmp(bound, previous)) continue;
+		else if (bound && i < range_count && !strcmp(bound, PQgetvalue(res, bound_count - 1, 0))) bound = 0;
+
+		char *predicate = (char *)malloc(predicate_size + (bound ? strlen(bound) : 0) + (previous ? strlen(previous) : 0));
+		if (!predicate) break;
+
+		if (!previous && !bound) sprintf(predicate, "true");
+		else if (!previous) sprintf(predicate, "(%s < %s OR %s IS NULL)", key_ident, bound, key_ident);
+		else if (!bound) sprintf(predicate, "%s >= %s", key_ident, previous);
+		else sprintf(predicate, "%s >= %s AND %s < %s", key_ident, previous, key_ident, bound);
+
+		json_array_append_new(ranges, json_string(predicate));
+		free(predicate);
+
+		if (!bound) break;
+		previous = bound;
+	}
+
+	PQfreemem(key_ident);
+	PQclear(res);
+
+
+	return 0;
+}
+static json_t *plan_export(const char *schema, const char *table, const char *key, size_t range_count, void *conn, struct dbt_adapter *adapter) {
+	/* Snapshot stays importable while this transaction is open */
+	PGresult *res = PQexec(conn, "BEGIN ISOLATION LEVEL REPEATABLE READ READ ONLY;");
+	int failed = PQresultStatus(res) != PGRES_COMMAND_OK;
+	PQclear(res);
+	if (failed) return error_to_json(PQerrorMessage(conn));
+
+	const char *params[2] = { schema, table };
+	res = PQexecParams(conn,
+		" SELECT pg_catalog.pg_export_snapshot(), current_setting('server_version_num')::int,"
+		" pg_catalog.pg_relation_size(c.oid) / current_setting('block_size')::int"
+		" FROM pg_catalog.pg_class c JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+		" WHERE n.nspname = $1 AND c.relname = $2;", 2, 0, params, 0, 0, 0);
+	if (PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1) {
+		json_t *error = error_to_json(PQresultStatus(res) == PGRES_TUPLES_OK ? "table not found" : PQerrorMessage(conn));
+		PQclear(res);
+		return error;
+	}
+
+	json_t *plan = json_object();
+	json_object_set_new(plan, "snapshot", json_string(PQgetvalue(res, 0, 0)));
+	int version = atoi(PQgetvalue(res, 0, 1));
+	long long blocks = atoll(PQgetvalue(res, 0, 2));
+	PQclear(res);
+
+
+	/* Split by key histogram, otherwise by heap blocks (before 14 a ctid range still scans the whole heap) */
+	json_t *ranges = json_array();
+	if (key && !export_key_ranges(ranges, schema, table, key, range_count, conn)) json_object_set_new(plan, "split", json_string("key"));
+	else if (version >= 140000) {
+		export_ctid_ranges(ranges, blocks, range_count);
+		json_object_set_new(plan, "split", json_string("ctid"));
+	} else {
+		json_array_append_new(ranges, json_string("true"));
+		json_object_set_new(plan, "split", json_string("none"));
+	}
+	json_object_set_new(plan, "ranges", ranges);
+
+
+	return plan;
+}
+static int start_export(const char *schema, const char *table, const char *snapshot, const char *predicate, int first, void *conn, struct dbt_adapter *adapter) {
+	/* Quote names and snapshot id */
+	char *schema_ident = PQescapeIdentifier(conn, schema, strlen(schema));
+	char *table_ident = PQescapeIdentifier(conn, table, strlen(table));
+	char *snapshot_literal = PQescapeLiteral(conn, snapshot, strlen(snapshot));
+
+	size_t sql_size = (schema_ident && table_ident && snapshot_literal) ? strlen(schema_ident) + strlen(table_ident) + strlen(snapshot_literal) + strlen(predicate) + 256 : 0;
+	char *sql = sql_size ? (char *)malloc(sql_size) : 0;
+
+
+	/* First range of a worker imports the shared snapshot, later ranges reuse its transaction */
+	int failed = 1;
+	if (sql) {
+		int len = 0;
+		if (first) len = snprintf(sql, sql_size, "BEGIN ISOLATION LEVEL REPEATABLE READ READ ONLY; SET TRANSACTION SNAPSHOT %s; ", snapshot_literal);
+		snprintf(sql + len, sql_size - len, "COPY (SELECT * FROM %s.%s WHERE %s) TO STDOUT WITH (FORMAT csv);", schema_ident, table_ident, predicate);
+
+		failed = !PQsendQuery(conn, sql);
+	}
+
+	free(sql);
+	PQfreemem(schema_ident);
+	PQfreemem(table_ident);
+	PQfreemem(snapshot_literal);
+
+
+	return failed;
+}
+static int read_export(void *conn, int *copying, char **data, struct dbt_adapter *adapter) {
+	/* Read whatever arrived on the socket */
+	if (!PQconsumeInput(conn)) {
+		*data = PQerrorMessage(conn);
+		return -2;
+	}
+
+
+	/* Walk BEGIN/SET results into COPY, then rows until the final status */
+	for (;;) {
+		if (*copying) {
+			int len = PQgetCopyData(conn, data, 1);
+			if (len >= 0) return len;
+
+			*copying = 0;
+			if (len == -2) {
+				*data = PQerrorMessage(conn);
+				return -2;
+			}
+			continue;
+		}
+
+		if (PQisBusy(conn)) return 0;
+		PGresult *res = PQgetResult(conn);
+		if (!res) return -1;
+
+		ExecStatusType status = PQresultStatus(res);
+		if (status == PGRES_COPY_OUT) *copying = 1;
+		else if (status != PGRES_COMMAND_OK) {
+			*data = PQerrorMessage(conn);
+			PQclear(res);
+			return -2;
+		}
+		PQclear(res);
+	}
+}
+static void release_export_data(char *data, struct dbt_adapter *adapter) {
+	PQfreemem(data);
+}
+static int start_import(const char *schema, const char *table, json_t *columns, int csv, void *conn, char **message, struct dbt_adapter *adapter) {
+	/* Quote names, column list follows file order */
+	char *schema_ident = PQescapeIdentifier(conn, schema, strlen(schema));
+	char *table_ident = PQescapeIdentifier(conn, table, strlen(table));
+	size_t sql_size = (schema_ident && table_ident) ? strlen(schema_ident) + strlen(table_ident) + 128 : 0;
+
+	size_t column_ind;
+	json_t *column;
+	json_array_foreach(columns, column_ind, column) sql_size += 2 * strlen(json_string_value(column)) + 4;
+
+	char *sql = sql_size ? (char *)malloc(sql_size) : 0;
+	if (!sql) {
+		PQfreemem(schema_ident);
+		PQfreemem(table_ident);
+		*message = PQerrorMessage(conn);
+		return 1;
+	}
+
+	int len = snprintf(sql, sql_size, "COPY %s.%s", schema_ident, table_ident);
+	json_array_foreach(columns, column_ind, column) {
+		const char *name = json_string_value(column);
+		char *column_ident = PQescapeIdentifier(conn, name, strlen(name));
+		len += snprintf(sql + len, sql_size - len, "%s%s", column_ind ? ", " : " (", column_ident ? column_ident : "\"\"");
+		PQfreemem(column_ident);
+	}
+	if (json_array_size(columns)) len += snprintf(sql + len, sql_size - len, ")");
+	snprintf(sql + len, sql_size - len, " FROM STDIN WITH (FORMAT %s);", csv ? "csv" : "text");
+
+	PQfreemem(schema_ident);
+	PQfreemem(table_ident);
+
+
+	/* Server answers with COPY IN right away, data is then sent without blocking */
+	PGresult *res = PQexec(conn, sql);
+	free(sql);
+	int failed = PQresultStatus(res) != PGRES_COPY_IN;
+	PQclear(res);
+
+	if (failed || PQsetnonblocking(conn, 1)) {
+		*message = PQerrorMessage(conn);
+		return 1;
+	}
+
+
+	return 0;
+}
+static int write_import(const char *data, size_t length, void *conn, char **message, struct dbt_adapter *adapter) {
+	/* Queue chunk only once the previous one left the buffer (keeps memory at one chunk) */
+	int flushed = PQflush(conn);
+	if (flushed > 0) return 0;
+
+	int queued = flushed < 0 ? -1 : PQputCopyData(conn, data, (int)length);
+	if (!queued) return 0;
+	else if (queued > 0 && PQflush(conn) >= 0) return 1;
+
+
+	*message = PQerrorMessage(conn);
+	return -1;
+}
+static int finish_import(const char *abort_reason, int *ended, void *conn, char **message, struct dbt_adapter *adapter) {
+	/* Send end of data (or abort, rolling back every row) once buffered data is out */
+	if (!*ended) {
+		int flushed = PQflush(conn);
+		if (flushed > 0) return 1;
+
+		int status = flushed < 0 ? -1 : PQputCopyEnd(conn, abort_reason);
+		if (status < 0) {
+			*message = PQerrorMessage(conn);
+			return -1;
+		} else if (!status) return 1;
+
+		*ended = 1;
+	}
+
+
+	/* Wait for final status */
+	if (PQflush(conn) > 0) return 1;
+	else if (!PQconsumeInput(conn)) {
+		*message = PQerrorMessage(conn);
+		return -1;
+	} else if (PQisBusy(conn)) return 1;
+
+	PGresult *res = PQgetResult(conn);
+	int failed = PQresultStatus(res) != PGRES_COMMAND_OK;
+	PQclear(res);
+
+	*message = failed ? PQerrorMessage(conn) : 0;
+
+
+	return failed ? -1 : 0;
+}
+static int pipeline_send(const char *statement, int sync, void *conn, struct dbt_adapter *adapter) {
+	/* First statement switches the connection into pipeline mode (extended protocol, one statement per query) */
+	if (PQpipelineStatus(conn) == PQ_PIPELINE_OFF) {
+		drain_connection(conn);
+		if (!PQenterPipelineMode(conn) || PQsetnonblocking(conn, 1)) return -1;
+	}
+
+
+	/* Wait for the socket while earlier statements are still buffered (bounds client memory) */
+	int flushed = PQflush(conn);
+	if (flushed) return flushed > 0 ? 1 : -1;
+
+	if (statement && !PQsendQueryParams(conn, statement, 0, 0, 0, 0, 0, 0)) return -1;
+	else if (sync && !PQpipelineSync(conn)) return -1;
+
+
+	return PQflush(conn) < 0 ? -1 : 0;
+}
+static int pipeline_poll(void *conn, int *write_pending, json_t **result, struct dbt_adapter *adapter) {
+	/* Push queued statements and read whatever arrived */
+	int flushed = PQflush(conn);
+	*write_pending = flushed > 0;
+	if (flushed < 0 || !PQconsumeInput(conn)) return -1;
+
+
+	/* A statement's results end with a null result, sync points have their own result */
+	while (!PQisBusy(conn)) {
+		PGresult *res = PQgetResult(conn);
+		if (!res) return *result ? 1 : 0;
+
+		ExecStatusType status = PQresultStatus(res);
+		if (status == PGRES_PIPELINE_SYNC) {
+			PQclear(res);
+			return 2;
+		} else if (status == PGRES_COPY_OUT) {
+			/* Discard copied rows, scripts cannot take them */
+			char *buffer;
+			int copied;
+			while ((copied = PQgetCopyData(conn, &buffer, 1)) > 0) PQfreemem(buffer);
+			PQclear(res);
+
+			if (!*result) *result = error_to_json("COPY is not supported in scripts");
+			json_object_set_new(*result, "status", json_string("error"));
+			if (!copied) return 0;
+			continue;
+		} else if (*result) {
+			PQclear(res);
+			continue;
+		}
+
+
+		/* Keep outcome only (scripts report counts, not rows) */
+		json_t *outcome = json_object();
+		if (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK) {
+			const char *affected = PQcmdTuples(res);
+			json_object_set_new(outcome, "status", json_string("ok"));
+			json_object_set_new(outcome, "command", json_string(PQcmdStatus(res)));
+			json_object_set_new(outcome, "rows", json_integer(status == PGRES_TUPLES_OK ? PQntuples(res) : affected[0] ? atoll(affected) : -1));
+		} else if (status == PGRES_PIPELINE_ABORTED) {
+			json_object_set_new(outcome, "status", json_string("skipped"));
+		} else {
+			const char *message = PQresultErrorMessage(res);
+			json_object_set_new(outcome, "status", json_string("error"));
+			json_object_set_new(outcome, "error", json_string(message[0] ? message : "COPY is not supported in scripts"));
+			if (status == PGRES_COPY_IN) PQputCopyEnd(conn, "COPY is not supported in scripts");
+		}
+		*result = outcome;
+		PQclear(res);
+	}
+
+
+	return 0;
+}
+static int pipeline_end(void *conn, struct dbt_adapter *adapter) {
+	/* Back to plain queries (only once every result was read: drops results that already arrived, 1 while the rest is still on the wire) */
+	int empty = 0;
+	while (!PQexitPipelineMode(conn)) {
+		if (empty > 1 || !PQconsumeInput(conn) || PQisBusy(conn)) return 1;
+
+		PGresult *res = PQgetResult(conn);
+		empty = res ? 0 : empty + 1;
+		PQclear(res);
+	}
+
+
+	return PQsetnonblocking(conn, 0) != 0;
+}
+static int install_change_feed(struct dbt_adapter *adapter) {
+	/* Event triggers that NOTIFY 'op|schema|object_type|object_name|owner' on DDL (needs superuser, drops carry no owner) */
+	const char *sql =
+		" CREATE OR REPLACE FUNCTION public.dbt_notify_ddl() RETURNS event_trigger LANGUAGE plpgsql AS $dbt$"
+		" DECLARE r record;"
+		" BEGIN"
+		"   IF tg_event = 'sql_drop' THEN"
+		"     FOR r IN SELECT schema_name, object_type, object_name FROM pg_event_trigger_dropped_objects() LOOP"
+		"       PERFORM pg_notify('dbt_ddl', concat('D|', coalesce(r.schema_name, ''), '|', r.object_type, '|', coalesce(r.object_name, '')));"
+		"     END LOOP;"
+		"   ELSE"
+		"     FOR r IN SELECT d.command_tag, d.schema_name, d.object_type, coalesce(c.relname, n.nspname, '') AS object_name, c.relowner"
+		"       FROM pg_event_trigger_ddl_commands() d"
+		"       LEFT JOIN pg_class c ON d.classid = 'pg_class'::regclass AND c.oid = d.objid"
+		"       LEFT JOIN pg_namespace n ON d.classid = 'pg_namespace'::regclass AND n.oid = d.objid LOOP"
+		"       PERFORM pg_notify('dbt_ddl', concat(CASE WHEN r.command_tag LIKE 'CREATE%' THEN 'C' ELSE 'A' END, '|',"
+		"         coalesce(r.schema_name, ''), '|', r.object_type, '|', r.object_name, '|', coalesce(pg_get_userbyid(r.relowner), '')));"
+		"     END LOOP;"
+		"   END IF;"
+		" END $dbt$;"
+		" DROP EVENT TRIGGER IF EXISTS dbt_notify_ddl_end;"
+		" CREATE EVENT TRIGGER dbt_notify_ddl_end ON ddl_command_end EXECUTE FUNCTION public.dbt_notify_ddl();"
+		" DROP EVENT TRIGGER IF EXISTS dbt_notify_ddl_drop;"
+		" CREATE EVENT TRIGGER dbt_notify_ddl_drop ON sql_drop EXECUTE FUNCTION public.dbt_notify_ddl();";
+
+	PGresult *res = PQexec(adapter->db_conn_handle, sql);
+	int failed = PQresultStatus(res) != PGRES_COMMAND_OK;
+	PQclear(res);
+
+
+	return failed;
+}
+static void *open_change_feed(const char *database, const char *mode, struct dbt_adapter *adapter) {
+	/* Check mode */
+	int poll_mode = !strcmp(mode, "poll");
+	if (!poll_mode && strcmp(mode, "notify")) return 0;
+
+
+	/* Open dedicated connection (notifications are only delivered to listening sessions) */
+	struct psql_change_feed *feed = (struct psql_change_feed *)calloc(1, sizeof(struct psql_change_feed));
+	if (!feed) return 0;
+
+	feed->poll_mode = poll_mode;
+	feed->conn = open_connection(database, adapter);
+	if (!feed->conn) {
+		free(feed);
+		return 0;
+	}
+
+
+	/* Poll rounds never block on send, notify mode subscribes to DDL notifications */
+	if (poll_mode && PQsetnonblocking(feed->conn, 1)) {
+		PQfinish(feed->conn);
+		free(feed);
+		return 0;
+	} else if (!poll_mode) {
+		PGresult *res = PQexec(feed->conn, "LISTEN dbt_ddl;");
+		int failed = PQresultStatus(res) != PGRES_COMMAND_OK;
+		PQclear(res);
+
+		if (failed) {
+			PQfinish(feed->conn);
+			free(feed);
+			return 0;
+		}
+	}
+
+
+	return feed;
+}
+static int change_feed_fd(void *feed_handle, struct dbt_adapter *adapter) {
+	/* Poll mode is timer driven, its socket only matters while a round is in flight */
+	struct psql_change_feed *feed = (struct psql_change_feed *)feed_handle;
+	return feed->poll_mode && !feed->poll_step ? -1 : PQsocket(feed->conn);
+}
+static size_t poll_notify_feed(struct psql_change_feed *feed, struct dbt_catalog_change *changes, size_t max) {
+	/* Read pending notifications without blocking */
+	if (!PQconsumeInput(feed->conn)) return 0;
+
+
+	/* Parse 'op|schema|object_type|object_name[|owner]' payloads (only schemas and tables are cached) */
+	size_t count = 0;
+	PGnotify *notify;
+	while ((notify = PQnotifies(feed->conn))) {
+		char op = 0;
+		char schema[64] = "", object_type[32] = "", object_name[64] = "", owner[64] = "";
+		if (sscanf(notify->extra, "%c|%63[^|]|%31[^|]|%63[^|]|%63[^|]", &op, schema, object_type, object_name, owner) >= 4 ||
+			sscanf(notify->extra, "%c||%31[^|]|%63[^|]", &op, object_type, object_name) == 3) {
+			/* Table lists only hold own tables (like load_table_list), tables handed to another role leave it */
+			int foreign = owner[0] && strcmp(owner, PQuser(feed->conn));
+			if (!strcmp(object_type, "table") && foreign && op == 'A') count = feed_add_change(changes, count, max, 'D', schema, object_name);
+			else if (!strcmp(object_type, "table") && !foreign) count = feed_add_change(changes, count, max, op, schema, object_name);
+			else if (!strcmp(object_type, "schema")) count = feed_add_change(changes, count, max, op, object_name, 0);
+		}
+
+		PQfreemem(notify);
+	}
+
+
+	return count;
+}
+static int feed_collect(struct psql_change_feed *feed) {
+	/* Gather answer of the query in flight (1 while busy, 0 once complete; pending_result stays null on failure) */
+	if (PQflush(feed->conn) < 0 || !PQconsumeInput(feed->conn)) return 0;
+
+	while (!PQisBusy(feed->conn)) {
+		PGresult *res = PQgetResult(feed->conn);
+		if (!res) return 0;
+
+		if (!feed->pending_result) feed->pending_result = res;
+		else PQclear(res);
+	}
+
+
+	return 1;
+}
+static size_t poll_fingerprint_feed(struct psql_change_feed *feed, const char *schema, struct dbt_catalog_change *changes, size_t max) {
+	/* Idle: start a round with the schema list fingerprint */
+	if (!feed->poll_step) {
+		if (!PQsendQuery(feed->conn, "SELECT count(*), max(xmin::text::bigint) FROM pg_catalog.pg_namespace;")) return 0;
+
+		free(feed->pending_schema);
+		feed->pending_schema = strdup(schema ? schema : "");
+		feed->poll_step = 1;
+		return 0;
+	}
+
+
+	/* Wait for the answer without blocking the UI */
+	if (feed_collect(feed)) return 0;
+	PGresult *res = feed->pending_result;
+	feed->pending_result = 0;
+
+	if (feed->poll_step == 1) {
+		/* Fingerprint current schema's tables next (row version, storage and attribute versions) */
+		const char *sql =
+			" SELECT c.relname, c.xmin::text, c.relfilenode,"
+			" (SELECT count(*) || ':' || max(a.xmin::text::bigint) FROM pg_catalog.pg_attribute a WHERE a.attrelid = c.oid)"
+			" FROM pg_catalog.pg_class c JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+			" WHERE n.nspname = $1 AND c.relkind IN ('r', 'p') AND pg_catalog.pg_get_userbyid(c.relowner) = current_user"
+			" ORDER BY c.relname COLLATE \"C\";";
+
+		const char *params[1] = { feed->pending_schema ? feed->pending_schema : "" };
+		int ok = PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) == 1;
+		if (ok) feed->pending_fingerprint = fingerprint_row(res, 0, 0);
+		PQclear(res);
+
+		feed->poll_step = ok && PQsendQueryParams(feed->conn, sql, 1, 0, params, 0, 0, 0) ? 2 : 0;
+		return 0;
+	}
+
+	feed->poll_step = 0;
+	if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+		PQclear(res);
+		return 0;
+	}
+	uint64_t schema_fingerprint = feed->pending_fingerprint;
+	const char *params[1] = { feed->pending_schema ? feed->pending_schema : "" };
+
+
+	/* Merge sorted snapshots (first poll and schema switches only record a baseline) */
+	size_t count = 0;
 	int rows = PQntuples(res);
-	json_t *row_list = json_array();
-	for (int i=0; i < rows; i++) {
-		json_t *row_values = json_array();
-		for (int j=0; j < cols; j++) {
-			json_array_append_new(row_values, json_string(PQgetvalue(res, i, j)));
+	int baseline = !feed->has_snapshot || !feed->schema || strcmp(feed->schema, params[0]);
+	if (!baseline) {
+		if (schema_fingerprint != feed->schema_fingerprint) count = feed_add_change(changes, count, max, 'A', "", 0);
+
+		size_t i = 0;
+		int j = 0;
+		while (i < feed->count || j < rows) {
+			int cmp = i >= feed->count ? 1 : j >= rows ? -1 : strcmp(feed->names[i], PQgetvalue(res, j, 0));
+			if (cmp < 0) count = feed_add_change(changes, count, max, 'D', params[0], feed->names[i++]);
+			else if (cmp > 0) {
+				count = feed_add_change(changes, count, max, 'C', params[0], PQgetvalue(res, j, 0));
+				j++;
+			} else {
+				if (feed->fingerprints[i] != fingerprint_row(res, j, 1)) count = feed_add_change(changes, count, max, 'A', params[0], feed->names[i]);
+				i++;
+				j++;
+			}
 		}
-		json_array_append_new(row_list, row_values);
 	}
-	json_object_set_new(result, "rows", row_list);
 
 
-	/* Clear result */
+	/* Replace snapshot */
+	feed_clear_snapshot(feed);
+	feed->names = (char **)malloc((rows ? rows : 1) * sizeof(char *));
+	feed->fingerprints = (uint64_t *)malloc((rows ? rows : 1) * sizeof(uint64_t));
+	feed->schema = strdup(params[0]);
+	if (feed->names && feed->fingerprints && feed->schema) {
+		for (int j=0; j < rows; j++) {
+			feed->names[j] = strdup(PQgetvalue(res, j, 0));
+			feed->fingerprints[j] = fingerprint_row(res, j, 1);
+		}
+		feed->count = rows;
+		feed->schema_fingerprint = schema_fingerprint;
+		feed->has_snapshot = 1;
+	}
+
 	PQclear(res);
 
 
-	return result;
+	return count;
 }
+static size_t poll_change_feed(void *feed_handle, const char *schema, struct dbt_catalog_change *changes, size_t max, struct dbt_adapter *adapter) {
+	/* Check input */
+	struct psql_change_feed *feed = (struct psql_change_feed *)feed_handle;
+	if (!feed || !changes) return 0;
 
 
-void dbt_adapter_psql_init(struct dbt_session *session) {
-	/* Init values */
-	session->adapter_handle.conn_handle = 0;
-	session->adapter_handle.db_conn_handle = 0;
-	session->adapter_handle.load_database_list = load_database_list;
-	session->adapter_handle.connect_to_db = connect_to_db;
-	session->adapter_handle.load_schema_list = load_schema_list;
-	session->adapter_handle.load_table_list = load_table_list;
-	session->adapter_handle.load_column_list = load_column_list;
-	session->adapter_handle.perform_query = perform_query;
+	return feed->poll_mode ? poll_fingerprint_feed(feed, schema, changes, max) : poll_notify_feed(feed, changes, max);
+}
+static void close_change_feed(void *feed_handle, struct dbt_adapter *adapter) {
+	struct psql_change_feed *feed = (struct psql_change_feed *)feed_handle;
+	if (!feed) return;
+
+	feed_clear_snapshot(feed);
+	PQclear(feed->pending_result);
+	free(feed->pending_schema);
+	PQfinish(feed->conn);
+	free(feed);
+}
 
 
+static int dbt_adapter_psql_init(json_t *server_info, struct dbt_adapter *adapter) {
 	/* Check input */
-	if (!session || !session->current_server) return;
+	if (!server_info || !adapter) return 1;
 
 
-	/* Load connection details */
-	const char *host = json_string_value(json_object_get(session->current_server, "host"));
-	const char *user = json_string_value(json_object_get(session->current_server, "user"));
-	const char *pass = json_string_value(json_object_get(session->current_server, "pass"));
+	/* Init values */
+	adapter->conn_handle = 0;
+	adapter->db_conn_handle = 0;
+	adapter->load_database_list = load_database_list;
+	adapter->connect_to_db = connect_to_db;
+	adapter->load_schema_list = load_schema_list;
+	adapter->load_table_list = load_table_list;
+	adapter->load_column_list = load_column_list;
+	adapter->perform_query = perform_query;
+	adapter->load_table_properties = load_table_properties;
+	adapter->open_connection = open_connection;
+	adapter->start_connection = start_connection;
+	adapter->poll_connection = poll_connection;
+	adapter->close_connection = close_connection;
+	adapter->connection_fd = connection_fd;
+	adapter->send_query = send_query;
+	adapter->poll_query = poll_query;
+	adapter->fetch_more = fetch_more;
+	adapter->check_connection = check_connection;
+	adapter->poll_check = poll_check;
+	adapter->reset_connection = reset_connection;
+	adapter->poll_reset = poll_reset;
+	adapter->restore_connection = restore_connection;
+	adapter->cancel_query = cancel_query;
+	adapter->install_change_feed = install_change_feed;
+	adapter->open_change_feed = open_change_feed;
+	adapter->change_feed_fd = change_feed_fd;
+	adapter->poll_change_feed = poll_change_feed;
+	adapter->close_change_feed = close_change_feed;
+	adapter->plan_export = plan_export;
+	adapter->start_export = start_export;
+	adapter->read_export = read_export;
+	adapter->release_export_data = release_export_data;
+	adapter->start_import = start_import;
+	adapter->write_import = write_import;
+	adapter->finish_import = finish_import;
+	adapter->pipeline_send = pipeline_send;
+	adapter->pipeline_poll = pipeline_poll;
+	adapter->pipeline_end = pipeline_end;
 
 
-	/* Connect to database */
-	PGconn *conn = PQsetdbLogin(host, 0, 0, 0, "postgres", user, pass);
-	if (PQstatus(conn) != CONNECTION_OK) {
-		/* TODO: handle */
-		return;
-	}
-	session->adapter_handle.conn_handle = conn;
-	session->adapter_handle.host = host;
-	session->adapter_handle.user = user;
-	session->adapter_handle.pass = pass;
+	/* Load connection details (server connection is opened on first catalog load) */
+	adapter->host = json_string_value(json_object_get(server_info, "host"));
+	adapter->user = json_string_value(json_object_get(server_info, "user"));
+	adapter->pass = json_string_value(json_object_get(server_info, "pass"));
+
 
+	/* Load safety policy ('row_limit' rows, 'statement_timeout' ms, 'read_only') and 'keepalive_idle' seconds */
+	adapter->row_limit = json_integer_value(json_object_get(server_info, "row_limit"));
+	adapter->statement_timeout = json_integer_value(json_object_get(server_info, "statement_timeout"));
+	adapter->read_only = json_is_true(json_object_get(server_info, "read_only"));
+	adapter->keepalive_idle = (int)json_integer_value(json_object_get(server_info, "keepalive_idle"));
 
-	return;
+
+	return 0;
 }
+
+
+/* Plugin descriptor (looked up with dlsym by dbt_adapter_init) */
+const struct dbt_adapter_plugin dbt_adapter_plugin = {
+	DBT_ADAPTER_ABI_VERSION,
+	sizeof(struct dbt_adapter),
+	"psql",
+	dbt_adapter_psql_init
+};
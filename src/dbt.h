@@ -3,6 +3,10 @@
 
 
 /* Dependencies */
+#include <stdint.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
 #include <ncurses.h>
 #include <jansson.h>
 
@@ -16,6 +20,38 @@
 #define DBT_VERSION "v0.1.0"
 #endif
 
+#define DBT_HISTORY_FAILED 0x1
+
+#define DBT_STRING_NONE UINT32_MAX
+#define DBT_RESULTSET_NULL(column, row) (((column)->nulls[(row) >> 3] >> ((row) & 7)) & 1)
+#define DBT_COLUMN_NULLABLE 0x1
+#define DBT_COLUMN_IDENTITY 0x2
+
+#define DBT_ADAPTER_ABI_VERSION 5
+
+#define DBT_TAB_MAX 7
+#define DBT_POLL_MAX 64
+
+#define DBT_DASHBOARD_TOP 5
+#define DBT_DASHBOARD_LINES 28
+
+#define DBT_PLAN_PREFIX "EXPLAIN (ANALYZE, BUFFERS, FORMAT JSON) "
+#define DBT_PLAN_ESTIMATE_PREFIX "EXPLAIN (FORMAT JSON) "
+#define DBT_PLAN_KEEP 64
+#define DBT_PLAN_HOT 3
+
+#define DBT_COMPLETE_MAX 64
+
+#define DBT_PROFILE_BATCH 10000
+#define DBT_PROFILE_HLL_BITS 12
+#define DBT_PROFILE_SKETCH_WIDTH 2048
+#define DBT_PROFILE_SKETCH_DEPTH 4
+#define DBT_PROFILE_TOP 8
+#define DBT_PROFILE_BINS 16
+
+#define DBT_EXPORT_MAX_JOBS 16
+#define DBT_IMPORT_QUEUE 4
+
 
 /* Enums */
 enum dbt_windows {
@@ -36,59 +72,677 @@ enum dbt_mode {
 	DBT_MODE_SCHEMA_SELECT,
 	DBT_MODE_TABLEVIEW_SELECT,
 	DBT_MODE_COLUMN_SELECT,
+	DBT_MODE_HISTORY_SEARCH,
+	DBT_MODE_FANOUT_SELECT,
+	DBT_MODE_RESULT_SORT,
+	DBT_MODE_RESULT_FILTER,
+	DBT_MODE_RESULT_GROUP,
+	DBT_MODE_WATCH_SELECT,
+	DBT_MODE_EXPORT_SELECT,
+	DBT_MODE_IMPORT_SELECT,
+	DBT_MODE_SNAPSHOT_SELECT,
 	DBT_MODE_QUERY
 };
+enum dbt_fanout_state {
+	DBT_FANOUT_PENDING,
+	DBT_FANOUT_CONNECTING,
+	DBT_FANOUT_RUNNING,
+	DBT_FANOUT_DONE,
+	DBT_FANOUT_FAILED
+};
+enum dbt_tab_state {
+	DBT_TAB_IDLE,
+	DBT_TAB_RUNNING,
+	DBT_TAB_DONE,
+	DBT_TAB_FAILED
+};
+
+enum dbt_complete_kind {
+	DBT_COMPLETE_KEYWORDS,
+	DBT_COMPLETE_SCHEMAS,
+	DBT_COMPLETE_TABLES,
+	DBT_COMPLETE_COLUMNS
+};
+enum dbt_memory_subsystem {
+	DBT_MEMORY_OTHER,
+	DBT_MEMORY_CONFIG,
+	DBT_MEMORY_RESULTS,
+	DBT_MEMORY_PROPERTIES,
+	DBT_MEMORY_DASHBOARD,
+	DBT_MEMORY_PLANS,
+	DBT_MEMORY_SUBSYSTEMS
+};
+
+enum dbt_link_state {
+	DBT_LINK_OK,
+	DBT_LINK_CHECKING,
+	DBT_LINK_BROKEN,
+	DBT_LINK_RESETTING,
+	DBT_LINK_RESTORING
+};
 
 
 /* Structs */
+struct dbt_strings {
+	char **blocks;
+	size_t block_count;
+	size_t block_used;
+	size_t block_size;
+
+	const char **values;
+	uint32_t *lengths;
+	uint32_t *hashes;
+	size_t count;
+	size_t cap;
+
+	uint32_t *slots;
+	size_t slot_cap;
+};
+struct dbt_complete {
+	/* Trie nodes (children sorted by lowercased byte, name is DBT_STRING_NONE on inner nodes) */
+	uint32_t *children;
+	uint32_t *siblings;
+	uint32_t *names;
+	uint8_t *bytes;
+	size_t count;
+	size_t cap;
+
+	/* One root per kind and owner (tables by schema, columns by schema and table) */
+	uint8_t *root_kinds;
+	uint32_t *root_schemas;
+	uint32_t *root_tables;
+	uint32_t *roots;
+	size_t root_count;
+	size_t root_cap;
+
+	int shown;
+};
+struct dbt_name_list {
+	uint32_t *names;
+	size_t count;
+	size_t cap;
+};
+struct dbt_column_table {
+	uint32_t *names;
+	uint32_t *datatypes;
+	int32_t *max_lengths;
+	uint8_t *flags;
+	size_t count;
+	size_t cap;
+};
+struct dbt_catalog_change {
+	char op;
+	char schema[64];
+	char table[64];
+};
 struct dbt_adapter {
 	void *conn_handle;
 	void *db_conn_handle;
 
+	/* Why the last connection failed (shown in the query window while there is no catalog connection) */
+	char connect_error[160];
+
 	const char *host;
 	const char *user;
 	const char *pass;
 
-	json_t *(*load_database_list)(struct dbt_adapter *self);
-	void (*connect_to_db)(const char *database, struct dbt_adapter *self);
-	json_t *(*load_schema_list)(struct dbt_adapter *self);
-	json_t *(*load_table_list)(const char *schema, struct dbt_adapter *self);
-	json_t *(*load_column_list)(const char *schema, const char *table, struct dbt_adapter *self);
+	/* Safety policy from server config (0 disables), applied to every connection the adapter opens */
+	int64_t row_limit;
+	int64_t statement_timeout;
+	int read_only;
+	int keepalive_idle;
+
+	/* Functions of the loaded backend while a trace is recorded (copies of a wrapped adapter keep it) */
+	const struct dbt_adapter *traced;
+
+	/* Catalog loaders intern names into the session string pool */
+	int (*load_database_list)(struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *self);
+	int (*connect_to_db)(const char *database, struct dbt_adapter *self);
+	int (*load_schema_list)(struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *self);
+	int (*load_table_list)(const char *schema, struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *self);
+	int (*load_column_list)(const char *schema, const char *table, struct dbt_column_table *columns, struct dbt_strings *strings, struct dbt_adapter *self);
 
 	json_t *(*perform_query)(const char *query, struct dbt_adapter *self);
+	json_t *(*load_table_properties)(const char *schema, const char *table, struct dbt_adapter *self);
+
+	/* Async execution on dedicated connections (poll_query returns 1 while busy) */
+	void *(*open_connection)(const char *database, struct dbt_adapter *self);
+	void *(*start_connection)(const char *database, struct dbt_adapter *self);
+	int (*poll_connection)(void *conn, struct dbt_adapter *self);
+	void (*close_connection)(void *conn, struct dbt_adapter *self);
+	int (*connection_fd)(void *conn, struct dbt_adapter *self);
+	int (*send_query)(const char *query, void *conn, struct dbt_adapter *self);
+	int (*poll_query)(void *conn, json_t **result, struct dbt_adapter *self);
+	int (*fetch_more)(void *conn, json_t *result, struct dbt_adapter *self);
+
+	/* Supervision: health check snapshots session state, check and restore are sent and answered through poll_check, reset is non-blocking (poll_reset like poll_connection) */
+	int (*check_connection)(void *conn, struct dbt_adapter *self);
+	int (*poll_check)(void *conn, json_t **state, struct dbt_adapter *self);
+	int (*reset_connection)(void *conn, struct dbt_adapter *self);
+	int (*poll_reset)(void *conn, struct dbt_adapter *self);
+	int (*restore_connection)(void *conn, json_t *state, size_t *step, struct dbt_adapter *self);
+	int (*cancel_query)(void *conn, struct dbt_adapter *self);
+
+	/* Catalog change feed ('notify' or 'poll' mode, change_feed_fd is -1 while poll mode waits for its next round) */
+	int (*install_change_feed)(struct dbt_adapter *self);
+	void *(*open_change_feed)(const char *database, const char *mode, struct dbt_adapter *self);
+	int (*change_feed_fd)(void *feed, struct dbt_adapter *self);
+	size_t (*poll_change_feed)(void *feed, const char *schema, struct dbt_catalog_change *changes, size_t max, struct dbt_adapter *self);
+	void (*close_change_feed)(void *feed, struct dbt_adapter *self);
+
+	/* Parallel export: plan_export pins a snapshot on its connection and splits the table into range predicates,
+	   start_export copies one range (importing the snapshot on a worker's first range), read_export returns row length
+	   (0 would block, -1 range done, -2 failed with message in data), rows are handed back with release_export_data */
+	json_t *(*plan_export)(const char *schema, const char *table, const char *key, size_t range_count, void *conn, struct dbt_adapter *self);
+	int (*start_export)(const char *schema, const char *table, const char *snapshot, const char *predicate, int first, void *conn, struct dbt_adapter *self);
+	int (*read_export)(void *conn, int *copying, char **data, struct dbt_adapter *self);
+	void (*release_export_data)(char *data, struct dbt_adapter *self);
+
+	/* Bulk import: start_import enters COPY FROM STDIN (columns in file order, 0 for all), write_import queues one chunk
+	   once the previous one was sent (1 queued, 0 retry when writable, -1 failed), finish_import ends or aborts the copy
+	   (1 while busy, 0 committed, -1 failed), messages belong to the connection */
+	int (*start_import)(const char *schema, const char *table, json_t *columns, int csv, void *conn, char **message, struct dbt_adapter *self);
+	int (*write_import)(const char *data, size_t length, void *conn, char **message, struct dbt_adapter *self);
+	int (*finish_import)(const char *abort_reason, int *ended, void *conn, char **message, struct dbt_adapter *self);
+
+	/* Script pipeline: pipeline_send queues one statement and optionally a sync point after it (statement 0 for a bare
+	   sync), 0 sent, 1 retry when writable, -1 failed; pipeline_poll returns 1 with a statement result, 2 at a sync
+	   point, 0 while waiting (*write_pending while output is queued), -1 failed; pipeline_end once every sync arrived */
+	int (*pipeline_send)(const char *statement, int sync, void *conn, struct dbt_adapter *self);
+	int (*pipeline_poll)(void *conn, int *write_pending, json_t **result, struct dbt_adapter *self);
+	int (*pipeline_end)(void *conn, struct dbt_adapter *self);
+};
+struct dbt_adapter_plugin {
+	/* Exported by adapter shared objects as 'dbt_adapter_plugin' */
+	int abi_version;
+	size_t adapter_size;
+	const char *type;
+	int (*init)(json_t *server_info, struct dbt_adapter *adapter);
+};
+struct dbt_list_view {
+	size_t offset;
+	size_t cursor;
+};
+struct dbt_config {
+	char *path;
+	json_t *root;
+	int parse_failed;
+
+	/* Server index in config order (name/type offset pairs into strings), mapped from cache or built after a parse */
+	void *map;
+	size_t map_size;
+	int map_owned;
+	const uint32_t *server_offsets;
+	const char *server_strings;
+	size_t server_count;
+};
+struct dbt_history_postings {
+	uint32_t *entries;
+	uint32_t count;
+	uint32_t cap;
+};
+struct dbt_history {
+	int fd;
+	void *map;
+	size_t map_size;
+
+	size_t *entries;
+	size_t entry_count;
+	size_t entry_cap;
+	size_t indexed_end;
+
+	size_t *prefix_index;
+	int prefix_ready;
+
+	/* Substring index: ascending entry indices per hashed query trigram (built on first substring search) */
+	struct dbt_history_postings *trigrams;
+	int trigram_ready;
+};
+struct dbt_resultset_column {
+	char *name;
+	const char **values;
+	uint32_t *lengths;
+	double *numbers;
+	uint8_t *nulls;
+	int is_numeric;
+	int display_width;
+};
+struct dbt_resultset {
+	size_t column_count;
+	size_t row_count;
+	struct dbt_resultset_column *columns;
+	char *arena;
+	size_t arena_size;
+
+	/* Snapshot file values point into (read-only, unmapped on free) */
+	void *mapping;
+	size_t mapping_size;
+
+	uint32_t *view;
+	size_t view_count;
+	size_t view_offset;
+	int format_ready;
+
+	/* Derived results (group, diff) own their source */
+	struct dbt_resultset *source;
+	const char *kind;
+};
+struct dbt_resultset_diff_counts {
+	size_t added;
+	size_t removed;
+	size_t changed;
+	size_t unchanged;
+};
+struct dbt_fanout_target {
+	const char *server_name;
+	char *database;
+
+	struct dbt_adapter adapter;
+	void *conn_handle;
+	short int events;
+
+	enum dbt_fanout_state state;
+	struct timespec started;
+	uint64_t duration_us;
+	json_t *result;
+};
+struct dbt_fanout {
+	char *spec;
+	char *query;
+	size_t concurrency;
+
+	struct dbt_fanout_target *targets;
+	size_t target_count;
+};
+struct dbt_plan_node {
+	char *label;
+	int depth;
+
+	/* Times in ms and buffers are totals over all loops; self excludes children */
+	double total_ms;
+	double self_ms;
+	double actual_rows;
+	double plan_rows;
+	double loops;
+	int64_t shared_hit;
+	int64_t shared_read;
+	int64_t self_hit;
+	int64_t self_read;
+};
+struct dbt_plan {
+	char *query;
+	double planning_ms;
+	double execution_ms;
+	int estimated;
+
+	/* Nodes in preorder, hot holds indices of the nodes with most self time */
+	struct dbt_plan_node *nodes;
+	size_t node_count;
+	size_t hot[DBT_PLAN_HOT];
+	size_t hot_count;
+	size_t view_offset;
+
+	struct dbt_plan *previous;
+};
+struct dbt_script_statement {
+	const char *text;
+	int isolated;
+	int ends_transaction;
+
+	struct timespec sent;
+	uint64_t duration_us;
+	json_t *result;
+};
+struct dbt_script {
+	char *text;
+	struct dbt_script_statement *statements;
+	size_t count;
+	int continue_on_error;
+
+	struct dbt_adapter *adapter;
+	void *conn_handle;
+	short int events;
+
+	/* Statements in [next_result, next_send) are on the wire, sync points close groups of them */
+	size_t next_send;
+	size_t next_result;
+	size_t pending_syncs;
+	int group_open;
+	size_t commit_mark;
+	int stopping;
+	size_t failed_count;
+	json_t *pending;
+	struct timespec started;
+	struct timespec last_result;
+	char *error;
+	int needs_reset;
+};
+struct dbt_link {
+	enum dbt_link_state state;
+	int attempts;
+	struct timespec last_check;
+	struct timespec next_attempt;
+	struct timespec reset_started;
+	int reset_wants;
+	size_t restore_step;
+
+	/* Last health check round trip and reconnect duration */
+	uint64_t latency_us;
+	uint64_t reconnect_us;
+
+	/* search_path and SQL prepared statements seen by last health check */
+	json_t *session_state;
+};
+struct dbt_tab {
+	char *q_buffer;
+	size_t q_buffer_head;
+
+	struct dbt_adapter adapter;
+	void *conn_handle;
+	struct dbt_link link;
+	json_t *server;
+	const char *server_name;
+	char *database;
+
+	enum dbt_tab_state state;
+	int unseen;
+	char *running_query;
+	struct timespec started;
+	uint64_t duration_us;
+	json_t *pending;
+	json_t *result;
+	struct dbt_resultset *resultset;
+	struct dbt_fanout *fanout;
+	struct dbt_script *script;
+
+	int explain;
+	struct dbt_plan *plan;
+
+	/* Profiled run folds its batches into the profile and drops them (row limit is the batch size until it finishes) */
+	int profiling;
+	int row_limit;
+
+	/* Result stopped at the row limit, remaining rows wait on the connection (partial: merged fan-out rows cut by the limit) */
+	int more;
+	int partial;
+};
+struct dbt_watch {
+	struct dbt_adapter adapter;
+	void *feed;
+	char mode[8];
+
+	int interval_ms;
+	struct timespec last_poll;
+};
+struct dbt_dashboard_snapshot {
+	/* Sorted keys with two cumulative counters each */
+	int64_t *keys;
+	double *values;
+	size_t count;
+	struct timespec taken;
+};
+struct dbt_dashboard {
+	struct dbt_adapter adapter;
+	void *conn_handle;
+	struct dbt_link link;
+	int active;
+	int phase;
+	int busy;
+	json_t *pending;
+
+	int interval_ms;
+	struct timespec last_poll;
+
+	struct dbt_dashboard_snapshot statements;
+	struct dbt_dashboard_snapshot tables;
+
+	char lines[DBT_DASHBOARD_LINES][160];
+	size_t line_count;
+};
+struct dbt_profile_column {
+	char *name;
+	uint64_t nulls;
+
+	/* Range (numeric while every value parses as a finite number, text compares bytewise) */
+	int numeric;
+	double min_number;
+	double max_number;
+	char *min_text;
+	size_t min_length;
+	char *max_text;
+	size_t max_length;
+
+	/* Distinct estimate (HyperLogLog registers) */
+	uint8_t registers[1 << DBT_PROFILE_HLL_BITS];
+
+	/* Frequent values (count-min estimates, lowest candidate is replaced) */
+	uint32_t sketch[DBT_PROFILE_SKETCH_DEPTH][DBT_PROFILE_SKETCH_WIDTH];
+	char *top_values[DBT_PROFILE_TOP];
+	uint32_t top_counts[DBT_PROFILE_TOP];
+	size_t top_count;
+
+	/* Numeric histogram (bins double in width as the range grows) */
+	double bin_low;
+	double bin_width;
+	uint64_t bins[DBT_PROFILE_BINS];
+};
+struct dbt_properties {
+	/* Statistics of the shown table, its sampled preview is added once the background query returns */
+	json_t *table;
+	unsigned int generation;
+
+	/* Dedicated preview connection (kept between tables of one database), queued query waits for the one in flight */
+	struct dbt_adapter adapter;
+	void *conn_handle;
+	char *database;
+	int busy;
+	unsigned int sent_generation;
+	char *queued;
+	json_t *pending;
+};
+struct dbt_memory_view {
+	int active;
+	struct timespec last_render;
+};
+struct dbt_profile {
+	/* Batches of the tab's running query, dropped once folded */
+	int active;
+	size_t tab_ind;
+
+	struct dbt_profile_column *columns;
+	size_t column_count;
+	uint64_t rows;
+
+	struct timespec started;
+	struct timespec last_render;
+	uint64_t duration_us;
+	char message[128];
+};
+struct dbt_export_worker {
+	void *conn_handle;
+	short int events;
+	int connecting;
+	int copying;
+	size_t range;
+	size_t ranges_done;
+	FILE *out;
+};
+struct dbt_export {
+	struct dbt_adapter adapter;
+	void *coordinator;
+	json_t *plan;
+	int active;
+	int failed;
+
+	char schema[64];
+	char table[64];
+	char *path;
+	FILE *merged;
+
+	struct dbt_export_worker workers[DBT_EXPORT_MAX_JOBS];
+	size_t job_count;
+	size_t range_count;
+	size_t next_range;
+	size_t ranges_done;
+
+	uint64_t rows;
+	uint64_t bytes;
+	struct timespec started;
+	struct timespec last_render;
+	uint64_t duration_us;
+	char message[160];
+};
+struct dbt_import_chunk {
+	char *data;
+	size_t length;
+	size_t rows;
+};
+struct dbt_import {
+	struct dbt_adapter adapter;
+	void *conn_handle;
+	short int events;
+	int active;
+	int failed;
+	int ending;
+	int ended;
+
+	char schema[64];
+	char table[64];
+	char *path;
+	FILE *file;
+	int csv;
+	size_t expected_fields;
+	uint64_t file_size;
+
+	/* Reader thread fills the queue (bounded), the event loop sends; wake pipe makes poll() see new chunks */
+	pthread_t reader;
+	int reader_started;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct dbt_import_chunk queue[DBT_IMPORT_QUEUE];
+	size_t queue_head;
+	size_t queue_count;
+	int reader_done;
+	int stop;
+	char reader_error[128];
+	int wake_fds[2];
+
+	struct dbt_import_chunk sending;
+	uint64_t rows;
+	uint64_t bytes;
+	struct timespec started;
+	struct timespec last_render;
+	uint64_t duration_us;
+	char message[160];
 };
 struct dbt_session {
 	WINDOW *app_windows[DBT_WIN_MAX]; 
 
+	/* List panes (servers to columns) scroll independently, keys act on the focused one */
+	struct dbt_list_view list_views[DBT_WIN_COLUMNS + 1];
+	enum dbt_windows list_focus;
+
 	enum dbt_mode mode;
 	char input_buffer[64];
 	short int buffer_head;
 
-	char *q_buffers[7];
-	size_t q_buffer_head;
-	short int q_buffer_ind;
+	struct dbt_tab tabs[DBT_TAB_MAX];
+	short int tab_ind;
 
-	json_t *config;
+	struct dbt_config config;
 	json_t *current_server;
-	json_t *database_list;
+	const char *current_server_name;
+
+	/* Catalog names are interned, so current_* stay valid across list refreshes */
+	struct dbt_strings strings;
+	struct dbt_name_list database_list;
 	const char *current_database;
-	json_t *schema_list;
+	struct dbt_name_list schema_list;
 	const char *current_schema;
-	json_t *table_list;
+	struct dbt_name_list table_list;
 	const char *current_table;
-	json_t *column_list;
+	struct dbt_column_table column_list;
 	const char *current_column;
+	struct dbt_complete complete;
 
 	struct dbt_adapter adapter_handle;
+	struct dbt_link link;
+	struct dbt_history history;
+	struct dbt_watch watch;
+	struct dbt_dashboard dashboard;
+	struct dbt_export export;
+	struct dbt_import import;
+	struct dbt_profile profile;
+	struct dbt_properties properties;
+	struct dbt_memory_view memory;
+
+	/* Plans owned here (oldest dropped first), tabs only point into it */
+	struct dbt_plan *plans[DBT_PLAN_KEEP];
+	size_t plan_count;
 };
 
 
 /* Functions */
 int dbt_session_init(const char *config_path, struct dbt_session *session);
 int dbt_session_handle_input(int input, struct dbt_session *session);
+int dbt_session_refresh_query(struct dbt_session *session);
+int dbt_session_poll(int timeout, struct dbt_session *session);
 
 
-void dbt_adapter_psql_init(struct dbt_session *session);
+uint32_t dbt_strings_intern(struct dbt_strings *strings, const char *value, size_t length);
+const char *dbt_strings_get(const struct dbt_strings *strings, uint32_t id);
+int dbt_strings_rebuild(struct dbt_strings *strings, uint32_t *ids, size_t count);
+void dbt_strings_free(struct dbt_strings *strings);
+
+
+int dbt_catalog_names_append(struct dbt_name_list *list, uint32_t name);
+void dbt_catalog_names_free(struct dbt_name_list *list);
+int dbt_catalog_columns_append(struct dbt_column_table *columns, uint32_t name, uint32_t datatype, int32_t max_length, uint8_t flags);
+void dbt_catalog_columns_free(struct dbt_column_table *columns);
+
+
+int dbt_adapter_init(json_t *server_info, struct dbt_adapter *adapter);
+void dbt_adapter_close(struct dbt_adapter *adapter);
+void dbt_adapter_unload(void);
+
+
+int dbt_complete_names(enum dbt_complete_kind kind, const char *schema, const char *table, const uint32_t *names, size_t count, int replace, struct dbt_session *session);
+int dbt_complete_remove(enum dbt_complete_kind kind, const char *schema, const char *table, const char *name, struct dbt_session *session);
+int dbt_complete_query(struct dbt_session *session);
+void dbt_complete_clear(struct dbt_session *session);
+void dbt_complete_reset(struct dbt_session *session);
+void dbt_complete_free(struct dbt_complete *complete);
+
+void dbt_memory_init(void);
+enum dbt_memory_subsystem dbt_memory_scope(enum dbt_memory_subsystem subsystem);
+int dbt_memory_toggle(struct dbt_session *session);
+int dbt_memory_service(struct dbt_session *session);
+
+int dbt_trace_start(const char *record_path, const char *replay_path, int fast);
+int dbt_trace_replaying(void);
+void dbt_trace_wrap(struct dbt_adapter *adapter);
+int dbt_trace_replay_init(json_t *server_info, struct dbt_adapter *adapter);
+void dbt_trace_key(int input);
+int dbt_trace_next_key(int *input, int *wait_ms);
+void dbt_trace_handled(const struct timespec *since);
+int dbt_trace_close(FILE *report);
+
+
+int dbt_config_open(const char *path, struct dbt_config *config);
+json_t *dbt_config_get(struct dbt_config *config);
+size_t dbt_config_server_find(const char *name, const struct dbt_config *config);
+const char *dbt_config_server_name(const struct dbt_config *config, size_t ind);
+const char *dbt_config_server_type(const struct dbt_config *config, size_t ind);
+void dbt_config_close(struct dbt_config *config);
+
+
+int dbt_list_render(enum dbt_windows pane, struct dbt_session *session);
+int dbt_list_reset(enum dbt_windows pane, struct dbt_session *session);
+int dbt_list_reveal(enum dbt_windows pane, size_t ind, struct dbt_session *session);
+int dbt_list_focus(enum dbt_windows pane, struct dbt_session *session);
+int dbt_list_scroll(long rows, struct dbt_session *session);
+int dbt_list_page(int direction, struct dbt_session *session);
+int dbt_list_activate(struct dbt_session *session);
 
 
 int dbt_servers_refresh(struct dbt_session *session);
@@ -105,10 +759,123 @@ int dbt_schemas_select(const char *schema, struct dbt_session *session);
 
 int dbt_tables_refresh(struct dbt_session *session);
 int dbt_tables_select(const char *tables, struct dbt_session *session);
+int dbt_properties_refresh(struct dbt_session *session);
+void dbt_properties_stop(struct dbt_session *session);
+size_t dbt_properties_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session);
+int dbt_properties_service(struct dbt_session *session);
+int dbt_tables_apply_change(const struct dbt_catalog_change *change, struct dbt_session *session);
 
 
 int dbt_columns_refresh(struct dbt_session *session);
 int dbt_columns_select(const char *columns, struct dbt_session *session);
 
 
+int dbt_history_load(struct dbt_session *session);
+int dbt_history_append(const char *query, const char *server, const char *database, uint64_t duration_us, uint64_t row_count, int failed, struct dbt_session *session);
+int dbt_history_search(const char *pattern, struct dbt_session *session);
+void dbt_history_close(struct dbt_session *session);
+
+
+int dbt_watch_start(const char *mode, struct dbt_session *session);
+void dbt_watch_stop(struct dbt_session *session);
+int dbt_watch_command(const char *input, struct dbt_session *session);
+size_t dbt_watch_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session);
+int dbt_watch_service(struct dbt_session *session);
+
+
+int dbt_dashboard_toggle(struct dbt_session *session);
+void dbt_dashboard_stop(struct dbt_session *session);
+size_t dbt_dashboard_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session);
+int dbt_dashboard_service(struct dbt_session *session);
+
+
+int dbt_export_command(const char *input, struct dbt_session *session);
+void dbt_export_stop(struct dbt_session *session);
+size_t dbt_export_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session);
+int dbt_export_service(struct dbt_session *session);
+
+
+int dbt_import_command(const char *input, struct dbt_session *session);
+void dbt_import_stop(struct dbt_session *session);
+size_t dbt_import_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session);
+int dbt_import_service(struct dbt_session *session);
+
+
+int dbt_profile_toggle(struct dbt_session *session);
+void dbt_profile_stop(struct dbt_session *session);
+int dbt_profile_service(struct dbt_session *session);
+int dbt_profile_fold(struct dbt_tab *tab, struct dbt_session *session);
+
+
+int dbt_snapshot_save(const struct dbt_resultset *resultset, const char *path, size_t *bytes);
+struct dbt_resultset *dbt_snapshot_load(const char *path);
+int dbt_snapshot_command(const char *input, struct dbt_session *session);
+
+
+struct dbt_script *dbt_script_new(const char *text, int continue_on_error, struct dbt_adapter *adapter, void *conn);
+size_t dbt_script_collect_fds(struct dbt_script *script, struct pollfd *fds, size_t max);
+int dbt_script_poll(struct dbt_script *script, json_t **result, struct dbt_session *session);
+int dbt_script_cancel(struct dbt_script *script);
+void dbt_script_free(struct dbt_script *script);
+
+
+void dbt_supervisor_reset(struct dbt_link *link);
+size_t dbt_supervisor_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session);
+int dbt_supervisor_service(struct dbt_session *session);
+void dbt_supervisor_describe(const struct dbt_link *link, char *out, size_t out_size);
+
+
+int dbt_tabs_execute(struct dbt_session *session);
+int dbt_tabs_explain(struct dbt_session *session);
+int dbt_tabs_select(short int tab, struct dbt_session *session);
+int dbt_tabs_cancel(struct dbt_session *session);
+int dbt_tabs_fetch_more(struct dbt_session *session);
+int dbt_tabs_script(struct dbt_session *session);
+int dbt_tabs_profile(int batch_rows, struct dbt_session *session);
+size_t dbt_tabs_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session);
+int dbt_tabs_service(struct dbt_session *session);
+void dbt_tabs_close(struct dbt_session *session);
+
+
+int dbt_fanout_execute(const char *spec, struct dbt_session *session);
+size_t dbt_fanout_collect_fds(struct dbt_fanout *fanout, struct pollfd *fds, size_t max);
+int dbt_fanout_poll(struct dbt_fanout *fanout, json_t **result, struct dbt_session *session);
+int dbt_fanout_cancel(struct dbt_fanout *fanout);
+int dbt_fanout_refresh(struct dbt_fanout *fanout, struct dbt_session *session);
+void dbt_fanout_free(struct dbt_fanout *fanout);
+
+
+struct dbt_resultset *dbt_resultset_alloc(size_t column_count, size_t row_count);
+struct dbt_resultset *dbt_resultset_from_json(json_t *result);
+void dbt_resultset_free(struct dbt_resultset *resultset);
+void dbt_resultset_reset(struct dbt_resultset *resultset);
+int dbt_resultset_find_column(const struct dbt_resultset *resultset, const char *name, size_t *column);
+int dbt_resultset_sort(struct dbt_resultset *resultset, size_t column, int descending);
+int dbt_resultset_filter(struct dbt_resultset *resultset, size_t column, char op, const char *pattern);
+struct dbt_resultset *dbt_resultset_group(struct dbt_resultset *resultset, size_t column);
+struct dbt_resultset *dbt_resultset_diff(struct dbt_resultset *resultset, const struct dbt_resultset *previous, const size_t *keys, size_t key_count, struct dbt_resultset_diff_counts *counts);
+
+
+int dbt_format_width(const char *value, uint32_t length);
+size_t dbt_format_cell(char *out, size_t out_size, const char *value, uint32_t length, int width, int right_align);
+void dbt_format_line(char *line, size_t line_size, int max_width, struct dbt_resultset *resultset, int64_t row);
+void dbt_format_measure(struct dbt_resultset *resultset);
+void dbt_format_widen(struct dbt_resultset *resultset, size_t offset, size_t count);
+
+
+int dbt_plan_analyzable(const char *query);
+struct dbt_plan *dbt_plan_from_json(const char *query, json_t *result);
+void dbt_plan_free(struct dbt_plan *plan);
+int dbt_plan_keep(struct dbt_plan *plan, struct dbt_session *session);
+int dbt_plan_refresh(struct dbt_plan *plan, struct dbt_session *session);
+void dbt_plan_close(struct dbt_session *session);
+
+
+int dbt_results_refresh(struct dbt_session *session);
+int dbt_results_scroll(int pages, struct dbt_session *session);
+int dbt_results_sort(const char *input, struct dbt_session *session);
+int dbt_results_filter(const char *input, struct dbt_session *session);
+int dbt_results_group(const char *input, struct dbt_session *session);
+
+
 #endif
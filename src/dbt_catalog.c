@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+
+int dbt_catalog_names_append(struct dbt_name_list *list, uint32_t name) {
+	/* Check input */
+	if (!list || name == DBT_STRING_NONE) return 1;
+
+
+	/* Grow */
+	if (list->count >= list->cap) {
+		size_t cap = list->cap ? list->cap * 2 : 64;
+		uint32_t *names = (uint32_t *)realloc(list->names, cap * sizeof(uint32_t));
+		if (!names) return 1;
+
+		list->names = names;
+		list->cap = cap;
+	}
+
+
+	/* Append */
+	list->names[list->count++] = name;
+
+
+	return 0;
+}
+
+
+void dbt_catalog_names_free(struct dbt_name_list *list) {
+	/* Check input */
+	if (!list) return;
+
+	free(list->names);
+	memset(list, 0, sizeof(*list));
+}
+
+
+int dbt_catalog_columns_append(struct dbt_column_table *columns, uint32_t name, uint32_t datatype, int32_t max_length, uint8_t flags) {
+	/* Check input */
+	if (!columns || name == DBT_STRING_NONE) return 1;
+
+
+	/* Grow every array together */
+	if (columns->count >= columns->cap) {
+		size_t cap = columns->cap ? columns->cap * 2 : 64;
+		uint32_t *names = (uint32_t *)realloc(columns->names, cap * sizeof(uint32_t));
+		if (names) columns->names = names;
+		uint32_t *datatypes = (uint32_t *)realloc(columns->datatypes, cap * sizeof(uint32_t));
+		if (datatypes) columns->datatypes = datatypes;
+		int32_t *max_lengths = (int32_t *)realloc(columns->max_lengths, cap * sizeof(int32_t));
+		if (max_lengths) columns->max_lengths = max_lengths;
+		uint8_t *flags_list = (uint8_t *)realloc(columns->flags, cap * sizeof(uint8_t));
+		if (flags_list) columns->flags = flags_list;
+		if (!names || !datatypes || !max_lengths || !flags_list) return 1;
+
+		columns->cap = cap;
+	}
+
+
+	/* Append */
+	size_t ind = columns->count++;
+	columns->names[ind] = name;
+	columns->datatypes[ind] = datatype;
+	columns->max_lengths[ind] = max_length;
+	columns->flags[ind] = flags;
+
+
+	return 0;
+}
+
+
+void dbt_catalog_columns_free(struct dbt_column_table *columns) {
+	/* Check input */
+	if (!columns) return;
+
+	free(columns->names);
+	free(columns->datatypes);
+	free(columns->max_lengths);
+	free(columns->flags);
+	memset(columns, 0, sizeof(*columns));
+}
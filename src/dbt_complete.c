@@ -0,0 +1,527 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_COMPLETE_REFS 16
+#define DBT_COMPLETE_IDENT 64
+
+
+/* Table referenced by the query so far (schema empty when unqualified) */
+struct dbt_complete_ref {
+	char schema[DBT_COMPLETE_IDENT];
+	char table[DBT_COMPLETE_IDENT];
+	char alias[DBT_COMPLETE_IDENT];
+};
+
+
+/* Keywords offered outside table position, also never taken as aliases (lowercase, completion follows typed case) */
+static const char *complete_keywords[] = {
+	"all", "alter", "analyze", "and", "as", "asc", "begin", "between", "by", "case", "commit", "create", "cross",
+	"delete", "desc", "distinct", "drop", "else", "end", "except", "exists", "explain", "false", "fetch", "from",
+	"full", "group", "having", "ilike", "in", "inner", "insert", "intersect", "into", "is", "join", "lateral",
+	"left", "like", "limit", "natural", "not", "null", "offset", "on", "or", "order", "outer", "over", "partition",
+	"returning", "right", "rollback", "select", "set", "table", "then", "true", "truncate", "union", "update",
+	"using", "values", "when", "where", "window", "with", 0
+};
+
+
+/* Helper functions */
+static inline uint8_t complete_fold(unsigned char byte) {
+	return byte >= 'A' && byte <= 'Z' ? byte + ('a' - 'A') : byte;
+}
+
+static inline int complete_ident_char(unsigned char c) {
+	return isalnum(c) || c == '_' || c == '$' || c >= 0x80;
+}
+
+static int complete_is_keyword(const char *word) {
+	for (size_t i=0; complete_keywords[i]; i++) {
+		if (!strcasecmp(word, complete_keywords[i])) return 1;
+	}
+
+	return 0;
+}
+
+static uint32_t complete_node_new(struct dbt_complete *complete, uint8_t byte) {
+	/* Grow every array together */
+	if (complete->count >= complete->cap) {
+		size_t cap = complete->cap ? complete->cap * 2 : 4096;
+		uint32_t *children = (uint32_t *)realloc(complete->children, cap * sizeof(uint32_t));
+		if (children) complete->children = children;
+		uint32_t *siblings = (uint32_t *)realloc(complete->siblings, cap * sizeof(uint32_t));
+		if (siblings) complete->siblings = siblings;
+		uint32_t *names = (uint32_t *)realloc(complete->names, cap * sizeof(uint32_t));
+		if (names) complete->names = names;
+		uint8_t *bytes = (uint8_t *)realloc(complete->bytes, cap * sizeof(uint8_t));
+		if (bytes) complete->bytes = bytes;
+		if (!children || !siblings || !names || !bytes) return DBT_STRING_NONE;
+
+		complete->cap = cap;
+	}
+
+
+	/* Append leaf */
+	uint32_t node = (uint32_t)complete->count++;
+	complete->children[node] = DBT_STRING_NONE;
+	complete->siblings[node] = DBT_STRING_NONE;
+	complete->names[node] = DBT_STRING_NONE;
+	complete->bytes[node] = byte;
+
+
+	return node;
+}
+
+static uint32_t complete_child(struct dbt_complete *complete, uint32_t node, uint8_t byte, int create) {
+	/* Children are sorted, so walks list names in order */
+	uint32_t prev = DBT_STRING_NONE, child = complete->children[node];
+	while (child != DBT_STRING_NONE && complete->bytes[child] < byte) {
+		prev = child;
+		child = complete->siblings[child];
+	}
+	if (child != DBT_STRING_NONE && complete->bytes[child] == byte) return child;
+	else if (!create) return DBT_STRING_NONE;
+
+
+	/* Link new child in place */
+	uint32_t added = complete_node_new(complete, byte);
+	if (added == DBT_STRING_NONE) return DBT_STRING_NONE;
+
+	complete->siblings[added] = child;
+	if (prev == DBT_STRING_NONE) complete->children[node] = added;
+	else complete->siblings[prev] = added;
+
+
+	return added;
+}
+
+static uint32_t complete_walk(struct dbt_complete *complete, uint32_t node, const char *prefix, size_t length, int create) {
+	/* Case-insensitive path (DBT_STRING_NONE when nothing starts with prefix) */
+	for (size_t i=0; i < length && node != DBT_STRING_NONE; i++) node = complete_child(complete, node, complete_fold((unsigned char)prefix[i]), create);
+
+	return node;
+}
+
+static uint32_t complete_root(struct dbt_complete *complete, enum dbt_complete_kind kind, uint32_t schema, uint32_t table) {
+	/* Reuse root of this owner */
+	for (size_t i=0; i < complete->root_count; i++) {
+		if (complete->root_kinds[i] == kind && complete->root_schemas[i] == schema && complete->root_tables[i] == table) return complete->roots[i];
+	}
+
+
+	/* Grow root arrays together */
+	if (complete->root_count >= complete->root_cap) {
+		size_t cap = complete->root_cap ? complete->root_cap * 2 : 64;
+		uint8_t *kinds = (uint8_t *)realloc(complete->root_kinds, cap * sizeof(uint8_t));
+		if (kinds) complete->root_kinds = kinds;
+		uint32_t *schemas = (uint32_t *)realloc(complete->root_schemas, cap * sizeof(uint32_t));
+		if (schemas) complete->root_schemas = schemas;
+		uint32_t *tables = (uint32_t *)realloc(complete->root_tables, cap * sizeof(uint32_t));
+		if (tables) complete->root_tables = tables;
+		uint32_t *roots = (uint32_t *)realloc(complete->roots, cap * sizeof(uint32_t));
+		if (roots) complete->roots = roots;
+		if (!kinds || !schemas || !tables || !roots) return DBT_STRING_NONE;
+
+		complete->root_cap = cap;
+	}
+
+	uint32_t root = complete_node_new(complete, 0);
+	if (root == DBT_STRING_NONE) return DBT_STRING_NONE;
+
+	complete->root_kinds[complete->root_count] = kind;
+	complete->root_schemas[complete->root_count] = schema;
+	complete->root_tables[complete->root_count] = table;
+	complete->roots[complete->root_count++] = root;
+
+
+	return root;
+}
+
+static uint32_t complete_root_find(const struct dbt_session *session, enum dbt_complete_kind kind, const char *schema, const char *table) {
+	/* Owner by name (null schema matches any), typing must not intern anything */
+	const struct dbt_complete *complete = &session->complete;
+	for (size_t i=0; i < complete->root_count; i++) {
+		if (complete->root_kinds[i] != kind) continue;
+
+		const char *root_schema = dbt_strings_get(&session->strings, complete->root_schemas[i]);
+		const char *root_table = dbt_strings_get(&session->strings, complete->root_tables[i]);
+		if (schema && (!root_schema || strcmp(root_schema, schema))) continue;
+		else if (table && (!root_table || strcmp(root_table, table))) continue;
+
+		return complete->roots[i];
+	}
+
+
+	return DBT_STRING_NONE;
+}
+
+static void complete_clear_names(struct dbt_complete *complete, uint32_t node) {
+	/* Names go, nodes stay (a reloaded list mostly reuses the same paths) */
+	complete->names[node] = DBT_STRING_NONE;
+	for (uint32_t child = complete->children[node]; child != DBT_STRING_NONE; child = complete->siblings[child]) complete_clear_names(complete, child);
+}
+
+static size_t complete_collect(const struct dbt_complete *complete, uint32_t node, uint32_t *names, size_t count, size_t max) {
+	/* Depth first in byte order, stops at max (same name from another root is listed once) */
+	if (complete->names[node] != DBT_STRING_NONE && count < max) {
+		size_t i = 0;
+		while (i < count && names[i] != complete->names[node]) i++;
+		if (i == count) names[count++] = complete->names[node];
+	}
+
+	for (uint32_t child = complete->children[node]; child != DBT_STRING_NONE && count < max; child = complete->siblings[child]) count = complete_collect(complete, child, names, count, max);
+
+
+	return count;
+}
+
+static size_t complete_unique(const struct dbt_complete *complete, uint32_t node) {
+	/* Bytes shared by everything below node (single-child chain) */
+	size_t length = 0;
+	while (complete->names[node] == DBT_STRING_NONE && complete->children[node] != DBT_STRING_NONE && complete->siblings[complete->children[node]] == DBT_STRING_NONE) {
+		node = complete->children[node];
+		length++;
+	}
+
+	return length;
+}
+
+static void complete_copy(char *out, const char *ident, int quoted) {
+	/* Unquoted identifiers fold to lowercase like the server does */
+	size_t i = 0;
+	for (; ident[i] && i + 1 < DBT_COMPLETE_IDENT; i++) out[i] = quoted ? ident[i] : (char)complete_fold((unsigned char)ident[i]);
+	out[i] = 0;
+}
+
+static size_t complete_scan(const char *query, size_t length, struct dbt_complete_ref *refs, int *table_position) {
+	/* Reference state: after FROM/JOIN/..., after a table, after its schema dot, after AS, after an alias */
+	enum { SCAN_NONE, SCAN_TABLE, SCAN_QUALIFIED, SCAN_AFTER_TABLE, SCAN_ALIAS, SCAN_AFTER_ALIAS } state = SCAN_NONE;
+	int in_from = 0;
+	size_t ref_count = 0, i = 0;
+	while (i < length) {
+		char c = query[i];
+
+
+		/* Skip whitespace, literals and comments */
+		if (isspace((unsigned char)c)) {
+			i++;
+			continue;
+		} else if (c == '\'') {
+			for (i++; i < length && query[i] != '\''; i++);
+			i++;
+			state = SCAN_NONE;
+			continue;
+		} else if (c == '-' && i + 1 < length && query[i+1] == '-') {
+			while (i < length && query[i] != '\n') i++;
+			continue;
+		} else if (c == '/' && i + 1 < length && query[i+1] == '*') {
+			for (i += 2; i + 1 < length && (query[i] != '*' || query[i+1] != '/'); i++);
+			i += 2;
+			continue;
+		}
+
+
+		/* Read identifier (quoted ones keep their case), punctuation only moves the state */
+		char ident[DBT_COMPLETE_IDENT];
+		size_t ident_len = 0;
+		int quoted = c == '"';
+		if (quoted) {
+			for (i++; i < length && query[i] != '"'; i++) {
+				if (ident_len + 1 < sizeof(ident)) ident[ident_len++] = query[i];
+			}
+			i++;
+		} else if (complete_ident_char((unsigned char)c)) {
+			for (; i < length && complete_ident_char((unsigned char)query[i]); i++) {
+				if (ident_len + 1 < sizeof(ident)) ident[ident_len++] = query[i];
+			}
+		} else {
+			i++;
+			if (c == '.' && state == SCAN_AFTER_TABLE) state = SCAN_QUALIFIED;
+			else if (c == ',' && in_from && (state == SCAN_AFTER_TABLE || state == SCAN_AFTER_ALIAS)) state = SCAN_TABLE;
+			else state = SCAN_NONE;
+			continue;
+		}
+		ident[ident_len] = 0;
+
+
+		/* Advance reference */
+		int keyword = !quoted && complete_is_keyword(ident);
+		if (keyword && (!strcasecmp(ident, "from") || !strcasecmp(ident, "join") || !strcasecmp(ident, "update") || !strcasecmp(ident, "into") || !strcasecmp(ident, "table"))) {
+			state = SCAN_TABLE;
+			in_from = !strcasecmp(ident, "from");
+		} else if (keyword && state == SCAN_AFTER_TABLE && !strcasecmp(ident, "as")) state = SCAN_ALIAS;
+		else if (keyword) state = SCAN_NONE;
+		else if (state == SCAN_TABLE && ref_count < DBT_COMPLETE_REFS) {
+			memset(&refs[ref_count], 0, sizeof(refs[ref_count]));
+			complete_copy(refs[ref_count++].table, ident, quoted);
+			state = SCAN_AFTER_TABLE;
+		} else if (state == SCAN_QUALIFIED && ref_count) {
+			memcpy(refs[ref_count-1].schema, refs[ref_count-1].table, DBT_COMPLETE_IDENT);
+			complete_copy(refs[ref_count-1].table, ident, quoted);
+			state = SCAN_AFTER_TABLE;
+		} else if ((state == SCAN_AFTER_TABLE || state == SCAN_ALIAS) && ref_count) {
+			complete_copy(refs[ref_count-1].alias, ident, quoted);
+			state = SCAN_AFTER_ALIAS;
+		} else state = SCAN_NONE;
+	}
+
+	*table_position = state == SCAN_TABLE;
+
+
+	return ref_count;
+}
+
+static uint32_t complete_columns_root(const struct dbt_session *session, const char *schema, const char *table) {
+	/* Unqualified tables prefer the current schema */
+	if (schema && schema[0]) return complete_root_find(session, DBT_COMPLETE_COLUMNS, schema, table);
+
+	uint32_t root = session->current_schema ? complete_root_find(session, DBT_COMPLETE_COLUMNS, session->current_schema, table) : DBT_STRING_NONE;
+	return root != DBT_STRING_NONE ? root : complete_root_find(session, DBT_COMPLETE_COLUMNS, 0, table);
+}
+
+static void complete_show(const uint32_t *names, size_t count, struct dbt_session *session) {
+	/* Candidates on the bottom line, as many as fit */
+	move(LINES-1, 0);
+	clrtoeol();
+	if (!count) printw("no completions");
+
+	int x = 0;
+	for (size_t i=0; i < count; i++) {
+		const char *name = dbt_strings_get(&session->strings, names[i]);
+		int name_len = (int)strlen(name);
+		if (x + name_len + 6 > COLS) {
+			printw("...");
+			break;
+		}
+
+		printw("%s  ", name);
+		x += name_len + 2;
+	}
+
+	refresh();
+	session->complete.shown = 1;
+}
+
+static void complete_keywords_load(struct dbt_session *session) {
+	/* Keywords are interned once per trie */
+	uint32_t root = complete_root(&session->complete, DBT_COMPLETE_KEYWORDS, DBT_STRING_NONE, DBT_STRING_NONE);
+	for (size_t i=0; root != DBT_STRING_NONE && complete_keywords[i]; i++) {
+		uint32_t name = dbt_strings_intern(&session->strings, complete_keywords[i], strlen(complete_keywords[i]));
+		uint32_t node = complete_walk(&session->complete, root, complete_keywords[i], strlen(complete_keywords[i]), 1);
+		if (node != DBT_STRING_NONE) session->complete.names[node] = name;
+	}
+}
+
+
+
+
+int dbt_complete_names(enum dbt_complete_kind kind, const char *schema, const char *table, const uint32_t *names, size_t count, int replace, struct dbt_session *session) {
+	/* Check input */
+	if (!session || (count && !names)) return 1;
+	struct dbt_complete *complete = &session->complete;
+
+
+	/* Owner (names are already interned, so this only looks them up) */
+	uint32_t schema_id = schema ? dbt_strings_intern(&session->strings, schema, strlen(schema)) : DBT_STRING_NONE;
+	uint32_t table_id = table ? dbt_strings_intern(&session->strings, table, strlen(table)) : DBT_STRING_NONE;
+	uint32_t root = complete_root(complete, kind, schema_id, table_id);
+	if (root == DBT_STRING_NONE) return 1;
+
+
+	/* Reloaded lists replace what the owner had */
+	if (replace) complete_clear_names(complete, root);
+
+	for (size_t i=0; i < count; i++) {
+		const char *name = dbt_strings_get(&session->strings, names[i]);
+		uint32_t node = name ? complete_walk(complete, root, name, strlen(name), 1) : DBT_STRING_NONE;
+		if (node == DBT_STRING_NONE) return 1;
+
+		complete->names[node] = names[i];
+	}
+
+
+	return 0;
+}
+
+
+int dbt_complete_remove(enum dbt_complete_kind kind, const char *schema, const char *table, const char *name, struct dbt_session *session) {
+	/* Check input */
+	if (!name || !session) return 1;
+	struct dbt_complete *complete = &session->complete;
+
+
+	/* Drop exact name, path stays for later inserts */
+	uint32_t root = complete_root_find(session, kind, schema, table);
+	uint32_t node = root != DBT_STRING_NONE ? complete_walk(complete, root, name, strlen(name), 0) : DBT_STRING_NONE;
+	if (node == DBT_STRING_NONE || complete->names[node] == DBT_STRING_NONE) return 1;
+	else if (strcmp(dbt_strings_get(&session->strings, complete->names[node]), name)) return 1;
+
+	complete->names[node] = DBT_STRING_NONE;
+
+
+	return 0;
+}
+
+
+int dbt_complete_query(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	struct dbt_complete *complete = &session->complete;
+	if (!tab->q_buffer) return 1;
+
+	if (complete_root_find(session, DBT_COMPLETE_KEYWORDS, 0, 0) == DBT_STRING_NONE) complete_keywords_load(session);
+
+
+	/* Word before cursor (cursor stays at the end of the buffer), optionally qualified */
+	size_t head = tab->q_buffer_head, start = head;
+	while (start && (complete_ident_char((unsigned char)tab->q_buffer[start-1]) || tab->q_buffer[start-1] == '.')) start--;
+
+	size_t dot = head;
+	for (size_t i=start; i < head; i++) {
+		if (tab->q_buffer[i] == '.') dot = i;
+	}
+	const char *prefix = dot < head ? tab->q_buffer + dot + 1 : tab->q_buffer + start;
+	size_t prefix_len = tab->q_buffer + head - prefix;
+
+
+	/* Tables referenced before the word */
+	struct dbt_complete_ref refs[DBT_COMPLETE_REFS];
+	int table_position;
+	size_t ref_count = complete_scan(tab->q_buffer, start, refs, &table_position);
+
+
+	/* Pick roots by context */
+	uint32_t roots[DBT_COMPLETE_REFS + 2];
+	uint8_t root_keywords[DBT_COMPLETE_REFS + 2] = {0};
+	size_t root_count = 0;
+	if (dot < head) {
+		/* Qualifier is schema.table, an alias or table in FROM, a schema, or a table of the current schema */
+		char qualifier[2 * DBT_COMPLETE_IDENT] = {0};
+		char ident[DBT_COMPLETE_IDENT];
+		snprintf(ident, sizeof(ident), "%.*s", (int)(dot - start), tab->q_buffer + start);
+		complete_copy(qualifier, ident, 0);
+
+		char *inner_dot = strchr(qualifier, '.');
+		uint32_t root = DBT_STRING_NONE;
+		if (inner_dot) {
+			*inner_dot = 0;
+			root = complete_root_find(session, DBT_COMPLETE_COLUMNS, qualifier, inner_dot + 1);
+		}
+		for (size_t i=0; !inner_dot && root == DBT_STRING_NONE && i < ref_count; i++) {
+			if (!strcmp(refs[i].alias, qualifier) || (!refs[i].alias[0] && !strcmp(refs[i].table, qualifier))) root = complete_columns_root(session, refs[i].schema, refs[i].table);
+		}
+		if (!inner_dot && root == DBT_STRING_NONE) root = complete_root_find(session, DBT_COMPLETE_TABLES, qualifier, 0);
+		if (!inner_dot && root == DBT_STRING_NONE) root = complete_columns_root(session, 0, qualifier);
+		if (root != DBT_STRING_NONE) roots[root_count++] = root;
+	} else if (table_position) {
+		/* Tables of the current schema, or a schema to qualify with */
+		uint32_t tables = session->current_schema ? complete_root_find(session, DBT_COMPLETE_TABLES, session->current_schema, 0) : DBT_STRING_NONE;
+		uint32_t schemas = complete_root_find(session, DBT_COMPLETE_SCHEMAS, 0, 0);
+		if (tables != DBT_STRING_NONE) roots[root_count++] = tables;
+		if (schemas != DBT_STRING_NONE) roots[root_count++] = schemas;
+	} else {
+		/* Columns of referenced tables (current table until FROM is typed), then keywords */
+		for (size_t i=0; i < ref_count; i++) {
+			uint32_t root = complete_columns_root(session, refs[i].schema, refs[i].table);
+			if (root != DBT_STRING_NONE) roots[root_count++] = root;
+		}
+		if (!ref_count && session->current_table) {
+			uint32_t root = complete_columns_root(session, session->current_schema, session->current_table);
+			if (root != DBT_STRING_NONE) roots[root_count++] = root;
+		}
+
+		root_keywords[root_count] = 1;
+		roots[root_count++] = complete_root_find(session, DBT_COMPLETE_KEYWORDS, 0, 0);
+	}
+
+
+	/* Candidates below prefix, common part is shared by every root's subtree */
+	uint32_t names[DBT_COMPLETE_MAX];
+	size_t name_count = 0, common = 0;
+	const char *first = 0;
+	int first_keyword = 0;
+	for (size_t i=0; i < root_count; i++) {
+		uint32_t node = roots[i] != DBT_STRING_NONE ? complete_walk(complete, roots[i], prefix, prefix_len, 0) : DBT_STRING_NONE;
+		uint32_t first_name;
+		if (node == DBT_STRING_NONE || !complete_collect(complete, node, &first_name, 0, 1)) continue;
+		name_count = complete_collect(complete, node, names, name_count, DBT_COMPLETE_MAX);
+
+		const char *candidate = dbt_strings_get(&session->strings, first_name) + prefix_len;
+		size_t unique = complete_unique(complete, node);
+		if (!first) {
+			first = candidate;
+			first_keyword = root_keywords[i];
+			common = unique;
+			continue;
+		}
+
+		size_t shared = 0;
+		while (shared < common && candidate[shared] && complete_fold((unsigned char)candidate[shared]) == complete_fold((unsigned char)first[shared])) shared++;
+		common = shared < unique ? shared : unique;
+	}
+
+
+	/* Insert common part (keywords follow the case typed so far) */
+	int upper = first_keyword && prefix_len && isupper((unsigned char)prefix[prefix_len-1]);
+	for (size_t i=0; first && i < common && head < 4095; i++) tab->q_buffer[head++] = upper ? (char)toupper((unsigned char)first[i]) : first[i];
+	tab->q_buffer[head] = 0;
+	tab->q_buffer_head = head;
+
+
+	/* List candidates when still ambiguous, cursor back in query */
+	dbt_complete_clear(session);
+	if (name_count != 1) complete_show(names, name_count, session);
+	dbt_session_refresh_query(session);
+
+
+	return !first;
+}
+
+
+void dbt_complete_clear(struct dbt_session *session) {
+	/* Check input */
+	if (!session || !session->complete.shown) return;
+
+
+	/* Clear candidate line */
+	move(LINES-1, 0);
+	clrtoeol();
+	refresh();
+	session->complete.shown = 0;
+}
+
+
+void dbt_complete_reset(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+
+
+	/* Names belong to one database, arrays are kept for the next one */
+	session->complete.count = 0;
+	session->complete.root_count = 0;
+}
+
+
+void dbt_complete_free(struct dbt_complete *complete) {
+	/* Check input */
+	if (!complete) return;
+
+
+	/* Release nodes and roots */
+	free(complete->children);
+	free(complete->siblings);
+	free(complete->names);
+	free(complete->bytes);
+	free(complete->root_kinds);
+	free(complete->root_schemas);
+	free(complete->root_tables);
+	free(complete->roots);
+
+	memset(complete, 0, sizeof(*complete));
+}
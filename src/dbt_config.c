@@ -0,0 +1,450 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_CONFIG_CACHE_MAGIC "DBTCFG01"
+#define DBT_CONFIG_CACHE_MAGIC_LEN 8
+#define DBT_CONFIG_CACHE_SUFFIX ".cache"
+
+
+/* Cache header (stamped with config file identity), followed by server_count x {name, type} offsets and the string blob */
+struct dbt_config_cache_header {
+	char magic[DBT_CONFIG_CACHE_MAGIC_LEN];
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+	uint64_t size;
+	uint64_t inode;
+	uint32_t server_count;
+	uint32_t strings_size;
+};
+
+
+/* Raw slice of config text */
+struct dbt_config_span {
+	const char *start;
+	size_t len;
+};
+
+
+/* Helper functions */
+static void config_stamp(struct dbt_config_cache_header *header, const struct stat *st) {
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, DBT_CONFIG_CACHE_MAGIC, DBT_CONFIG_CACHE_MAGIC_LEN);
+	header->mtime_sec = st->st_mtim.tv_sec;
+	header->mtime_nsec = st->st_mtim.tv_nsec;
+	header->size = st->st_size;
+	header->inode = st->st_ino;
+}
+
+static int config_use_index(struct dbt_config *config, void *map, size_t map_size, int owned) {
+	/* Point server index into cache image */
+	const struct dbt_config_cache_header *header = (const struct dbt_config_cache_header *)map;
+	size_t offsets_size = (size_t)header->server_count * 2 * sizeof(uint32_t);
+	if (map_size != sizeof(*header) + offsets_size + header->strings_size) return 1;
+
+	const uint32_t *offsets = (const uint32_t *)((const char *)map + sizeof(*header));
+	const char *strings = (const char *)map + sizeof(*header) + offsets_size;
+
+
+	/* Every string must start inside the blob, which ends with a terminator */
+	if (header->server_count && (!header->strings_size || strings[header->strings_size - 1])) return 1;
+	for (size_t i=0; i < (size_t)header->server_count * 2; i++) {
+		if (offsets[i] >= header->strings_size) return 1;
+	}
+
+
+	config->map = map;
+	config->map_size = map_size;
+	config->map_owned = owned;
+	config->server_offsets = offsets;
+	config->server_strings = strings;
+	config->server_count = header->server_count;
+
+
+	return 0;
+}
+
+static int config_load_cache(struct dbt_config *config, const struct stat *st) {
+	/* Open cache next to config */
+	char cache_path[4096];
+	snprintf(cache_path, sizeof(cache_path), "%s%s", config->path, DBT_CONFIG_CACHE_SUFFIX);
+
+	int fd = open(cache_path, O_RDONLY);
+	if (fd < 0) return 1;
+
+	struct stat cache_st;
+	if (fstat(fd, &cache_st) || (size_t)cache_st.st_size < sizeof(struct dbt_config_cache_header)) {
+		close(fd);
+		return 1;
+	}
+
+
+	/* Map whole cache (names stay valid for the session) */
+	void *map = mmap(0, cache_st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) return 1;
+
+
+	/* Stale once config changed on disk */
+	struct dbt_config_cache_header expected;
+	config_stamp(&expected, st);
+	const struct dbt_config_cache_header *header = (const struct dbt_config_cache_header *)map;
+
+	int stale = memcmp(header->magic, expected.magic, DBT_CONFIG_CACHE_MAGIC_LEN) || header->mtime_sec != expected.mtime_sec || header->mtime_nsec != expected.mtime_nsec || header->size != expected.size || header->inode != expected.inode;
+	if (stale || config_use_index(config, map, cache_st.st_size, 0)) {
+		munmap(map, cache_st.st_size);
+		return 1;
+	}
+
+
+	return 0;
+}
+
+static const char *scan_ws(const char *p, const char *end) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+	return p;
+}
+
+static const char *scan_string(const char *p, const char *end, struct dbt_config_span *out) {
+	/* Returns position after closing quote (span excludes quotes) */
+	if (p >= end || *p != '"') return 0;
+
+	const char *start = ++p;
+	while (p < end && *p != '"') p += *p == '\\' ? 2 : 1;
+	if (p >= end) return 0;
+
+	if (out) {
+		out->start = start;
+		out->len = p - start;
+	}
+
+	return p + 1;
+}
+
+static const char *scan_skip_value(const char *p, const char *end) {
+	/* Strings, nested containers and literals are skipped without building values */
+	if (p >= end) return 0;
+	else if (*p == '"') return scan_string(p, end, 0);
+	else if (*p != '{' && *p != '[') {
+		while (p < end && !strchr(",}] \t\r\n", *p)) p++;
+		return p;
+	}
+
+	size_t depth = 0;
+	while (p < end) {
+		if (*p == '"') {
+			p = scan_string(p, end, 0);
+			if (!p) return 0;
+			continue;
+		} else if (*p == '{' || *p == '[') depth++;
+		else if ((*p == '}' || *p == ']') && !--depth) return p + 1;
+		p++;
+	}
+
+	return 0;
+}
+
+static const char *scan_member(const char *p, const char *end, struct dbt_config_span *key) {
+	/* '"key" :' of an object member, returns start of value */
+	p = scan_string(scan_ws(p, end), end, key);
+	if (!p) return 0;
+
+	p = scan_ws(p, end);
+	if (p >= end || *p != ':') return 0;
+
+	return scan_ws(p + 1, end);
+}
+
+static const char *scan_next(const char *p, const char *end, int *done) {
+	/* Member separator, or end of object */
+	p = p ? scan_ws(p, end) : 0;
+	if (!p || p >= end) return 0;
+
+	*done = *p == '}';
+	if (*done || *p == ',') return p + 1;
+
+	return 0;
+}
+
+static int span_equals(const struct dbt_config_span *span, const char *value) {
+	return span->len == strlen(value) && !memcmp(span->start, value, span->len);
+}
+
+static size_t config_scan_servers(const char *p, const char *end, struct dbt_config_span *spans, size_t max_spans) {
+	/* Collect '"servers": { name: { "type": ... } }' spans (name/type pairs), SIZE_MAX when the layout is unexpected */
+	p = scan_ws(p, end);
+	if (p >= end || *p != '{') return SIZE_MAX;
+
+	size_t span_count = 0;
+	int found = 0;
+	p = scan_ws(p + 1, end);
+	int done = p < end && *p == '}';
+	while (!done) {
+		struct dbt_config_span key;
+		p = scan_member(p, end, &key);
+		if (!p) return SIZE_MAX;
+
+		if (!span_equals(&key, "servers") || p >= end || *p != '{') {
+			p = scan_next(scan_skip_value(p, end), end, &done);
+			if (!p) return SIZE_MAX;
+			continue;
+		}
+
+
+		/* Server entries, only objects with a string type are listed */
+		found = 1;
+		p = scan_ws(p + 1, end);
+		int servers_done = p < end && *p == '}';
+		if (servers_done) p++;
+		while (!servers_done) {
+			struct dbt_config_span name, type = { 0, 0 };
+			p = scan_member(p, end, &name);
+			if (!p) return SIZE_MAX;
+
+			if (p < end && *p == '{') {
+				p = scan_ws(p + 1, end);
+				int info_done = p < end && *p == '}';
+				if (info_done) p++;
+				while (!info_done) {
+					struct dbt_config_span info_key;
+					p = scan_member(p, end, &info_key);
+					if (!p) return SIZE_MAX;
+
+					if (span_equals(&info_key, "type") && p < end && *p == '"') p = scan_string(p, end, &type);
+					else p = scan_skip_value(p, end);
+
+					p = scan_next(p, end, &info_done);
+					if (!p) return SIZE_MAX;
+				}
+			} else p = scan_skip_value(p, end);
+
+			if (type.start) {
+				/* Escaped names are left to the full parser */
+				if (memchr(name.start, '\\', name.len) || memchr(type.start, '\\', type.len) || span_count + 2 > max_spans) return SIZE_MAX;
+				spans[span_count++] = name;
+				spans[span_count++] = type;
+			}
+
+			p = scan_next(p, end, &servers_done);
+			if (!p) return SIZE_MAX;
+		}
+
+		p = scan_next(p, end, &done);
+		if (!p) return SIZE_MAX;
+	}
+
+
+	return found ? span_count : SIZE_MAX;
+}
+
+static int config_build_cache(struct dbt_config *config, const struct stat *st, const struct dbt_config_span *spans, size_t span_count) {
+	/* Measure strings */
+	size_t server_count = span_count / 2, strings_size = 0;
+	for (size_t i=0; i < span_count; i++) strings_size += spans[i].len + 1;
+
+	size_t offsets_size = server_count * 2 * sizeof(uint32_t);
+	size_t image_size = sizeof(struct dbt_config_cache_header) + offsets_size + strings_size;
+	if (strings_size > UINT32_MAX) return 1;
+
+	char *image = (char *)malloc(image_size);
+	if (!image) return 1;
+
+
+	/* Fill image */
+	struct dbt_config_cache_header *header = (struct dbt_config_cache_header *)image;
+	config_stamp(header, st);
+	header->server_count = server_count;
+	header->strings_size = strings_size;
+
+	uint32_t *offsets = (uint32_t *)(image + sizeof(*header));
+	char *strings = image + sizeof(*header) + offsets_size;
+	size_t strings_len = 0;
+	for (size_t i=0; i < span_count; i++) {
+		offsets[i] = strings_len;
+		memcpy(strings + strings_len, spans[i].start, spans[i].len);
+		strings_len += spans[i].len;
+		strings[strings_len++] = 0;
+	}
+
+	if (config_use_index(config, image, image_size, 1)) {
+		free(image);
+		return 1;
+	}
+
+
+	/* Write cache for next start (optional, replaced atomically) */
+	char cache_path[4096], tmp_path[4200];
+	snprintf(cache_path, sizeof(cache_path), "%s%s", config->path, DBT_CONFIG_CACHE_SUFFIX);
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%d", cache_path, (int)getpid());
+
+	int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) return 0;
+
+	int written = write(fd, image, image_size) == (ssize_t)image_size;
+	close(fd);
+	if (!written || rename(tmp_path, cache_path)) unlink(tmp_path);
+
+
+	return 0;
+}
+
+static int config_index_scanned(struct dbt_config *config, const struct stat *st) {
+	/* Read raw config (terminated, though the scanner stops at end itself) */
+	int fd = open(config->path, O_RDONLY);
+	if (fd < 0) return 1;
+
+	char *text = (char *)malloc(st->st_size + 1);
+	ssize_t text_len = text ? read(fd, text, st->st_size) : -1;
+	close(fd);
+	if (text_len != st->st_size) {
+		free(text);
+		return 1;
+	}
+	text[text_len] = 0;
+
+
+	/* Scan server names and types without parsing the rest (a name and a type need at least 6 bytes) */
+	size_t max_spans = st->st_size / 3 + 2;
+	struct dbt_config_span *spans = (struct dbt_config_span *)malloc(max_spans * sizeof(struct dbt_config_span));
+	size_t span_count = spans ? config_scan_servers(text, text + text_len, spans, max_spans) : SIZE_MAX;
+
+	int result = span_count == SIZE_MAX || config_build_cache(config, st, spans, span_count);
+	free(spans);
+	free(text);
+
+
+	return result;
+}
+
+static int config_index_parsed(struct dbt_config *config, const struct stat *st) {
+	/* Fallback for configs the scanner does not understand */
+	json_t *server_list = json_object_get(dbt_config_get(config), "servers");
+	if (!json_is_object(server_list)) return 1;
+
+	size_t max_spans = json_object_size(server_list) * 2;
+	struct dbt_config_span *spans = (struct dbt_config_span *)malloc((max_spans ? max_spans : 1) * sizeof(struct dbt_config_span));
+	if (!spans) return 1;
+
+
+	/* Servers with a type (others are never listed) */
+	const char *server_name;
+	json_t *server_info;
+	size_t span_count = 0;
+	json_object_foreach(server_list, server_name, server_info) {
+		const char *server_type = json_string_value(json_object_get(server_info, "type"));
+		if (!server_type) continue;
+
+		spans[span_count].start = server_name;
+		spans[span_count++].len = strlen(server_name);
+		spans[span_count].start = server_type;
+		spans[span_count++].len = strlen(server_type);
+	}
+
+	int result = config_build_cache(config, st, spans, span_count);
+	free(spans);
+
+
+	return result;
+}
+
+
+
+
+int dbt_config_open(const char *path, struct dbt_config *config) {
+	/* Check input */
+	if (!path || !config) return 1;
+	memset(config, 0, sizeof(*config));
+
+	config->path = strdup(path);
+	if (!config->path) return 1;
+
+
+	/* Config must exist */
+	struct stat st;
+	if (stat(config->path, &st)) return 1;
+
+
+	/* Server list from cache, otherwise scanned from config text (full parse is deferred to first use) */
+	if (!config_load_cache(config, &st)) return 0;
+	else if (!config_index_scanned(config, &st)) return 0;
+
+
+	return config_index_parsed(config, &st);
+}
+
+
+json_t *dbt_config_get(struct dbt_config *config) {
+	/* Check input */
+	if (!config || !config->path) return 0;
+	else if (config->root || config->parse_failed) return config->root;
+
+
+	/* Parse config on first use */
+	FILE *config_file = fopen(config->path, "r");
+	if (config_file) {
+		enum dbt_memory_subsystem scope = dbt_memory_scope(DBT_MEMORY_CONFIG);
+		config->root = json_loadf(config_file, 1, 0);
+		dbt_memory_scope(scope);
+		fclose(config_file);
+	}
+
+	config->parse_failed = !config->root;
+
+
+	return config->root;
+}
+
+
+size_t dbt_config_server_find(const char *name, const struct dbt_config *config) {
+	/* Check input (returns server_count or more when not found) */
+	if (!name || !config) return SIZE_MAX;
+
+
+	/* Search server index */
+	for (size_t i=0; i < config->server_count; i++) {
+		if (!strcmp(dbt_config_server_name(config, i), name)) return i;
+	}
+
+
+	return config->server_count;
+}
+
+
+const char *dbt_config_server_name(const struct dbt_config *config, size_t ind) {
+	/* Check input */
+	if (!config || ind >= config->server_count) return 0;
+
+	return config->server_strings + config->server_offsets[ind * 2];
+}
+
+
+const char *dbt_config_server_type(const struct dbt_config *config, size_t ind) {
+	/* Check input */
+	if (!config || ind >= config->server_count) return 0;
+
+	return config->server_strings + config->server_offsets[ind * 2 + 1];
+}
+
+
+void dbt_config_close(struct dbt_config *config) {
+	/* Check input */
+	if (!config) return;
+
+
+	/* Release parsed config and server index */
+	if (config->root) json_decref(config->root);
+	if (config->map && config->map_owned) free(config->map);
+	else if (config->map) munmap(config->map, config->map_size);
+	free(config->path);
+
+	memset(config, 0, sizeof(*config));
+}
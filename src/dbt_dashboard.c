@@ -0,0 +1,419 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_DASHBOARD_DEFAULT_INTERVAL_MS 5000
+#define DBT_DASHBOARD_PHASES 3
+#define DBT_DASHBOARD_GROUPS 16
+
+
+/* Catalog queries, one per phase (snapshot queries return key, two counters, then labels, ordered by key) */
+static const char *dashboard_queries[DBT_DASHBOARD_PHASES] = {
+	" SELECT queryid, sum(calls), sum(total_exec_time), left(regexp_replace(min(query), '\\s+', ' ', 'g'), 120)"
+	" FROM pg_stat_statements"
+	" WHERE queryid IS NOT NULL AND dbid = (SELECT oid FROM pg_database WHERE datname = current_database())"
+	" GROUP BY queryid ORDER BY queryid;",
+
+	" SELECT coalesce(state, 'unknown'), coalesce(wait_event_type || ':' || wait_event, ''), count(*)"
+	" FROM pg_stat_activity"
+	" WHERE backend_type = 'client backend' AND pid <> pg_backend_pid()"
+	" GROUP BY 1, 2 ORDER BY 3 DESC;",
+
+	" SELECT relid::bigint, seq_scan, seq_tup_read, schemaname || '.' || relname, n_dead_tup, n_live_tup"
+	" FROM pg_stat_user_tables ORDER BY relid;"
+};
+
+
+/* Helper functions */
+struct dashboard_top {
+	size_t row;
+	double delta_a;
+	double delta_b;
+};
+
+static double row_number(json_t *row, size_t column) {
+	const char *value = json_string_value(json_array_get(row, column));
+	return value ? strtod(value, 0) : 0;
+}
+
+static void dashboard_add_line(struct dbt_dashboard *dashboard, const char *format, ...) {
+	if (dashboard->line_count >= DBT_DASHBOARD_LINES) return;
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(dashboard->lines[dashboard->line_count++], sizeof(dashboard->lines[0]), format, args);
+	va_end(args);
+}
+
+static void dashboard_add_error(struct dbt_dashboard *dashboard, const char *section, json_t *result) {
+	/* First line of server error only */
+	const char *error = json_string_value(json_object_get(result, "error"));
+	size_t error_len = error ? strcspn(error, "\n") : 0;
+	dashboard_add_line(dashboard, "%s unavailable: %.*s", section, (int)error_len, error ? error : "");
+}
+
+static size_t snapshot_update(struct dbt_dashboard_snapshot *snapshot, json_t *rows, struct dashboard_top *top, double *elapsed_s) {
+	/* New snapshot arrays */
+	size_t count = json_array_size(rows);
+	int64_t *keys = (int64_t *)malloc((count ? count : 1) * sizeof(int64_t));
+	double *values = (double *)malloc((count ? count : 1) * 2 * sizeof(double));
+	if (!keys || !values) {
+		free(keys);
+		free(values);
+		return 0;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	int had_previous = snapshot->keys != 0;
+	*elapsed_s = had_previous ? (now.tv_sec - snapshot->taken.tv_sec) + (now.tv_nsec - snapshot->taken.tv_nsec) / 1e9 : 0;
+
+
+	/* Merge with previous snapshot (both sorted by key), keeping largest deltas of second counter */
+	size_t old = 0, top_count = 0;
+	for (size_t i=0; i < count; i++) {
+		json_t *row = json_array_get(rows, i);
+		const char *key_text = json_string_value(json_array_get(row, 0));
+		keys[i] = key_text ? strtoll(key_text, 0, 10) : 0;
+		values[i*2] = row_number(row, 1);
+		values[i*2+1] = row_number(row, 2);
+
+		while (old < snapshot->count && snapshot->keys[old] < keys[i]) old++;
+		double prev_a = 0, prev_b = 0;
+		if (old < snapshot->count && snapshot->keys[old] == keys[i]) {
+			prev_a = snapshot->values[old*2];
+			prev_b = snapshot->values[old*2+1];
+		}
+
+
+		/* Counters went backwards after a stats reset, count from zero */
+		double delta_a = values[i*2] - prev_a, delta_b = values[i*2+1] - prev_b;
+		if (delta_a < 0 || delta_b < 0) {
+			delta_a = values[i*2];
+			delta_b = values[i*2+1];
+		}
+		if (delta_b <= 0) continue;
+
+
+		/* Insert into top list */
+		size_t pos = top_count < DBT_DASHBOARD_TOP ? top_count : DBT_DASHBOARD_TOP - 1;
+		if (top_count == DBT_DASHBOARD_TOP && delta_b <= top[pos].delta_b) continue;
+		while (pos > 0 && top[pos-1].delta_b < delta_b) {
+			top[pos] = top[pos-1];
+			pos--;
+		}
+		top[pos].row = i;
+		top[pos].delta_a = delta_a;
+		top[pos].delta_b = delta_b;
+		if (top_count < DBT_DASHBOARD_TOP) top_count++;
+	}
+
+
+	/* Replace snapshot */
+	free(snapshot->keys);
+	free(snapshot->values);
+	snapshot->keys = keys;
+	snapshot->values = values;
+	snapshot->count = count;
+	snapshot->taken = now;
+
+
+	return top_count;
+}
+
+static void process_statements(struct dbt_dashboard *dashboard, json_t *result) {
+	if (json_object_get(result, "error")) {
+		dashboard_add_error(dashboard, "pg_stat_statements", result);
+		return;
+	}
+
+
+	/* Top statements by execution time spent since last snapshot */
+	json_t *rows = json_object_get(result, "rows");
+	struct dashboard_top top[DBT_DASHBOARD_TOP];
+	double elapsed_s;
+	size_t top_count = snapshot_update(&dashboard->statements, rows, top, &elapsed_s);
+
+	if (elapsed_s > 0) dashboard_add_line(dashboard, "Top queries (last %.0fs)", elapsed_s);
+	else dashboard_add_line(dashboard, "Top queries (since stats reset)");
+
+	for (size_t i=0; i < top_count; i++) {
+		json_t *row = json_array_get(rows, top[i].row);
+		double mean_ms = top[i].delta_a > 0 ? top[i].delta_b / top[i].delta_a : 0;
+		dashboard_add_line(dashboard, "%9.1fms %8.2fms avg %6.0fx", top[i].delta_b, mean_ms, top[i].delta_a);
+		const char *query = json_string_value(json_array_get(row, 3));
+		dashboard_add_line(dashboard, "  %s", query ? query : "");
+	}
+}
+
+static void process_activity(struct dbt_dashboard *dashboard, json_t *result) {
+	if (json_object_get(result, "error")) {
+		dashboard_add_error(dashboard, "pg_stat_activity", result);
+		return;
+	}
+
+
+	/* Sum backends per state and per wait event */
+	const char *states[DBT_DASHBOARD_GROUPS], *waits[DBT_DASHBOARD_GROUPS];
+	long long state_counts[DBT_DASHBOARD_GROUPS], wait_counts[DBT_DASHBOARD_GROUPS];
+	size_t state_count = 0, wait_count = 0;
+	long long total = 0;
+
+	size_t row_ind;
+	json_t *row;
+	json_array_foreach(json_object_get(result, "rows"), row_ind, row) {
+		const char *state = json_string_value(json_array_get(row, 0));
+		const char *wait = json_string_value(json_array_get(row, 1));
+		long long count = (long long)row_number(row, 2);
+		if (!state || !wait) continue;
+		total += count;
+
+		size_t i = 0;
+		while (i < state_count && strcmp(states[i], state)) i++;
+		if (i == state_count && state_count < DBT_DASHBOARD_GROUPS) {
+			states[state_count] = state;
+			state_counts[state_count++] = 0;
+		}
+		if (i < state_count) state_counts[i] += count;
+
+		if (!wait[0]) continue;
+		i = 0;
+		while (i < wait_count && strcmp(waits[i], wait)) i++;
+		if (i == wait_count && wait_count < DBT_DASHBOARD_GROUPS) {
+			waits[wait_count] = wait;
+			wait_counts[wait_count++] = 0;
+		}
+		if (i < wait_count) wait_counts[i] += count;
+	}
+
+
+	/* Backends line plus busiest wait events (rows come ordered by count) */
+	dashboard_add_line(dashboard, "Backends %lld", total);
+	for (size_t i=0; i < state_count; i++) dashboard_add_line(dashboard, "  %-24s %6lld", states[i], state_counts[i]);
+	for (size_t i=0; i < wait_count && i < DBT_DASHBOARD_TOP; i++) {
+		dashboard_add_line(dashboard, "  wait %-19s %6lld", waits[i], wait_counts[i]);
+	}
+}
+
+static void process_tables(struct dbt_dashboard *dashboard, json_t *result) {
+	if (json_object_get(result, "error")) {
+		dashboard_add_error(dashboard, "pg_stat_user_tables", result);
+		return;
+	}
+
+
+	/* Tables with most rows read by sequential scans since last snapshot */
+	json_t *rows = json_object_get(result, "rows");
+	struct dashboard_top top[DBT_DASHBOARD_TOP];
+	double elapsed_s;
+	size_t top_count = snapshot_update(&dashboard->tables, rows, top, &elapsed_s);
+
+	dashboard_add_line(dashboard, "Seq scans: rows read/scans/dead%%");
+	for (size_t i=0; i < top_count; i++) {
+		json_t *row = json_array_get(rows, top[i].row);
+		double dead = row_number(row, 4), live = row_number(row, 5);
+		double dead_share = dead + live > 0 ? dead * 100 / (dead + live) : 0;
+		const char *table = json_string_value(json_array_get(row, 3));
+		dashboard_add_line(dashboard, "%10.0f %5.0f %3.0f%% %s", top[i].delta_b, top[i].delta_a, dead_share, table ? table : "");
+	}
+}
+
+static int dashboard_send(struct dbt_dashboard *dashboard) {
+	/* Phase 0 starts a new cycle */
+	if (!dashboard->phase) {
+		dashboard->line_count = 0;
+		clock_gettime(CLOCK_MONOTONIC, &dashboard->last_poll);
+	}
+
+	if (dashboard->adapter.send_query(dashboard_queries[dashboard->phase], dashboard->conn_handle, &dashboard->adapter)) {
+		/* Connection is gone, restart the cycle once it is reopened */
+		dashboard->phase = 0;
+		if (dashboard->adapter.reset_connection) {
+			/* Supervisor reopens it with backoff */
+			dashboard->link.state = DBT_LINK_BROKEN;
+			dashboard->link.attempts = 0;
+			clock_gettime(CLOCK_MONOTONIC, &dashboard->link.next_attempt);
+		} else {
+			/* No reset support, reopen on the next interval */
+			if (dashboard->conn_handle) dashboard->adapter.close_connection(dashboard->conn_handle, &dashboard->adapter);
+			dashboard->conn_handle = 0;
+		}
+
+		return 1;
+	}
+	dashboard->busy = 1;
+
+
+	return 0;
+}
+
+static void dashboard_render(struct dbt_session *session) {
+	struct dbt_dashboard *dashboard = &session->dashboard;
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+	int width = getmaxx(win) - 4;
+	int max_y = getmaxy(win) - 1;
+
+
+	/* Clear previous properties */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Activity (every %ds)", dashboard->interval_ms / 1000);
+
+
+	/* Print collected lines */
+	for (size_t i=0; i < dashboard->line_count && (int)i + 1 < max_y; i++) mvwaddnstr(win, i+1, 2, dashboard->lines[i], width);
+
+
+	/* Refresh window */
+	wrefresh(win);
+}
+
+
+
+
+int dbt_dashboard_toggle(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_dashboard *dashboard = &session->dashboard;
+
+
+	/* Second press stops */
+	if (dashboard->active) {
+		dbt_dashboard_stop(session);
+		return 0;
+	} else if (!session->current_server || !session->adapter_handle.open_connection) return 1;
+
+
+	/* Open dedicated connection (dashboard keeps an adapter copy, like tabs, and needs every snapshot row) */
+	dashboard->adapter = session->adapter_handle;
+	dashboard->adapter.conn_handle = 0;
+	dashboard->adapter.db_conn_handle = 0;
+	dashboard->adapter.row_limit = 0;
+	dashboard->conn_handle = dashboard->adapter.open_connection(session->current_database ? session->current_database : "postgres", &dashboard->adapter);
+	if (!dashboard->conn_handle) return 1;
+	dbt_supervisor_reset(&dashboard->link);
+
+
+	/* Refresh interval ('dashboard_interval' in seconds) */
+	json_t *interval = json_object_get(session->current_server, "dashboard_interval");
+	dashboard->interval_ms = json_is_number(interval) && json_number_value(interval) >= 1 ? (int)(json_number_value(interval) * 1000) : DBT_DASHBOARD_DEFAULT_INTERVAL_MS;
+
+
+	/* First cycle starts right away */
+	dashboard->active = 1;
+	dashboard->phase = 0;
+	dashboard_add_line(dashboard, "loading...");
+	dashboard_render(session);
+
+
+	return dashboard_send(dashboard);
+}
+
+
+void dbt_dashboard_stop(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+	struct dbt_dashboard *dashboard = &session->dashboard;
+
+
+	/* Release connection and snapshots */
+	if (dashboard->conn_handle) dashboard->adapter.close_connection(dashboard->conn_handle, &dashboard->adapter);
+	json_decref(dashboard->link.session_state);
+	json_decref(dashboard->pending);
+	free(dashboard->statements.keys);
+	free(dashboard->statements.values);
+	free(dashboard->tables.keys);
+	free(dashboard->tables.values);
+	memset(dashboard, 0, sizeof(*dashboard));
+}
+
+
+size_t dbt_dashboard_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session) {
+	/* Check input */
+	if (!fds || !max || !session) return 0;
+	struct dbt_dashboard *dashboard = &session->dashboard;
+	if (!dashboard->active || !dashboard->busy) return 0;
+
+
+	/* Socket of query in flight */
+	fds[0].fd = dashboard->adapter.connection_fd(dashboard->conn_handle, &dashboard->adapter);
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+
+
+	return 1;
+}
+
+
+int dbt_dashboard_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 0;
+	struct dbt_dashboard *dashboard = &session->dashboard;
+	if (!dashboard->active) return 0;
+
+
+	/* Idle: start next cycle once interval passed (and the supervisor reopened a dropped connection) */
+	if (!dashboard->busy) {
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		int64_t elapsed_ms = (now.tv_sec - dashboard->last_poll.tv_sec) * 1000ll + (now.tv_nsec - dashboard->last_poll.tv_nsec) / 1000000;
+		if (elapsed_ms < dashboard->interval_ms || dashboard->link.state != DBT_LINK_OK) return 0;
+
+		if (!dashboard->conn_handle) {
+			clock_gettime(CLOCK_MONOTONIC, &dashboard->last_poll);
+			dashboard->conn_handle = dashboard->adapter.open_connection(session->current_database ? session->current_database : "postgres", &dashboard->adapter);
+		}
+		if (dashboard->conn_handle && !dashboard_send(dashboard)) return 0;
+
+
+		/* Connection dropped, reopened with backoff before the next cycle */
+		dashboard->line_count = 0;
+		dashboard_add_line(dashboard, "connection lost, reconnecting");
+		dashboard_render(session);
+
+		return 1;
+	}
+
+
+	/* Wait for phase result */
+	enum dbt_memory_subsystem scope = dbt_memory_scope(DBT_MEMORY_DASHBOARD);
+	int busy = dashboard->adapter.poll_query(dashboard->conn_handle, &dashboard->pending, &dashboard->adapter);
+	dbt_memory_scope(scope);
+	if (busy) return 0;
+	dashboard->busy = 0;
+
+	switch (dashboard->phase) {
+		case 0:
+			process_statements(dashboard, dashboard->pending);
+			break;
+		case 1:
+			process_activity(dashboard, dashboard->pending);
+			break;
+		default:
+			process_tables(dashboard, dashboard->pending);
+			break;
+	}
+
+	json_decref(dashboard->pending);
+	dashboard->pending = 0;
+
+
+	/* Chain next phase, or show finished cycle */
+	dashboard->phase = (dashboard->phase + 1) % DBT_DASHBOARD_PHASES;
+	if (dashboard->phase) {
+		if (!dashboard_send(dashboard)) return 0;
+
+		dashboard->line_count = 0;
+		dashboard_add_line(dashboard, "connection lost, reconnecting");
+	}
+
+	dashboard_render(session);
+
+
+	return 1;
+}
@@ -3,44 +3,64 @@
 #include "dbt.h"
 
 
-int dbt_databases_refresh(struct dbt_session *session) {
-	/* Check input */
-	if (!session || !session->current_server) return 1;
+/* Helper functions */
+static void databases_drop_names(struct dbt_session *session, int keep_databases) {
+	/* Lists of the previous server or database go, the string pool is rebuilt from the database list alone (completion must be reset before) */
+	dbt_properties_stop(session);
+	dbt_catalog_names_free(&session->schema_list);
+	dbt_catalog_names_free(&session->table_list);
+	dbt_catalog_columns_free(&session->column_list);
+	session->current_schema = 0;
+	session->current_table = 0;
+	session->current_column = 0;
+	if (!keep_databases) {
+		dbt_catalog_names_free(&session->database_list);
+		session->current_database = 0;
+	}
+
 
+	/* Re-intern database names (current database is found again by position, a failed rebuild keeps the old pool) */
+	size_t current = 0;
+	while (current < session->database_list.count && dbt_strings_get(&session->strings, session->database_list.names[current]) != session->current_database) current++;
+	if (dbt_strings_rebuild(&session->strings, session->database_list.names, session->database_list.count)) return;
+	session->current_database = current < session->database_list.count ? dbt_strings_get(&session->strings, session->database_list.names[current]) : 0;
 
-	/* Load server type */
-	const char *server_type = json_string_value(json_object_get(session->current_server, "type"));
 
+	/* Emptied panes */
+	dbt_list_reset(DBT_WIN_SCHEMAS, session);
+	dbt_list_reset(DBT_WIN_TABLESVIEWS, session);
+	dbt_list_reset(DBT_WIN_COLUMNS, session);
+}
 
-	/* Init adapter for server */
-	if (!strcmp(server_type, "psql")) dbt_adapter_psql_init(session);
-	//else if (!strcmp(server_type, "mssql")) dbt_adapter_mssql_init(session);
-	//else if (!strcmp(server_type, "mysql")) dbt_adapter_mysql_init(session);
-	//else if (!strcmp(server_type, "sqlite")) dbt_adapter_sqlite_init(session);
 
 
-	/* Load databases */
-	session->database_list = session->adapter_handle.load_database_list(&session->adapter_handle);
-	if (!json_is_array(session->database_list)) return 1;
 
+int dbt_databases_refresh(struct dbt_session *session) {
+	/* Check input */
+	if (!session || !session->current_server) return 1;
 
-	/* Clear previous list */
-	wclear(session->app_windows[DBT_WIN_DATABASES]);
-	box(session->app_windows[DBT_WIN_DATABASES], 0, 0);
-	mvwprintw(session->app_windows[DBT_WIN_DATABASES], 0, 2, "Databases");
 
+	/* Init adapter for server (closing previous server's connections, change feed, dashboard and preview; completion and catalog names belong to it too) */
+	dbt_watch_stop(session);
+	dbt_dashboard_stop(session);
+	dbt_complete_reset(session);
+	databases_drop_names(session, 0);
+	dbt_adapter_close(&session->adapter_handle);
+	dbt_supervisor_reset(&session->link);
+	if (dbt_adapter_init(session->current_server, &session->adapter_handle)) return 1;
 
-	/* Print new database list */
-	size_t list_size = json_array_size(session->database_list);
-	for (size_t i=0; i < list_size; i++) {
-		const char *db_name = json_string_value(json_array_get(session->database_list, i));
 
-		mvwprintw(session->app_windows[DBT_WIN_DATABASES], i+1, 2, "[ ] %s", db_name);
+	/* Load databases (previous server's list is dropped when the server cannot be reached, the status line tells why) */
+	if (session->adapter_handle.load_database_list(&session->database_list, &session->strings, &session->adapter_handle)) {
+		dbt_catalog_names_free(&session->database_list);
+		dbt_list_reset(DBT_WIN_DATABASES, session);
+		dbt_session_refresh_query(session);
+		return 1;
 	}
 
 
-	/* Refresh window */
-	wrefresh(session->app_windows[DBT_WIN_DATABASES]);
+	/* Print new database list (from top) */
+	dbt_list_reset(DBT_WIN_DATABASES, session);
 
 
 	return 0;
@@ -50,46 +70,53 @@ int dbt_databases_refresh(struct dbt_session *session) {
 int dbt_databases_select(const char *database, struct dbt_session *session) {
 	/* Check input */
 	if (!database || !session) return 1;
-	else if (!json_is_array(session->database_list)) return 1;
 
 
-	/* Load requested database */
-	int found_db = 0;
-	size_t database_count = json_array_size(session->database_list);
-	for (size_t i=0; i < database_count; i++) {
-		const char *db_name = json_string_value(json_array_get(session->database_list, i));
-		if (!strcmp(db_name, database)) {
-			/* Set found_db flag */
-			found_db = 1;
+	/* Find requested database */
+	size_t database_count = session->database_list.count;
+	size_t ind = 0;
+	for (; ind < database_count; ind++) {
+		if (!strcmp(dbt_strings_get(&session->strings, session->database_list.names[ind]), database)) break;
+	}
 
 
-			/* Mark as selected */
-			mvwprintw(session->app_windows[DBT_WIN_DATABASES], i+1, 2, "[*]");
+	/* Clear variables if database not found */
+	if (ind == database_count) {
+		session->current_database = 0;
+		dbt_list_render(DBT_WIN_DATABASES, session);
+		return 1;
+	}
 
 
-			/* Store as current */
-			session->current_database = db_name;
+	/* Store as current and mark as selected (scrolled into view) */
+	session->current_database = dbt_strings_get(&session->strings, session->database_list.names[ind]);
+	dbt_list_reveal(DBT_WIN_DATABASES, ind, session);
 
 
-			/* Connect to db */
-			session->adapter_handle.connect_to_db(db_name, &session->adapter_handle);
+	/* Connect to db (completion and catalog names belong to the previous one, the pool keeps only database names) */
+	dbt_complete_reset(session);
+	databases_drop_names(session, 1);
+	int failed = session->adapter_handle.connect_to_db(session->current_database, &session->adapter_handle);
+	dbt_supervisor_reset(&session->link);
 
 
-			/* Refresh schemas */
-			dbt_schemas_refresh(session);
-		} else mvwprintw(session->app_windows[DBT_WIN_DATABASES], i+1, 2, "[ ]");
+	/* Unreachable database, the status line tells why */
+	if (failed) {
+		dbt_watch_stop(session);
+		dbt_session_refresh_query(session);
+		return 1;
 	}
 
 
-	/* Refresh window */
-	wrefresh(session->app_windows[DBT_WIN_DATABASES]);
+	/* Track catalog changes if server enables a change feed ('notify' or 'poll') */
+	const char *change_feed = json_string_value(json_object_get(session->current_server, "change_feed"));
+	if (change_feed) dbt_watch_start(change_feed, session);
+	else dbt_watch_stop(session);
 
 
-	/* Clear windows/variables if database not found */
-	if (!found_db) {
-		session->current_database = 0;
-	}
+	/* Refresh schemas */
+	dbt_schemas_refresh(session);
 
 
-	return !found_db;
+	return 0;
 }
@@ -0,0 +1,412 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_EXPORT_DEFAULT_JOBS 4
+#define DBT_EXPORT_RANGES_PER_JOB 4
+#define DBT_EXPORT_BATCH_ROWS 4096
+#define DBT_EXPORT_WRITE_BUFFER (1 << 20)
+#define DBT_EXPORT_RENDER_MS 250
+
+
+/* Helper functions */
+static uint64_t export_elapsed_us(const struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) * 1000000ull + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static void export_format_bytes(char *out, size_t out_size, double bytes) {
+	const char *units[] = { "B", "kB", "MB", "GB", "TB" };
+	size_t unit = 0;
+	while (bytes >= 1024 && unit < 4) {
+		bytes /= 1024;
+		unit++;
+	}
+
+	snprintf(out, out_size, unit ? "%.1f %s" : "%.0f %s", bytes, units[unit]);
+}
+
+static FILE *export_open_file(const char *path, size_t range) {
+	/* '%' in path is replaced by range number (one file per range) */
+	char file_path[4096];
+	const char *marker = strchr(path, '%');
+	if (marker) snprintf(file_path, sizeof(file_path), "%.*s%03zu%s", (int)(marker - path), path, range, marker + 1);
+	else snprintf(file_path, sizeof(file_path), "%s", path);
+
+	FILE *file = fopen(file_path, "w");
+	if (file) setvbuf(file, 0, _IOFBF, DBT_EXPORT_WRITE_BUFFER);
+
+	return file;
+}
+
+static int export_render(struct dbt_session *session, int force) {
+	struct dbt_export *export = &session->export;
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+
+
+	/* Throttled while rows stream in, properties pane belongs to the dashboard while it runs */
+	if (session->dashboard.active) return 0;
+	else if (!force && export_elapsed_us(&export->last_render) < DBT_EXPORT_RENDER_MS * 1000ull) return 0;
+	clock_gettime(CLOCK_MONOTONIC, &export->last_render);
+
+
+	/* Clear previous content */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Export %s", export->active ? "(running)" : export->failed ? "(failed)" : "(done)");
+
+
+	/* Print progress and throughput */
+	int width = getmaxx(win) - 4;
+	double seconds = (export->active ? export_elapsed_us(&export->started) : export->duration_us) / 1e6;
+	char size[32], rate[32], line[256];
+	export_format_bytes(size, sizeof(size), export->bytes);
+	export_format_bytes(rate, sizeof(rate), seconds > 0 ? export->bytes / seconds : 0);
+
+	int y = 1;
+	snprintf(line, sizeof(line), "%s.%s", export->schema, export->table);
+	mvwaddnstr(win, y++, 2, line, width);
+	snprintf(line, sizeof(line), "%s", export->path ? export->path : "");
+	mvwaddnstr(win, y++, 2, line, width);
+	mvwprintw(win, y++, 2, "Split     %s, %zu jobs", json_string_value(json_object_get(export->plan, "split")) ? json_string_value(json_object_get(export->plan, "split")) : "-", export->job_count);
+	mvwprintw(win, y++, 2, "Ranges    %zu/%zu", export->ranges_done, export->range_count);
+	mvwprintw(win, y++, 2, "Rows      %llu (%.0f/s)", (unsigned long long)export->rows, seconds > 0 ? export->rows / seconds : 0);
+	mvwprintw(win, y++, 2, "Written   %s (%s/s)", size, rate);
+	mvwprintw(win, y++, 2, "Elapsed   %.1fs", seconds);
+
+
+	/* Per worker ranges (shows imbalance) */
+	y++;
+	for (size_t i=0; i < export->job_count && y < getmaxy(win) - 2; i++) {
+		struct dbt_export_worker *worker = &export->workers[i];
+		const char *state = worker->connecting ? "connecting" : worker->conn_handle ? "copying" : "idle";
+		mvwprintw(win, y++, 2, "#%-2zu %-10s %zu ranges", i + 1, state, worker->ranges_done);
+	}
+
+	if (export->message[0]) mvwaddnstr(win, getmaxy(win) - 2, 2, export->message, width);
+
+
+	/* Refresh window */
+	wrefresh(win);
+
+
+	return 1;
+}
+
+static void export_finish(struct dbt_session *session, const char *format, ...) {
+	struct dbt_export *export = &session->export;
+
+
+	/* Close workers and snapshot transaction */
+	for (size_t i=0; i < export->job_count; i++) {
+		struct dbt_export_worker *worker = &export->workers[i];
+		if (worker->conn_handle) export->adapter.close_connection(worker->conn_handle, &export->adapter);
+		if (worker->out) fclose(worker->out);
+		worker->conn_handle = 0;
+		worker->out = 0;
+		worker->connecting = 0;
+	}
+
+	if (export->coordinator) export->adapter.close_connection(export->coordinator, &export->adapter);
+	if (export->merged && fclose(export->merged) && !format) format = "write failed";
+	export->coordinator = 0;
+	export->merged = 0;
+
+
+	/* Keep summary on screen */
+	export->duration_us = export_elapsed_us(&export->started);
+	export->active = 0;
+	export->failed = format != 0;
+	if (format) {
+		va_list args;
+		va_start(args, format);
+		vsnprintf(export->message, sizeof(export->message), format, args);
+		va_end(args);
+	}
+
+	export_render(session, 1);
+}
+
+static int export_next_range(struct dbt_export_worker *worker, struct dbt_export *export) {
+	/* Take next range from the shared queue (returns 1 when none is left) */
+	if (export->next_range >= export->range_count) return 1;
+
+	worker->range = export->next_range++;
+	worker->copying = 0;
+	if (!export->merged) {
+		worker->out = export_open_file(export->path, worker->range);
+		if (!worker->out) return -1;
+	}
+
+	const char *predicate = json_string_value(json_array_get(json_object_get(export->plan, "ranges"), worker->range));
+	const char *snapshot = json_string_value(json_object_get(export->plan, "snapshot"));
+	if (export->adapter.start_export(export->schema, export->table, snapshot, predicate, !worker->ranges_done, worker->conn_handle, &export->adapter)) return -1;
+
+
+	return 0;
+}
+
+static int export_drain(struct dbt_export_worker *worker, struct dbt_session *session) {
+	/* Write rows of current range (bounded batch keeps keyboard responsive), returns 1 when finished with error */
+	struct dbt_export *export = &session->export;
+	FILE *out = worker->out ? worker->out : export->merged;
+
+	for (size_t i=0; i < DBT_EXPORT_BATCH_ROWS; i++) {
+		char *data = 0;
+		int len = export->adapter.read_export(worker->conn_handle, &worker->copying, &data, &export->adapter);
+		if (!len) return 0;
+		else if (len == -2) {
+			/* Message belongs to the connection, copy before closing it */
+			char error[128];
+			snprintf(error, sizeof(error), "%.*s", (int)strcspn(data ? data : "failed", "\n"), data ? data : "failed");
+			export_finish(session, "range %zu: %s", worker->range, error);
+			return 1;
+		}
+
+
+		/* Range done, continue with next one on the same snapshot */
+		if (len == -1) {
+			worker->ranges_done++;
+			export->ranges_done++;
+
+			if (worker->out && fclose(worker->out)) {
+				worker->out = 0;
+				export_finish(session, "write failed");
+				return 1;
+			}
+			worker->out = 0;
+
+			int next = export_next_range(worker, export);
+			if (next < 0) {
+				export_finish(session, "range %zu: start failed", worker->range);
+				return 1;
+			} else if (next) {
+				export->adapter.close_connection(worker->conn_handle, &export->adapter);
+				worker->conn_handle = 0;
+				return 0;
+			}
+
+			out = worker->out ? worker->out : export->merged;
+			continue;
+		}
+
+
+		/* Writer stage (rows are whole CSV lines, so ranges can interleave in a merged file) */
+		size_t written = fwrite(data, 1, len, out);
+		export->adapter.release_export_data(data, &export->adapter);
+		if (written != (size_t)len) {
+			export_finish(session, "write failed");
+			return 1;
+		}
+
+		export->rows++;
+		export->bytes += len;
+	}
+
+
+	return 0;
+}
+
+
+
+
+int dbt_export_command(const char *input, struct dbt_session *session) {
+	/* Check input ('path [jobs] [key]', '%' in path writes one file per range, 'cancel' stops) */
+	if (!input || !session) return 1;
+	struct dbt_export *export = &session->export;
+
+	if (!strcmp(input, "cancel")) {
+		if (export->active) export_finish(session, "cancelled");
+		return 0;
+	} else if (export->active || !session->current_table || !session->current_schema) return 1;
+	else if (!session->adapter_handle.plan_export || !session->adapter_handle.start_connection) return 1;
+
+
+	/* Parse arguments */
+	char args[64];
+	snprintf(args, sizeof(args), "%s", input);
+	char *save_ptr = 0;
+	const char *path = strtok_r(args, " ", &save_ptr);
+	if (!path) return 1;
+
+	json_t *jobs_config = json_object_get(session->current_server, "export_jobs");
+	size_t jobs = json_integer_value(jobs_config) > 0 ? (size_t)json_integer_value(jobs_config) : DBT_EXPORT_DEFAULT_JOBS;
+	const char *key = 0;
+	for (char *arg = strtok_r(0, " ", &save_ptr); arg; arg = strtok_r(0, " ", &save_ptr)) {
+		if (strspn(arg, "0123456789") == strlen(arg)) jobs = strtoul(arg, 0, 10);
+		else key = arg;
+	}
+	if (!jobs) jobs = 1;
+	else if (jobs > DBT_EXPORT_MAX_JOBS) jobs = DBT_EXPORT_MAX_JOBS;
+
+
+	/* Reset previous export, properties pane shows progress */
+	dbt_export_stop(session);
+	dbt_dashboard_stop(session);
+
+	export->adapter = session->adapter_handle;
+	export->adapter.conn_handle = 0;
+	export->adapter.db_conn_handle = 0;
+	export->adapter.row_limit = 0;
+	export->adapter.statement_timeout = 0;
+
+	snprintf(export->schema, sizeof(export->schema), "%s", session->current_schema);
+	snprintf(export->table, sizeof(export->table), "%s", session->current_table);
+	export->path = strdup(path);
+	clock_gettime(CLOCK_MONOTONIC, &export->started);
+	export->active = 1;
+	export->job_count = jobs;
+
+
+	/* Pin snapshot and split table (more ranges than jobs, so fast workers take more) */
+	const char *database = session->current_database ? session->current_database : "postgres";
+	export->coordinator = export->adapter.open_connection(database, &export->adapter);
+	if (!export->path || !export->coordinator) {
+		export_finish(session, "connection failed");
+		return 1;
+	}
+
+	export->plan = export->adapter.plan_export(export->schema, export->table, key, jobs * DBT_EXPORT_RANGES_PER_JOB, export->coordinator, &export->adapter);
+	const char *error = json_string_value(json_object_get(export->plan, "error"));
+	if (!export->plan || error) {
+		export_finish(session, "%.*s", (int)strcspn(error ? error : "planning failed", "\n"), error ? error : "planning failed");
+		return 1;
+	}
+
+	export->range_count = json_array_size(json_object_get(export->plan, "ranges"));
+	if (export->job_count > export->range_count) export->job_count = export->range_count;
+
+
+	/* Merged output unless path asks for one file per range */
+	if (!strchr(export->path, '%')) {
+		export->merged = export_open_file(export->path, 0);
+		if (!export->merged) {
+			export_finish(session, "cannot open %s", export->path);
+			return 1;
+		}
+	}
+
+
+	/* Start worker connections (the event loop hands out ranges once connected) */
+	for (size_t i=0; i < export->job_count; i++) {
+		struct dbt_export_worker *worker = &export->workers[i];
+		worker->conn_handle = export->adapter.start_connection(database, &export->adapter);
+		if (!worker->conn_handle) {
+			export_finish(session, "connection failed");
+			return 1;
+		}
+
+		worker->connecting = 1;
+		worker->events = POLLOUT;
+	}
+
+	export_render(session, 1);
+
+
+	return 0;
+}
+
+
+void dbt_export_stop(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+	struct dbt_export *export = &session->export;
+
+
+	/* Abort running export, release plan */
+	if (export->active) export_finish(session, "cancelled");
+	json_decref(export->plan);
+	free(export->path);
+	memset(export, 0, sizeof(*export));
+}
+
+
+size_t dbt_export_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session) {
+	/* Check input */
+	if (!fds || !session) return 0;
+	struct dbt_export *export = &session->export;
+	if (!export->active) return 0;
+
+
+	/* Sockets of connecting and copying workers */
+	size_t count = 0;
+	for (size_t i=0; i < export->job_count && count < max; i++) {
+		struct dbt_export_worker *worker = &export->workers[i];
+		if (!worker->conn_handle) continue;
+
+		fds[count].fd = export->adapter.connection_fd(worker->conn_handle, &export->adapter);
+		fds[count].events = worker->connecting ? worker->events : POLLIN;
+		fds[count].revents = 0;
+		count++;
+	}
+
+
+	return count;
+}
+
+
+int dbt_export_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 0;
+	struct dbt_export *export = &session->export;
+	if (!export->active) return 0;
+
+
+	/* Advance workers */
+	size_t running = 0;
+	for (size_t i=0; i < export->job_count; i++) {
+		struct dbt_export_worker *worker = &export->workers[i];
+		if (!worker->conn_handle) continue;
+
+		if (worker->connecting) {
+			/* Only advance handshake once the socket is ready */
+			struct pollfd ready = { export->adapter.connection_fd(worker->conn_handle, &export->adapter), worker->events, 0 };
+			if (poll(&ready, 1, 0) <= 0) {
+				running++;
+				continue;
+			}
+
+			int status = export->adapter.poll_connection(worker->conn_handle, &export->adapter);
+			if (status < 0) {
+				export_finish(session, "connection failed");
+				return 1;
+			} else if (status) {
+				worker->events = status == 1 ? POLLIN : POLLOUT;
+				running++;
+				continue;
+			}
+
+
+			/* Connected, first range imports the snapshot */
+			worker->connecting = 0;
+			int next = export_next_range(worker, export);
+			if (next < 0) {
+				export_finish(session, "range %zu: start failed", worker->range);
+				return 1;
+			} else if (next) {
+				export->adapter.close_connection(worker->conn_handle, &export->adapter);
+				worker->conn_handle = 0;
+				continue;
+			}
+		}
+
+		if (export_drain(worker, session)) return 1;
+		if (worker->conn_handle) running++;
+	}
+
+
+	/* Done once every worker ran out of ranges */
+	if (!running) {
+		export_finish(session, 0);
+		return 1;
+	}
+
+	return export_render(session, 0);
+}
@@ -0,0 +1,399 @@
+#include <fnmatch.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_FANOUT_DEFAULT_CONCURRENCY 8
+
+
+/* Helper functions */
+static uint64_t fanout_elapsed_us(const struct timespec *started) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - started->tv_sec) * 1000000ull + (now.tv_nsec - started->tv_nsec) / 1000;
+}
+
+static void fanout_target_finish(struct dbt_fanout_target *target, json_t *result, const char *error) {
+	/* Store outcome */
+	target->duration_us = fanout_elapsed_us(&target->started);
+	if (error) {
+		json_decref(result);
+		result = json_object();
+		json_object_set_new(result, "error", json_string(error));
+	}
+
+	target->result = result;
+	target->state = (!json_is_object(result) || json_object_get(result, "error")) ? DBT_FANOUT_FAILED : DBT_FANOUT_DONE;
+
+
+	/* Release connection slot */
+	if (target->conn_handle) target->adapter.close_connection(target->conn_handle, &target->adapter);
+	target->conn_handle = 0;
+}
+
+static int fanout_add_target(struct dbt_fanout *fanout, const char *server_name, json_t *server_info, const char *database) {
+	/* Grow target list */
+	struct dbt_fanout_target *targets = (struct dbt_fanout_target *)realloc(fanout->targets, (fanout->target_count + 1) * sizeof(*targets));
+	if (!targets) return 1;
+	fanout->targets = targets;
+
+
+	/* Init target with its own adapter */
+	struct dbt_fanout_target *target = &targets[fanout->target_count++];
+	memset(target, 0, sizeof(*target));
+	target->server_name = server_name;
+	target->database = strdup(database);
+	target->state = DBT_FANOUT_PENDING;
+
+	if (dbt_adapter_init(server_info, &target->adapter) || !target->adapter.start_connection) {
+		clock_gettime(CLOCK_MONOTONIC, &target->started);
+		fanout_target_finish(target, 0, "unsupported server type");
+	}
+
+
+	return 0;
+}
+
+static int fanout_parse_targets(struct dbt_fanout *fanout, const char *spec, struct dbt_session *session) {
+	/* Load servers from config */
+	json_t *server_list = json_object_get(dbt_config_get(&session->config), "servers");
+	if (!json_is_object(server_list)) return 1;
+
+	const char *default_database = session->current_database ? session->current_database : "postgres";
+
+
+	/* Split spec into comma separated 'server-glob[/database]' entries */
+	char *spec_copy = strdup(spec);
+	if (!spec_copy) return 1;
+
+	char *save_ptr = 0;
+	for (char *entry = strtok_r(spec_copy, ",", &save_ptr); entry; entry = strtok_r(0, ",", &save_ptr)) {
+		/* Trim entry */
+		while (*entry == ' ') entry++;
+		size_t entry_len = strlen(entry);
+		while (entry_len && entry[entry_len-1] == ' ') entry[--entry_len] = 0;
+		if (!entry_len) continue;
+
+
+		/* Split optional database */
+		const char *database = default_database;
+		char *slash = strchr(entry, '/');
+		if (slash) {
+			*slash = 0;
+			if (slash[1]) database = slash+1;
+		}
+
+
+		/* Add every matching server */
+		const char *server_name;
+		json_t *server_info;
+		json_object_foreach(server_list, server_name, server_info) {
+			if (fnmatch(entry, server_name, 0)) continue;
+			if (fanout_add_target(fanout, server_name, server_info, database)) {
+				free(spec_copy);
+				return 1;
+			}
+		}
+	}
+
+	free(spec_copy);
+
+
+	return fanout->target_count == 0;
+}
+
+static json_t *fanout_merge(struct dbt_fanout *fanout) {
+	/* Use first successful result as column template */
+	json_t *template_columns = 0;
+	for (size_t i=0; i < fanout->target_count && !template_columns; i++) {
+		if (fanout->targets[i].state == DBT_FANOUT_DONE) template_columns = json_object_get(fanout->targets[i].result, "columns");
+	}
+
+
+	/* Prepare merged result (source column first) */
+	json_t *merged = json_object();
+	json_t *column_list = json_array();
+	json_array_append_new(column_list, json_string("source"));
+	size_t column_count = json_array_size(template_columns);
+	for (size_t i=0; i < column_count; i++) json_array_append(column_list, json_array_get(template_columns, i));
+	json_object_set_new(merged, "columns", column_list);
+
+
+	/* Append rows of every target in config order */
+	json_t *row_list = json_array();
+	size_t failed_count = 0;
+	int partial = 0;
+	for (size_t i=0; i < fanout->target_count; i++) {
+		struct dbt_fanout_target *target = &fanout->targets[i];
+		if (target->state != DBT_FANOUT_DONE) {
+			failed_count++;
+			continue;
+		}
+
+
+		/* Skip results with a different shape (names and order must match too) */
+		if (!json_equal(json_object_get(target->result, "columns"), template_columns)) {
+			json_object_set_new(target->result, "error", json_string("column mismatch"));
+			target->state = DBT_FANOUT_FAILED;
+			failed_count++;
+			continue;
+		}
+
+
+		/* Prefix rows with source */
+		char source[256];
+		snprintf(source, sizeof(source), "%s/%s", target->server_name, target->database);
+
+		json_t *target_rows = json_object_get(target->result, "rows");
+		size_t row_count = json_array_size(target_rows);
+		partial |= json_is_true(json_object_get(target->result, "truncated"));
+		for (size_t j=0; j < row_count; j++) {
+			json_t *row_values = json_array();
+			json_array_append_new(row_values, json_string(source));
+			json_array_extend(row_values, json_array_get(target_rows, j));
+			json_array_append_new(row_list, row_values);
+		}
+	}
+	json_object_set_new(merged, "rows", row_list);
+
+
+	/* Targets stopped at the row limit make the merge partial (their connections are closed, so nothing can be fetched later) */
+	if (partial) json_object_set_new(merged, "partial", json_true());
+
+
+	/* Report when nothing succeeded */
+	if (failed_count == fanout->target_count) json_object_set_new(merged, "error", json_string("fan-out failed on every server"));
+
+
+	return merged;
+}
+
+
+
+
+int dbt_fanout_execute(const char *spec, struct dbt_session *session) {
+	/* Check input */
+	if (!spec || !session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->q_buffer || !tab->q_buffer[0]) return 1;
+	else if (tab->state == DBT_TAB_RUNNING) return 1;
+
+
+	/* Build fan-out */
+	struct dbt_fanout *fanout = (struct dbt_fanout *)calloc(1, sizeof(struct dbt_fanout));
+	if (!fanout) return 1;
+
+	fanout->spec = strdup(spec);
+	fanout->query = strdup(tab->q_buffer);
+
+	json_t *concurrency = json_object_get(dbt_config_get(&session->config), "fanout_concurrency");
+	fanout->concurrency = json_integer_value(concurrency) > 0 ? (size_t)json_integer_value(concurrency) : DBT_FANOUT_DEFAULT_CONCURRENCY;
+
+	if (!fanout->spec || !fanout->query || fanout_parse_targets(fanout, spec, session)) {
+		dbt_fanout_free(fanout);
+		return 1;
+	}
+
+
+	/* Attach to current tab (targets are started by the event loop) */
+	tab->fanout = fanout;
+	tab->running_query = strdup(fanout->query);
+	tab->state = DBT_TAB_RUNNING;
+	clock_gettime(CLOCK_MONOTONIC, &tab->started);
+
+
+	/* Show running state */
+	dbt_results_refresh(session);
+	dbt_fanout_refresh(fanout, session);
+
+
+	return 0;
+}
+
+
+size_t dbt_fanout_collect_fds(struct dbt_fanout *fanout, struct pollfd *fds, size_t max) {
+	/* Check input */
+	if (!fanout || !fds) return 0;
+
+
+	/* Watch sockets of connecting and running targets */
+	size_t count = 0;
+	for (size_t i=0; i < fanout->target_count && count < max; i++) {
+		struct dbt_fanout_target *target = &fanout->targets[i];
+		if (target->state != DBT_FANOUT_CONNECTING && target->state != DBT_FANOUT_RUNNING) continue;
+
+		fds[count].fd = target->adapter.connection_fd(target->conn_handle, &target->adapter);
+		fds[count].events = target->events;
+		fds[count].revents = 0;
+		count++;
+	}
+
+
+	return count;
+}
+
+
+int dbt_fanout_poll(struct dbt_fanout *fanout, json_t **result, struct dbt_session *session) {
+	/* Check input */
+	if (!fanout || !result) return 0;
+
+
+	/* Advance connecting and running targets */
+	size_t in_flight = 0, finished = 0;
+	for (size_t i=0; i < fanout->target_count; i++) {
+		struct dbt_fanout_target *target = &fanout->targets[i];
+
+		if (target->state == DBT_FANOUT_CONNECTING) {
+			/* Only advance handshake once the socket is ready */
+			struct pollfd ready = { target->adapter.connection_fd(target->conn_handle, &target->adapter), target->events, 0 };
+			if (poll(&ready, 1, 0) <= 0) {
+				in_flight++;
+				continue;
+			}
+
+			int status = target->adapter.poll_connection(target->conn_handle, &target->adapter);
+			if (status < 0) fanout_target_finish(target, 0, "connection failed");
+			else if (status == 1) target->events = POLLIN;
+			else if (status == 2) target->events = POLLOUT;
+			else if (target->adapter.send_query(fanout->query, target->conn_handle, &target->adapter)) fanout_target_finish(target, 0, "send failed");
+			else {
+				target->state = DBT_FANOUT_RUNNING;
+				target->events = POLLIN;
+			}
+		} else if (target->state == DBT_FANOUT_RUNNING) {
+			if (!target->adapter.poll_query(target->conn_handle, &target->result, &target->adapter)) {
+				json_t *target_result = target->result;
+				target->result = 0;
+				fanout_target_finish(target, target_result, target_result ? 0 : "no result");
+			}
+		}
+
+		if (target->state == DBT_FANOUT_CONNECTING || target->state == DBT_FANOUT_RUNNING) in_flight++;
+		else if (target->state != DBT_FANOUT_PENDING) finished++;
+	}
+
+
+	/* Start pending targets up to the concurrency limit */
+	for (size_t i=0; i < fanout->target_count && in_flight < fanout->concurrency; i++) {
+		struct dbt_fanout_target *target = &fanout->targets[i];
+		if (target->state != DBT_FANOUT_PENDING) continue;
+
+		clock_gettime(CLOCK_MONOTONIC, &target->started);
+		target->conn_handle = target->adapter.start_connection(target->database, &target->adapter);
+		if (!target->conn_handle) {
+			fanout_target_finish(target, 0, "connection failed");
+			finished++;
+			continue;
+		}
+
+		target->state = DBT_FANOUT_CONNECTING;
+		target->events = POLLOUT;
+		in_flight++;
+	}
+
+
+	/* Show per-server progress */
+	dbt_fanout_refresh(fanout, session);
+
+
+	/* Merge once every target finished */
+	if (finished < fanout->target_count) return 1;
+	*result = fanout_merge(fanout);
+
+
+	return 0;
+}
+
+
+int dbt_fanout_cancel(struct dbt_fanout *fanout) {
+	/* Check input */
+	if (!fanout) return 1;
+
+
+	/* Cancel running targets, drop pending ones */
+	for (size_t i=0; i < fanout->target_count; i++) {
+		struct dbt_fanout_target *target = &fanout->targets[i];
+
+		if (target->state == DBT_FANOUT_RUNNING) target->adapter.cancel_query(target->conn_handle, &target->adapter);
+		else if (target->state == DBT_FANOUT_PENDING || target->state == DBT_FANOUT_CONNECTING) {
+			clock_gettime(CLOCK_MONOTONIC, &target->started);
+			fanout_target_finish(target, 0, "cancelled");
+		}
+	}
+
+
+	return 0;
+}
+
+
+int dbt_fanout_refresh(struct dbt_fanout *fanout, struct dbt_session *session) {
+	/* Check input */
+	if (!fanout || !session) return 1;
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+
+
+	/* Clear previous content */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Fan-out (%zu servers)", fanout->target_count);
+
+
+	/* Print per-server latency and errors */
+	int max_y = getmaxy(win), max_x = getmaxx(win);
+	int name_width = max_x / 2 - 2;
+	for (size_t i=0; i < fanout->target_count && (int)i < max_y-2; i++) {
+		struct dbt_fanout_target *target = &fanout->targets[i];
+		mvwprintw(win, i+1, 2, "%-*.*s ", name_width, name_width, target->server_name);
+
+		switch (target->state) {
+			case DBT_FANOUT_PENDING:
+				wprintw(win, "..");
+				break;
+			case DBT_FANOUT_CONNECTING:
+			case DBT_FANOUT_RUNNING:
+				wprintw(win, "~ %.0fms", fanout_elapsed_us(&target->started) / 1000.0);
+				break;
+			case DBT_FANOUT_DONE:
+				wprintw(win, "%.1fms %zur", target->duration_us / 1000.0, json_array_size(json_object_get(target->result, "rows")));
+				break;
+			case DBT_FANOUT_FAILED: {
+				const char *error = json_string_value(json_object_get(target->result, "error"));
+				wprintw(win, "! %.*s", (int)strcspn(error, "\n"), error);
+				break;
+			}
+		}
+
+		wmove(win, i+1, max_x-1);
+		waddch(win, ACS_VLINE);
+	}
+
+	wrefresh(win);
+
+
+	return 0;
+}
+
+
+void dbt_fanout_free(struct dbt_fanout *fanout) {
+	/* Check input */
+	if (!fanout) return;
+
+
+	/* Release targets */
+	for (size_t i=0; i < fanout->target_count; i++) {
+		struct dbt_fanout_target *target = &fanout->targets[i];
+		if (target->conn_handle) target->adapter.close_connection(target->conn_handle, &target->adapter);
+
+		free(target->database);
+		json_decref(target->result);
+	}
+
+	free(fanout->targets);
+	free(fanout->spec);
+	free(fanout->query);
+	free(fanout);
+}
@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_FORMAT_SAMPLE_HEAD 1000
+#define DBT_FORMAT_SAMPLE_STRIDED 1000
+#define DBT_FORMAT_MAX_WIDTH 40
+#define DBT_FORMAT_NULL "\xE2\x88\x85"
+
+
+/* Helper functions */
+static int codepoint_width(uint32_t codepoint) {
+	/* Zero width: combining marks and zero width space/joiners */
+	if ((codepoint >= 0x0300 && codepoint <= 0x036F) || (codepoint >= 0x200B && codepoint <= 0x200F)) return 0;
+
+
+	/* Double width: East Asian wide/fullwidth and emoji blocks */
+	if ((codepoint >= 0x1100 && codepoint <= 0x115F) ||
+		(codepoint >= 0x2E80 && codepoint <= 0xA4CF) ||
+		(codepoint >= 0xAC00 && codepoint <= 0xD7A3) ||
+		(codepoint >= 0xF900 && codepoint <= 0xFAFF) ||
+		(codepoint >= 0xFE30 && codepoint <= 0xFE4F) ||
+		(codepoint >= 0xFF00 && codepoint <= 0xFF60) ||
+		(codepoint >= 0xFFE0 && codepoint <= 0xFFE6) ||
+		(codepoint >= 0x1F300 && codepoint <= 0x1F64F) ||
+		(codepoint >= 0x1F900 && codepoint <= 0x1F9FF) ||
+		(codepoint >= 0x20000 && codepoint <= 0x3FFFD)) return 2;
+
+
+	return 1;
+}
+
+static uint32_t decode_utf8(const unsigned char *value, uint32_t length, uint32_t *consumed) {
+	/* Decode one codepoint (invalid bytes count as one replacement character) */
+	unsigned char lead = value[0];
+	uint32_t needed = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+	if (lead < 0x80 || needed >= length) {
+		*consumed = 1;
+		return lead < 0x80 ? lead : 0xFFFD;
+	}
+
+	uint32_t codepoint = lead & (0x3F >> needed);
+	for (uint32_t i=1; i <= needed; i++) {
+		if ((value[i] & 0xC0) != 0x80) {
+			*consumed = 1;
+			return 0xFFFD;
+		}
+		codepoint = (codepoint << 6) | (value[i] & 0x3F);
+	}
+	*consumed = needed + 1;
+
+
+	return codepoint;
+}
+
+static void widen_column(struct dbt_resultset *resultset, size_t column, uint32_t row) {
+	struct dbt_resultset_column *format_column = &resultset->columns[column];
+	if (format_column->display_width >= DBT_FORMAT_MAX_WIDTH) return;
+
+	int width = DBT_RESULTSET_NULL(format_column, row) ? 1 : dbt_format_width(format_column->values[row], format_column->lengths[row]);
+	if (width > format_column->display_width) format_column->display_width = width < DBT_FORMAT_MAX_WIDTH ? width : DBT_FORMAT_MAX_WIDTH;
+}
+
+
+
+
+int dbt_format_width(const char *value, uint32_t length) {
+	/* Check input */
+	if (!value) return 0;
+	const unsigned char *bytes = (const unsigned char *)value;
+
+
+	/* Fast path: 8 bytes at a time while the text is pure ASCII */
+	uint32_t i = 0;
+	int width = 0;
+	for (; i + 8 <= length; i += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + i, sizeof(word));
+		if (word & 0x8080808080808080ull) break;
+		width += 8;
+	}
+
+
+	/* Slow path: decode remaining codepoints */
+	while (i < length) {
+		if (bytes[i] < 0x80) {
+			width++;
+			i++;
+			continue;
+		}
+
+		uint32_t consumed;
+		uint32_t codepoint = decode_utf8(bytes + i, length - i, &consumed);
+		width += codepoint_width(codepoint);
+		i += consumed;
+	}
+
+
+	return width;
+}
+
+
+size_t dbt_format_cell(char *out, size_t out_size, const char *value, uint32_t length, int width, int right_align) {
+	/* Check input */
+	if (!out || out_size < (size_t)width * 4 + 1) return 0;
+	if (!value) length = 0;
+	const unsigned char *bytes = (const unsigned char *)value;
+
+
+	/* Copy codepoints that fit (one column is kept for the ellipsis when truncating) */
+	int value_width = dbt_format_width(value, length);
+	int truncate = value_width > width;
+	int budget = truncate ? width - 1 : width;
+
+
+	/* Bytes are bounded too: zero width codepoints take bytes but no columns (room stays for ellipsis, padding and terminator) */
+	char text[DBT_FORMAT_MAX_WIDTH * 4 + 4];
+	size_t ellipsis_len = truncate ? 3 : 0;
+	size_t text_len = 0;
+	int text_width = 0;
+	for (uint32_t i=0; i < length && text_len + 4 < sizeof(text);) {
+		uint32_t consumed;
+		uint32_t codepoint = decode_utf8(bytes + i, length - i, &consumed);
+		int char_width = codepoint < 0x80 ? 1 : codepoint_width(codepoint);
+		if (text_width + char_width > budget) break;
+		else if (text_len + consumed + ellipsis_len + (size_t)(budget - text_width - char_width) + 1 > out_size) break;
+
+		if (codepoint < 0x20 || codepoint == 0x7F) text[text_len++] = ' ';
+		else {
+			memcpy(text + text_len, bytes + i, consumed);
+			text_len += consumed;
+		}
+
+		text_width += char_width;
+		i += consumed;
+	}
+
+	if (truncate && budget >= 0) {
+		memcpy(text + text_len, "\xE2\x80\xA6", 3);
+		text_len += 3;
+		text_width++;
+	}
+
+
+	/* Pad to width */
+	size_t out_len = 0;
+	int padding = width - text_width;
+	if (right_align) for (; padding > 0; padding--) out[out_len++] = ' ';
+	memcpy(out + out_len, text, text_len);
+	out_len += text_len;
+	for (; padding > 0; padding--) out[out_len++] = ' ';
+	out[out_len] = 0;
+
+
+	return out_len;
+}
+
+
+void dbt_format_line(char *line, size_t line_size, int max_width, struct dbt_resultset *resultset, int64_t row) {
+	/* Check input (joins cells, or headers when row < 0, until the width is used up) */
+	if (!line || !line_size || !resultset) return;
+
+	size_t line_len = 0;
+	int line_width = 0;
+	line[0] = 0;
+
+	for (size_t j=0; j < resultset->column_count && line_width < max_width; j++) {
+		struct dbt_resultset_column *column = &resultset->columns[j];
+		const char *value = row < 0 ? column->name : column->values[row];
+		uint32_t length = row < 0 ? strlen(column->name) : column->lengths[row];
+		if (row >= 0 && DBT_RESULTSET_NULL(column, row)) {
+			/* NULL shown as empty set sign, empty text stays blank */
+			value = DBT_FORMAT_NULL;
+			length = sizeof(DBT_FORMAT_NULL) - 1;
+		}
+
+
+		/* Separator (line stays terminated if the cell does not fit) */
+		if (j) {
+			if (line_width + 3 > max_width) break;
+			memcpy(line + line_len, " | ", 3);
+			line_len += 3;
+			line_width += 3;
+			line[line_len] = 0;
+		}
+
+
+		/* Cell clipped to remaining width, numbers right aligned */
+		int width = column->display_width;
+		if (width > max_width - line_width) width = max_width - line_width;
+		size_t cell_len = dbt_format_cell(line + line_len, line_size - line_len, value, length, width, row >= 0 && column->is_numeric);
+		if (!cell_len) break;
+
+		line_len += cell_len;
+		line_width += width;
+	}
+}
+
+
+void dbt_format_measure(struct dbt_resultset *resultset) {
+	/* Check input */
+	if (!resultset || resultset->format_ready) return;
+
+
+	/* Start from header widths */
+	for (size_t j=0; j < resultset->column_count; j++) {
+		struct dbt_resultset_column *column = &resultset->columns[j];
+		int width = dbt_format_width(column->name, strlen(column->name));
+		column->display_width = width < DBT_FORMAT_MAX_WIDTH ? width : DBT_FORMAT_MAX_WIDTH;
+		if (column->display_width < 1) column->display_width = 1;
+	}
+
+
+	/* Sample leading rows plus evenly strided rows (by row id, so sort/filter keep the cache valid) */
+	size_t head = resultset->row_count < DBT_FORMAT_SAMPLE_HEAD ? resultset->row_count : DBT_FORMAT_SAMPLE_HEAD;
+	size_t stride = resultset->row_count / DBT_FORMAT_SAMPLE_STRIDED;
+	for (size_t j=0; j < resultset->column_count; j++) {
+		for (size_t i=0; i < head; i++) widen_column(resultset, j, i);
+		if (stride > 1) for (size_t i=head; i < resultset->row_count; i += stride) widen_column(resultset, j, i);
+	}
+
+	resultset->format_ready = 1;
+}
+
+
+void dbt_format_widen(struct dbt_resultset *resultset, size_t offset, size_t count) {
+	/* Check input */
+	if (!resultset) return;
+
+
+	/* Widen with rows about to be shown (widths only grow, so scrolling back never rescans) */
+	for (size_t i=offset; i < offset + count && i < resultset->view_count; i++) {
+		uint32_t row = resultset->view[i];
+		for (size_t j=0; j < resultset->column_count; j++) widen_column(resultset, j, row);
+	}
+}
@@ -0,0 +1,476 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_HISTORY_MAGIC "DBTHIST1"
+#define DBT_HISTORY_MAGIC_LEN 8
+#define DBT_HISTORY_MAX_MATCHES 64
+#define DBT_HISTORY_TRIGRAM_BITS 14
+
+
+/* On-disk record header, followed by "server\0database\0query\0" (padded to 8 bytes) */
+struct dbt_history_record {
+	uint32_t length;
+	uint32_t flags;
+	int64_t timestamp;
+	uint64_t duration_us;
+	uint64_t row_count;
+	uint16_t server_len;
+	uint16_t database_len;
+	uint32_t query_len;
+};
+
+
+/* Helper functions */
+static const struct dbt_history *history_sort_ctx;
+
+static const char *history_entry_query(const struct dbt_history *history, size_t ind, struct dbt_history_record *record) {
+	const char *base = (const char *)history->map + history->entries[ind];
+	memcpy(record, base, sizeof(*record));
+
+	return base + sizeof(*record) + record->server_len + 1 + record->database_len + 1;
+}
+
+static int history_compare_queries(const void *a, const void *b) {
+	struct dbt_history_record record;
+	const char *query_a = history_entry_query(history_sort_ctx, *(const size_t *)a, &record);
+	const char *query_b = history_entry_query(history_sort_ctx, *(const size_t *)b, &record);
+
+	int cmp = strcmp(query_a, query_b);
+	if (cmp) return cmp;
+
+	/* Keep equal queries in chronological order */
+	return (*(const size_t *)a > *(const size_t *)b) - (*(const size_t *)a < *(const size_t *)b);
+}
+
+static int history_record_fits(const char *base, const struct dbt_history_record *record) {
+	/* Strings must lie inside the record and be terminated where their lengths say */
+	size_t server_end = sizeof(*record) + record->server_len;
+	size_t database_end = server_end + 1 + record->database_len;
+	size_t query_end = database_end + 1 + record->query_len;
+	if (query_end >= record->length) return 0;
+
+	return !base[server_end] && !base[database_end] && !base[query_end];
+}
+
+static void history_index_insert(struct dbt_history *history, size_t ind) {
+	/* Binary search for insert position of entry (upper bound, so equal queries stay chronological) */
+	size_t lo = 0, hi = ind;
+	history_sort_ctx = history;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (history_compare_queries(&history->prefix_index[mid], &ind) < 0) lo = mid + 1;
+		else hi = mid;
+	}
+	history_sort_ctx = 0;
+
+
+	/* Shift larger entries up */
+	memmove(history->prefix_index + lo + 1, history->prefix_index + lo, (ind - lo) * sizeof(size_t));
+	history->prefix_index[lo] = ind;
+}
+
+static inline size_t history_trigram(const char *text) {
+	/* Bucket of three bytes (collisions only cost a verification) */
+	uint32_t key = (uint32_t)(unsigned char)text[0] << 16 | (uint32_t)(unsigned char)text[1] << 8 | (unsigned char)text[2];
+	return (key * 2654435761u) >> (32 - DBT_HISTORY_TRIGRAM_BITS);
+}
+
+static int history_trigram_add(struct dbt_history *history, size_t ind) {
+	/* Post entry once per bucket of its query (entries arrive in order, so the last posting tells) */
+	struct dbt_history_record record;
+	const char *query = history_entry_query(history, ind, &record);
+	for (uint32_t i=0; i + 3 <= record.query_len; i++) {
+		struct dbt_history_postings *postings = &history->trigrams[history_trigram(query + i)];
+		if (postings->count && postings->entries[postings->count - 1] == ind) continue;
+
+		if (postings->count == postings->cap) {
+			uint32_t new_cap = postings->cap ? postings->cap * 2 : 8;
+			uint32_t *entries = (uint32_t *)realloc(postings->entries, new_cap * sizeof(uint32_t));
+			if (!entries) return 1;
+			postings->entries = entries;
+			postings->cap = new_cap;
+		}
+		postings->entries[postings->count++] = (uint32_t)ind;
+	}
+
+
+	return 0;
+}
+
+static int history_map(struct dbt_history *history) {
+	/* Check file size */
+	struct stat st;
+	if (fstat(history->fd, &st)) return 1;
+	if ((size_t)st.st_size < history->indexed_end) {
+		/* File was truncated behind our back, index from scratch */
+		history->entry_count = 0;
+		history->indexed_end = 0;
+		history->prefix_ready = 0;
+		history->trigram_ready = 0;
+	}
+	if (st.st_size <= DBT_HISTORY_MAGIC_LEN) return 0;
+
+
+	/* Map whole file, growing an existing mapping in place when possible (entries are offsets, so it may move) */
+	if (!history->map) {
+		void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, history->fd, 0);
+		if (map == MAP_FAILED) return 1;
+		history->map = map;
+	} else if ((size_t)st.st_size != history->map_size) {
+		void *map = mremap(history->map, history->map_size, st.st_size, MREMAP_MAYMOVE);
+		if (map == MAP_FAILED) return 1;
+		history->map = map;
+	}
+	history->map_size = st.st_size;
+
+
+	/* Index new record offsets (log is append-only, a torn trailing record is ignored, damaged records are skipped) */
+	size_t offset = history->indexed_end ? history->indexed_end : DBT_HISTORY_MAGIC_LEN;
+	while (offset + sizeof(struct dbt_history_record) <= history->map_size) {
+		const char *base = (const char *)history->map + offset;
+		struct dbt_history_record record;
+		memcpy(&record, base, sizeof(record));
+		if (record.length < sizeof(record) || record.length > history->map_size - offset) break;
+		else if (!history_record_fits(base, &record)) {
+			offset += record.length;
+			continue;
+		}
+
+		if (history->entry_count >= history->entry_cap) {
+			size_t new_cap = history->entry_cap ? history->entry_cap * 2 : 1024;
+			size_t *entries = (size_t *)realloc(history->entries, new_cap * sizeof(size_t));
+			if (!entries) return 1;
+			history->entries = entries;
+
+			if (history->prefix_ready) {
+				size_t *prefix_index = (size_t *)realloc(history->prefix_index, new_cap * sizeof(size_t));
+				if (!prefix_index) return 1;
+				history->prefix_index = prefix_index;
+			}
+
+			history->entry_cap = new_cap;
+		}
+		history->entries[history->entry_count] = offset;
+
+
+		/* Keep built indices current instead of rebuilding them */
+		if (history->prefix_ready) history_index_insert(history, history->entry_count);
+		if (history->trigram_ready && history_trigram_add(history, history->entry_count)) history->trigram_ready = 0;
+		history->entry_count++;
+
+		offset += record.length;
+	}
+	history->indexed_end = offset;
+
+
+	return 0;
+}
+
+static int history_build_prefix_index(struct dbt_history *history) {
+	/* Sort entry indices by query text (built lazily on first prefix search) */
+	size_t *prefix_index = (size_t *)realloc(history->prefix_index, (history->entry_cap + 1) * sizeof(size_t));
+	if (!prefix_index) return 1;
+	history->prefix_index = prefix_index;
+
+	for (size_t i=0; i < history->entry_count; i++) prefix_index[i] = i;
+
+	history_sort_ctx = history;
+	qsort(prefix_index, history->entry_count, sizeof(size_t), history_compare_queries);
+	history_sort_ctx = 0;
+
+	history->prefix_ready = 1;
+
+
+	return 0;
+}
+
+static size_t history_find_prefix(struct dbt_history *history, const char *prefix, size_t *matches, size_t max_matches) {
+	/* Build index if needed */
+	if (!history->prefix_ready && history_build_prefix_index(history)) return 0;
+
+
+	/* Binary search for first query >= prefix */
+	size_t prefix_len = strlen(prefix);
+	size_t lo = 0, hi = history->entry_count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		struct dbt_history_record record;
+		const char *query = history_entry_query(history, history->prefix_index[mid], &record);
+		if (strncmp(query, prefix, prefix_len) < 0) lo = mid + 1;
+		else hi = mid;
+	}
+
+
+	/* Walk matching range, keeping the newest entries */
+	size_t match_count = 0;
+	for (size_t i=lo; i < history->entry_count; i++) {
+		struct dbt_history_record record;
+		size_t ind = history->prefix_index[i];
+		const char *query = history_entry_query(history, ind, &record);
+		if (strncmp(query, prefix, prefix_len)) break;
+
+		if (match_count < max_matches) {
+			matches[match_count++] = ind;
+			continue;
+		}
+
+		/* Replace oldest kept match */
+		size_t oldest = 0;
+		for (size_t j=1; j < match_count; j++) if (matches[j] < matches[oldest]) oldest = j;
+		if (ind > matches[oldest]) matches[oldest] = ind;
+	}
+
+
+	/* Order newest first */
+	for (size_t i=1; i < match_count; i++) {
+		size_t value = matches[i], j = i;
+		for (; j > 0 && matches[j-1] < value; j--) matches[j] = matches[j-1];
+		matches[j] = value;
+	}
+
+
+	return match_count;
+}
+
+static int history_build_trigram_index(struct dbt_history *history) {
+	/* Post every entry (built lazily on first substring search, buckets keep their memory when rebuilt) */
+	if (history->entry_count > UINT32_MAX) return 1;
+	if (!history->trigrams) {
+		history->trigrams = (struct dbt_history_postings *)calloc((size_t)1 << DBT_HISTORY_TRIGRAM_BITS, sizeof(struct dbt_history_postings));
+		if (!history->trigrams) return 1;
+	}
+
+	for (size_t i=0; i < ((size_t)1 << DBT_HISTORY_TRIGRAM_BITS); i++) history->trigrams[i].count = 0;
+	for (size_t i=0; i < history->entry_count; i++) {
+		if (history_trigram_add(history, i)) return 1;
+	}
+
+	history->trigram_ready = 1;
+
+
+	return 0;
+}
+
+static size_t history_find_substring(struct dbt_history *history, const char *needle, size_t *matches, size_t max_matches) {
+	/* Candidates come from the needle's rarest trigram, needles shorter than a trigram (or without an index) scan every entry */
+	size_t needle_len = strlen(needle);
+	const struct dbt_history_postings *rarest = 0;
+	if (needle_len >= 3 && (history->trigram_ready || !history_build_trigram_index(history))) {
+		for (size_t i=0; i + 3 <= needle_len; i++) {
+			const struct dbt_history_postings *postings = &history->trigrams[history_trigram(needle + i)];
+			if (!rarest || postings->count < rarest->count) rarest = postings;
+		}
+	}
+
+
+	/* Verify candidates newest to oldest */
+	size_t candidate_count = rarest ? rarest->count : history->entry_count;
+	size_t match_count = 0;
+	for (size_t i=candidate_count; i > 0 && match_count < max_matches; i--) {
+		size_t ind = rarest ? rarest->entries[i-1] : i-1;
+		struct dbt_history_record record;
+		const char *query = history_entry_query(history, ind, &record);
+
+		if (memmem(query, record.query_len, needle, needle_len)) matches[match_count++] = ind;
+	}
+
+
+	return match_count;
+}
+
+
+
+
+int dbt_history_load(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_history *history = &session->history;
+	memset(history, 0, sizeof(*history));
+	history->fd = -1;
+
+
+	/* Determine history path */
+	const char *home_dir = getenv("HOME");
+	if (!home_dir) return 1;
+
+	char dir_path[4096];
+	snprintf(dir_path, sizeof(dir_path), "%s/.dbtui", home_dir);
+	mkdir(dir_path, 0700);
+
+	char history_path[4096];
+	snprintf(history_path, sizeof(history_path), "%s/.dbtui/history.log", home_dir);
+
+
+	/* Open (or create) history log */
+	history->fd = open(history_path, O_RDWR | O_CREAT | O_APPEND, 0600);
+	if (history->fd < 0) return 1;
+
+
+	/* Write header into new file, reject foreign files */
+	char magic[DBT_HISTORY_MAGIC_LEN];
+	ssize_t magic_len = pread(history->fd, magic, sizeof(magic), 0);
+	if (magic_len == 0) {
+		if (write(history->fd, DBT_HISTORY_MAGIC, DBT_HISTORY_MAGIC_LEN) != DBT_HISTORY_MAGIC_LEN) return 1;
+	} else if (magic_len != DBT_HISTORY_MAGIC_LEN || memcmp(magic, DBT_HISTORY_MAGIC, DBT_HISTORY_MAGIC_LEN)) {
+		close(history->fd);
+		history->fd = -1;
+		return 1;
+	}
+
+
+	return history_map(history);
+}
+
+
+int dbt_history_append(const char *query, const char *server, const char *database, uint64_t duration_us, uint64_t row_count, int failed, struct dbt_session *session) {
+	/* Check input */
+	if (!query || !session) return 1;
+	struct dbt_history *history = &session->history;
+	if (history->fd < 0) return 1;
+
+
+	/* Prepare record */
+	if (!server) server = "";
+	if (!database) database = "";
+
+	struct dbt_history_record record = {0};
+	record.flags = failed ? DBT_HISTORY_FAILED : 0;
+	record.timestamp = (int64_t)time(0);
+	record.duration_us = duration_us;
+	record.row_count = row_count;
+	record.server_len = (uint16_t)strnlen(server, UINT16_MAX);
+	record.database_len = (uint16_t)strnlen(database, UINT16_MAX);
+	record.query_len = (uint32_t)strlen(query);
+
+	size_t payload_len = record.server_len + 1 + record.database_len + 1 + record.query_len + 1;
+	record.length = (uint32_t)((sizeof(record) + payload_len + 7) & ~(size_t)7);
+
+
+	/* Serialize and append in a single write */
+	char *buffer = (char *)calloc(record.length, sizeof(char));
+	if (!buffer) return 1;
+
+	char *cursor = buffer;
+	memcpy(cursor, &record, sizeof(record));
+	cursor += sizeof(record);
+	memcpy(cursor, server, record.server_len);
+	cursor += record.server_len + 1;
+	memcpy(cursor, database, record.database_len);
+	cursor += record.database_len + 1;
+	memcpy(cursor, query, record.query_len);
+
+	ssize_t written = write(history->fd, buffer, record.length);
+	free(buffer);
+	if (written != (ssize_t)record.length) return 1;
+
+
+	/* Grow mapping and indices by the new entry */
+	return history_map(history);
+}
+
+
+int dbt_history_search(const char *pattern, struct dbt_session *session) {
+	/* Check input */
+	if (!pattern || !session) return 1;
+	struct dbt_history *history = &session->history;
+	if (!history->map) return 1;
+
+
+	/* Find matches ('^' searches by prefix, anything else by substring) */
+	size_t matches[DBT_HISTORY_MAX_MATCHES];
+	size_t match_count;
+	if (pattern[0] == '^') match_count = history_find_prefix(history, pattern+1, matches, DBT_HISTORY_MAX_MATCHES);
+	else match_count = history_find_substring(history, pattern, matches, DBT_HISTORY_MAX_MATCHES);
+
+
+	/* Clear result window */
+	WINDOW *win = session->app_windows[DBT_WIN_RESULT];
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "History (%zu/%zu)", match_count, history->entry_count);
+
+
+	/* Print matches */
+	int max_y = getmaxy(win), max_x = getmaxx(win);
+	for (size_t i=0; i < match_count && (int)i < max_y-2; i++) {
+		struct dbt_history_record record;
+		const char *query = history_entry_query(history, matches[i], &record);
+		const char *server = (const char *)history->map + history->entries[matches[i]] + sizeof(record);
+		const char *database = server + record.server_len + 1;
+
+		char time_str[32];
+		time_t timestamp = (time_t)record.timestamp;
+		strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", localtime(&timestamp));
+
+		char prefix[512];
+		int prefix_len = snprintf(prefix, sizeof(prefix), "%s %s/%s %8.1fms %8llu%s ",
+			time_str, server, database, record.duration_us / 1000.0,
+			(unsigned long long)record.row_count, (record.flags & DBT_HISTORY_FAILED) ? "!" : " ");
+
+
+		/* Query gets the columns left inside the box (up to its first line break, long prefixes are clipped too) */
+		int width = max_x - 4;
+		if (width <= 0) continue;
+		if (prefix_len >= (int)sizeof(prefix)) prefix_len = sizeof(prefix) - 1;
+		mvwaddnstr(win, i+1, 2, prefix, width);
+
+		int query_len = (int)strcspn(query, "\t\r\n");
+		if (prefix_len < width) waddnstr(win, query, query_len < width - prefix_len ? query_len : width - prefix_len);
+	}
+
+	wrefresh(win);
+
+
+	/* Load newest match into current query buffer */
+	if (!match_count) return 1;
+
+	struct dbt_history_record record;
+	const char *query = history_entry_query(history, matches[0], &record);
+
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->q_buffer) {
+		tab->q_buffer = (char *)calloc(4096, sizeof(char));
+		if (!tab->q_buffer) return 1;
+	}
+
+	size_t query_len = record.query_len < 4095 ? record.query_len : 4095;
+	memcpy(tab->q_buffer, query, query_len);
+	tab->q_buffer[query_len] = 0;
+	tab->q_buffer_head = query_len;
+
+
+	return dbt_session_refresh_query(session);
+}
+
+
+void dbt_history_close(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+	struct dbt_history *history = &session->history;
+
+
+	/* Release mapping, indices and file */
+	if (history->map) munmap(history->map, history->map_size);
+	free(history->entries);
+	free(history->prefix_index);
+	for (size_t i=0; history->trigrams && i < ((size_t)1 << DBT_HISTORY_TRIGRAM_BITS); i++) free(history->trigrams[i].entries);
+	free(history->trigrams);
+	if (history->fd >= 0) close(history->fd);
+
+	memset(history, 0, sizeof(*history));
+	history->fd = -1;
+}
@@ -0,0 +1,507 @@
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_IMPORT_CHUNK (1 << 20)
+#define DBT_IMPORT_RENDER_MS 250
+
+
+/* Helper functions */
+static uint64_t import_elapsed_us(const struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) * 1000000ull + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static size_t import_scan_record(const char *data, size_t length, int csv, size_t *fields) {
+	/* Length of first complete record including its newline (0 when incomplete), counts fields outside quotes */
+	char delimiter = csv ? ',' : '\t';
+	int in_quotes = 0;
+	*fields = 1;
+
+	for (size_t i=0; i < length; i++) {
+		char c = data[i];
+		if (csv && c == '"') in_quotes = !in_quotes;
+		else if (in_quotes) continue;
+		else if (!csv && c == '\\') i++;
+		else if (c == delimiter) (*fields)++;
+		else if (c == '\n') return i + 1;
+	}
+
+
+	return 0;
+}
+
+static void import_wake(struct dbt_import *import, char reason) {
+	/* Full pipe already holds a pending wake-up */
+	ssize_t written = write(import->wake_fds[1], &reason, 1);
+	(void)written;
+}
+
+static int import_push(struct dbt_import *import, char *data, size_t length, size_t rows) {
+	/* Wait for a free slot (bounded memory), returns 1 when stopped */
+	pthread_mutex_lock(&import->lock);
+	while (import->queue_count == DBT_IMPORT_QUEUE && !import->stop) pthread_cond_wait(&import->cond, &import->lock);
+
+	int stopped = import->stop;
+	if (!stopped) {
+		struct dbt_import_chunk *chunk = &import->queue[(import->queue_head + import->queue_count) % DBT_IMPORT_QUEUE];
+		chunk->data = data;
+		chunk->length = length;
+		chunk->rows = rows;
+		import->queue_count++;
+	}
+	pthread_mutex_unlock(&import->lock);
+
+
+	/* Wake event loop */
+	if (!stopped) import_wake(import, 'c');
+
+
+	return stopped;
+}
+
+static void *import_reader(void *arg) {
+	struct dbt_import *import = (struct dbt_import *)arg;
+	char *carry = 0;
+	size_t carry_len = 0;
+	uint64_t row = 1;
+	char error[128] = "";
+
+
+	/* Read chunks, cut at the last complete record (partial record moves to the next chunk) */
+	for (;;) {
+		char *buffer = (char *)malloc(carry_len + DBT_IMPORT_CHUNK + 1);
+		if (!buffer) {
+			snprintf(error, sizeof(error), "out of memory");
+			break;
+		}
+
+		if (carry_len) memcpy(buffer, carry, carry_len);
+		free(carry);
+		carry = 0;
+
+		size_t read_len = fread(buffer + carry_len, 1, DBT_IMPORT_CHUNK, import->file);
+		size_t length = carry_len + read_len;
+		int eof = read_len < DBT_IMPORT_CHUNK;
+		if (eof && ferror(import->file)) {
+			snprintf(error, sizeof(error), "read failed");
+			free(buffer);
+			break;
+		}
+
+		/* Last record may lack its newline */
+		if (eof && length && buffer[length - 1] != '\n') buffer[length++] = '\n';
+
+
+		/* Validate field count of every complete record */
+		size_t cut = 0, rows = 0, fields;
+		for (size_t record_len; cut < length && (record_len = import_scan_record(buffer + cut, length - cut, import->csv, &fields)); cut += record_len) {
+			if (fields != import->expected_fields) {
+				snprintf(error, sizeof(error), "row %llu: %zu fields, table expects %zu", (unsigned long long)(row + rows), fields, import->expected_fields);
+				break;
+			}
+			rows++;
+		}
+		if (error[0]) {
+			free(buffer);
+			break;
+		}
+		row += rows;
+
+
+		/* Keep partial record for next chunk (a record longer than a chunk just grows the buffer) */
+		carry_len = length - cut;
+		if (carry_len && eof) {
+			snprintf(error, sizeof(error), "row %llu: unterminated quoted field", (unsigned long long)row);
+			free(buffer);
+			break;
+		} else if (carry_len) {
+			carry = (char *)malloc(carry_len);
+			if (!carry) {
+				snprintf(error, sizeof(error), "out of memory");
+				free(buffer);
+				break;
+			}
+			memcpy(carry, buffer + cut, carry_len);
+		}
+
+
+		/* Hand over chunk while the event loop sends the previous one */
+		if (!cut) free(buffer);
+		else if (import_push(import, buffer, cut, rows)) {
+			free(buffer);
+			break;
+		}
+
+		if (eof) break;
+	}
+
+	free(carry);
+
+
+	/* Report end of input */
+	pthread_mutex_lock(&import->lock);
+	snprintf(import->reader_error, sizeof(import->reader_error), "%s", error);
+	import->reader_done = 1;
+	pthread_mutex_unlock(&import->lock);
+
+	import_wake(import, 'd');
+
+
+	return 0;
+}
+
+static int import_render(struct dbt_session *session, int force) {
+	struct dbt_import *import = &session->import;
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+
+
+	/* Throttled while chunks stream out, properties pane belongs to the dashboard while it runs */
+	if (session->dashboard.active) return 0;
+	else if (!force && import_elapsed_us(&import->last_render) < DBT_IMPORT_RENDER_MS * 1000ull) return 0;
+	clock_gettime(CLOCK_MONOTONIC, &import->last_render);
+
+
+	/* Clear previous content */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Import %s", import->active ? "(running)" : import->failed ? "(failed)" : "(done)");
+
+
+	/* Print progress and throughput */
+	int width = getmaxx(win) - 4;
+	double seconds = (import->active ? import_elapsed_us(&import->started) : import->duration_us) / 1e6;
+	char line[256];
+
+	int y = 1;
+	snprintf(line, sizeof(line), "%s.%s", import->schema, import->table);
+	mvwaddnstr(win, y++, 2, line, width);
+	snprintf(line, sizeof(line), "%s (%s)", import->path ? import->path : "", import->csv ? "csv" : "tsv");
+	mvwaddnstr(win, y++, 2, line, width);
+	mvwprintw(win, y++, 2, "Rows      %llu (%.0f/s)", (unsigned long long)import->rows, seconds > 0 ? import->rows / seconds : 0);
+	mvwprintw(win, y++, 2, "Sent      %.1f/%.1f MB (%.0f%%)", import->bytes / 1048576.0, import->file_size / 1048576.0, import->file_size ? 100.0 * import->bytes / import->file_size : 100.0);
+	mvwprintw(win, y++, 2, "Rate      %.1f MB/s", seconds > 0 ? import->bytes / 1048576.0 / seconds : 0);
+	mvwprintw(win, y++, 2, "Elapsed   %.1fs", seconds);
+
+	if (import->message[0]) mvwaddnstr(win, getmaxy(win) - 2, 2, import->message, width);
+
+
+	/* Refresh window */
+	wrefresh(win);
+
+
+	return 1;
+}
+
+static void import_finish(struct dbt_session *session, const char *format, ...) {
+	struct dbt_import *import = &session->import;
+
+
+	/* Stop reader and drop queued chunks */
+	if (import->reader_started) {
+		pthread_mutex_lock(&import->lock);
+		import->stop = 1;
+		pthread_cond_broadcast(&import->cond);
+		pthread_mutex_unlock(&import->lock);
+
+		pthread_join(import->reader, 0);
+		import->reader_started = 0;
+	}
+
+	for (size_t i=0; i < import->queue_count; i++) free(import->queue[(import->queue_head + i) % DBT_IMPORT_QUEUE].data);
+	free(import->sending.data);
+	import->queue_count = 0;
+	import->sending.data = 0;
+
+
+	/* Closing the connection mid-copy rolls the import back */
+	if (import->conn_handle) import->adapter.close_connection(import->conn_handle, &import->adapter);
+	if (import->file) fclose(import->file);
+	import->conn_handle = 0;
+	import->file = 0;
+
+
+	/* Keep summary on screen */
+	import->duration_us = import_elapsed_us(&import->started);
+	import->active = 0;
+	import->failed = format != 0;
+	if (format) {
+		va_list args;
+		va_start(args, format);
+		vsnprintf(import->message, sizeof(import->message), format, args);
+		va_end(args);
+	} else snprintf(import->message, sizeof(import->message), "committed");
+
+	import_render(session, 1);
+}
+
+static int import_read_header(struct dbt_import *import, json_t *columns, struct dbt_session *session) {
+	/* First line names columns when every field is a column of the table (BOM skipped) */
+	char *line = 0;
+	size_t line_cap = 0;
+	ssize_t line_len = getline(&line, &line_cap, import->file);
+	if (line_len <= 0) {
+		free(line);
+		return 0;
+	}
+
+	char *field = line;
+	long bom = line_len >= 3 && !memcmp(field, "\xEF\xBB\xBF", 3) ? 3 : 0;
+	field += bom;
+	while (line_len && (line[line_len-1] == '\n' || line[line_len-1] == '\r')) line[--line_len] = 0;
+
+
+	/* Split plain or quoted names */
+	char delimiter = import->csv ? ',' : '\t';
+	int header = 1;
+	while (header) {
+		char name[256];
+		size_t name_len = 0;
+		int quoted = import->csv && *field == '"';
+		if (quoted) field++;
+
+		for (; *field && (quoted || *field != delimiter); field++) {
+			if (quoted && *field == '"' && field[1] == '"') field++;
+			else if (quoted && *field == '"') {
+				quoted = 0;
+				continue;
+			}
+			if (name_len + 1 < sizeof(name)) name[name_len++] = *field;
+		}
+		name[name_len] = 0;
+
+
+		/* Known column? */
+		int known = 0;
+		for (size_t i=0; i < session->column_list.count && !known; i++) {
+			known = !strcmp(dbt_strings_get(&session->strings, session->column_list.names[i]), name);
+		}
+
+		if (known) json_array_append_new(columns, json_string(name));
+		else header = 0;
+
+		if (*field != delimiter) break;
+		field++;
+	}
+
+	free(line);
+
+
+	/* No header, data starts at top */
+	if (!header) {
+		json_array_clear(columns);
+		fseek(import->file, bom, SEEK_SET);
+	}
+
+
+	return header;
+}
+
+
+
+
+int dbt_import_command(const char *input, struct dbt_session *session) {
+	/* Check input ('path [csv|tsv]', 'cancel' rolls back a running import) */
+	if (!input || !session) return 1;
+	struct dbt_import *import = &session->import;
+
+	if (!strcmp(input, "cancel")) {
+		if (import->active) import_finish(session, "cancelled, rolled back");
+		return 0;
+	} else if (import->active || !session->current_table || !session->current_schema || !session->column_list.count) return 1;
+	else if (!session->adapter_handle.start_import || !session->adapter_handle.open_connection) return 1;
+
+
+	/* Parse arguments (format follows extension unless given) */
+	char args[512];
+	snprintf(args, sizeof(args), "%s", input);
+	char *save_ptr = 0;
+	const char *path = strtok_r(args, " ", &save_ptr);
+	const char *format = strtok_r(0, " ", &save_ptr);
+	if (!path) return 1;
+
+	const char *extension = strrchr(path, '.');
+	int csv = format ? strcmp(format, "tsv") != 0 : !(extension && (!strcmp(extension, ".tsv") || !strcmp(extension, ".tab")));
+
+
+	/* Reset previous import, properties pane shows progress */
+	dbt_import_stop(session);
+	dbt_dashboard_stop(session);
+
+	snprintf(import->schema, sizeof(import->schema), "%s", session->current_schema);
+	snprintf(import->table, sizeof(import->table), "%s", session->current_table);
+	import->path = strdup(path);
+	import->csv = csv;
+	import->wake_fds[0] = import->wake_fds[1] = -1;
+	pthread_mutex_init(&import->lock, 0);
+	pthread_cond_init(&import->cond, 0);
+	clock_gettime(CLOCK_MONOTONIC, &import->started);
+	import->active = 1;
+
+	import->file = fopen(path, "r");
+	if (!import->path || !import->file) {
+		import_finish(session, "cannot open %s", path);
+		return 1;
+	}
+
+	struct stat st;
+	if (!fstat(fileno(import->file), &st)) import->file_size = st.st_size;
+
+
+	/* Columns from header (checked against the table), otherwise every column in table order */
+	json_t *columns = json_array();
+	import->expected_fields = import_read_header(import, columns, session) ? json_array_size(columns) : session->column_list.count;
+
+
+	/* Enter COPY on a dedicated connection (import keeps an adapter copy, long loads ignore the statement timeout) */
+	import->adapter = session->adapter_handle;
+	import->adapter.conn_handle = 0;
+	import->adapter.db_conn_handle = 0;
+	import->adapter.row_limit = 0;
+	import->adapter.statement_timeout = 0;
+
+	char *message = 0;
+	import->conn_handle = import->adapter.open_connection(session->current_database ? session->current_database : "postgres", &import->adapter);
+	int failed = !import->conn_handle || import->adapter.start_import(import->schema, import->table, columns, csv, import->conn_handle, &message, &import->adapter);
+	json_decref(columns);
+	if (failed) {
+		import_finish(session, "%.*s", (int)strcspn(message ? message : "connection failed", "\n"), message ? message : "connection failed");
+		return 1;
+	}
+
+
+	/* Start reader thread */
+	if (pipe(import->wake_fds)) {
+		import_finish(session, "pipe failed");
+		return 1;
+	}
+	fcntl(import->wake_fds[0], F_SETFL, O_NONBLOCK);
+	fcntl(import->wake_fds[1], F_SETFL, O_NONBLOCK);
+
+	if (pthread_create(&import->reader, 0, import_reader, import)) {
+		import_finish(session, "thread failed");
+		return 1;
+	}
+	import->reader_started = 1;
+
+	import_render(session, 1);
+
+
+	return 0;
+}
+
+
+void dbt_import_stop(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+	struct dbt_import *import = &session->import;
+
+
+	/* Abort running import (rolled back), release wake pipe */
+	if (import->active) import_finish(session, "cancelled, rolled back");
+	if (import->path) {
+		pthread_mutex_destroy(&import->lock);
+		pthread_cond_destroy(&import->cond);
+	}
+	if (import->wake_fds[0] > 0) close(import->wake_fds[0]);
+	if (import->wake_fds[1] > 0) close(import->wake_fds[1]);
+	free(import->path);
+	memset(import, 0, sizeof(*import));
+}
+
+
+size_t dbt_import_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session) {
+	/* Check input */
+	if (!fds || max < 2 || !session) return 0;
+	struct dbt_import *import = &session->import;
+	if (!import->active) return 0;
+
+
+	/* Wake pipe of reader, socket while waiting for the server */
+	fds[0].fd = import->wake_fds[0];
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+	if (!import->events) return 1;
+
+	fds[1].fd = import->adapter.connection_fd(import->conn_handle, &import->adapter);
+	fds[1].events = import->events;
+	fds[1].revents = 0;
+
+
+	return 2;
+}
+
+
+int dbt_import_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 0;
+	struct dbt_import *import = &session->import;
+	if (!import->active) return 0;
+
+
+	/* Clear wake-ups */
+	char wake[64];
+	while (read(import->wake_fds[0], wake, sizeof(wake)) > 0);
+
+
+	/* Send chunks until socket is full or queue is empty */
+	char *message = 0;
+	import->events = 0;
+	while (!import->ending) {
+		if (!import->sending.data) {
+			pthread_mutex_lock(&import->lock);
+			if (import->queue_count) {
+				import->sending = import->queue[import->queue_head];
+				import->queue_head = (import->queue_head + 1) % DBT_IMPORT_QUEUE;
+				import->queue_count--;
+				pthread_cond_signal(&import->cond);
+			} else if (import->reader_done) import->ending = 1;
+			pthread_mutex_unlock(&import->lock);
+
+			if (!import->sending.data) break;
+		}
+
+		int status = import->adapter.write_import(import->sending.data, import->sending.length, import->conn_handle, &message, &import->adapter);
+		if (status < 0) {
+			import_finish(session, "%.*s", (int)strcspn(message ? message : "send failed", "\n"), message ? message : "send failed");
+			return 1;
+		} else if (!status) {
+			import->events = POLLOUT;
+			return import_render(session, 0);
+		}
+
+		import->rows += import->sending.rows;
+		import->bytes += import->sending.length;
+		free(import->sending.data);
+		import->sending.data = 0;
+	}
+	if (!import->ending) return import_render(session, 0);
+
+
+	/* End copy, invalid input aborts it (nothing is kept) */
+	const char *abort_reason = import->reader_error[0] ? import->reader_error : 0;
+	int status = import->adapter.finish_import(abort_reason, &import->ended, import->conn_handle, &message, &import->adapter);
+	if (status > 0) {
+		import->events = import->ended ? POLLIN : POLLOUT;
+		return import_render(session, 0);
+	}
+
+	char error[128];
+	snprintf(error, sizeof(error), "%.*s", (int)strcspn(message ? message : "failed", "\n"), message ? message : "failed");
+	if (abort_reason) import_finish(session, "%s, rolled back", abort_reason);
+	else if (status < 0) import_finish(session, "%s", error);
+	else import_finish(session, 0);
+
+
+	return 1;
+}
@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Helper functions */
+static size_t list_count(enum dbt_windows pane, const struct dbt_session *session) {
+	switch (pane) {
+		case DBT_WIN_SERVERS: return session->config.server_count;
+		case DBT_WIN_DATABASES: return session->database_list.count;
+		case DBT_WIN_SCHEMAS: return session->schema_list.count;
+		case DBT_WIN_TABLESVIEWS: return session->table_list.count;
+		case DBT_WIN_COLUMNS: return session->column_list.count;
+		default: return 0;
+	}
+}
+
+static const char *list_item(enum dbt_windows pane, size_t ind, char *row, size_t row_size, struct dbt_session *session) {
+	/* Name of entry (selection compares interned pointers), row text is optional */
+	const char *name = 0, *current = 0;
+	switch (pane) {
+		case DBT_WIN_SERVERS:
+			name = dbt_config_server_name(&session->config, ind);
+			current = session->current_server_name;
+			break;
+		case DBT_WIN_DATABASES:
+			name = dbt_strings_get(&session->strings, session->database_list.names[ind]);
+			current = session->current_database;
+			break;
+		case DBT_WIN_SCHEMAS:
+			name = dbt_strings_get(&session->strings, session->schema_list.names[ind]);
+			current = session->current_schema;
+			break;
+		case DBT_WIN_TABLESVIEWS:
+			name = dbt_strings_get(&session->strings, session->table_list.names[ind]);
+			current = session->current_table;
+			break;
+		case DBT_WIN_COLUMNS:
+			name = dbt_strings_get(&session->strings, session->column_list.names[ind]);
+			current = session->current_column;
+			break;
+		default:
+			return 0;
+	}
+	if (!row) return name;
+
+
+	/* Row text */
+	char marker = name == current ? '*' : ' ';
+	if (pane == DBT_WIN_SERVERS) {
+		snprintf(row, row_size, "[%c] %s - (%s)", marker, name, dbt_config_server_type(&session->config, ind));
+	} else if (pane == DBT_WIN_COLUMNS) {
+		struct dbt_column_table *columns = &session->column_list;
+		int len = snprintf(row, row_size, "[%c] %s - %s", marker, name, dbt_strings_get(&session->strings, columns->datatypes[ind]));
+
+		if (len >= 0 && (size_t)len < row_size && columns->max_lengths[ind] >= 0)
+			len += snprintf(row + len, row_size - len, "(%d)", columns->max_lengths[ind]);
+
+		if (len >= 0 && (size_t)len < row_size && !(columns->flags[ind] & DBT_COLUMN_NULLABLE))
+			len += snprintf(row + len, row_size - len, "/REQ");
+
+		if (len >= 0 && (size_t)len < row_size && columns->flags[ind] & DBT_COLUMN_IDENTITY)
+			snprintf(row + len, row_size - len, "/ID");
+	} else snprintf(row, row_size, "[%c] %s", marker, name);
+
+
+	return name;
+}
+
+static void list_clamp(struct dbt_list_view *view, size_t count, size_t visible) {
+	/* Keep cursor inside list and viewport around cursor */
+	if (view->cursor >= count) view->cursor = count ? count - 1 : 0;
+
+	if (view->cursor < view->offset) view->offset = view->cursor;
+	else if (visible && view->cursor >= view->offset + visible) view->offset = view->cursor - visible + 1;
+
+	if (view->offset + visible > count) view->offset = count > visible ? count - visible : 0;
+}
+
+
+
+
+int dbt_list_render(enum dbt_windows pane, struct dbt_session *session) {
+	/* Check input */
+	if (!session || pane > DBT_WIN_COLUMNS) return 1;
+	WINDOW *win = session->app_windows[pane];
+	struct dbt_list_view *view = &session->list_views[pane];
+
+	size_t count = list_count(pane, session);
+	size_t visible = getmaxy(win) > 2 ? getmaxy(win) - 2 : 0;
+	int width = getmaxx(win) - 4;
+	list_clamp(view, count, visible);
+
+
+	/* Redraw frame (title shows position once list outgrows pane) */
+	const char *titles[] = { "Servers", "Databases", "Schemas", "Tables/Views", "Columns" };
+	char title[128];
+	int title_len = snprintf(title, sizeof(title), "%s", titles[pane]);
+	if (pane == DBT_WIN_TABLESVIEWS && session->watch.feed) title_len += snprintf(title + title_len, sizeof(title) - title_len, " (%s)", session->watch.mode);
+	if (count > visible) snprintf(title + title_len, sizeof(title) - title_len, " %zu-%zu/%zu", view->offset + 1, view->offset + visible, count);
+
+	werase(win);
+	box(win, 0, 0);
+	if (session->list_focus == pane) wattron(win, A_BOLD);
+	mvwaddnstr(win, 0, 2, title, width);
+	wattroff(win, A_BOLD);
+
+
+	/* Print visible rows only, cursor highlighted in focused pane */
+	char row[512];
+	for (size_t i=0; i < visible && view->offset + i < count; i++) {
+		size_t ind = view->offset + i;
+		list_item(pane, ind, row, sizeof(row), session);
+
+		int highlight = session->list_focus == pane && ind == view->cursor;
+		if (highlight) wattron(win, A_REVERSE);
+		mvwaddnstr(win, i+1, 2, row, width);
+		if (highlight) wattroff(win, A_REVERSE);
+	}
+
+
+	/* Refresh window */
+	wrefresh(win);
+
+
+	return 0;
+}
+
+
+int dbt_list_reset(enum dbt_windows pane, struct dbt_session *session) {
+	/* Check input */
+	if (!session || pane > DBT_WIN_COLUMNS) return 1;
+
+
+	/* New contents start at top */
+	memset(&session->list_views[pane], 0, sizeof(struct dbt_list_view));
+
+
+	return dbt_list_render(pane, session);
+}
+
+
+int dbt_list_reveal(enum dbt_windows pane, size_t ind, struct dbt_session *session) {
+	/* Check input */
+	if (!session || pane > DBT_WIN_COLUMNS) return 1;
+
+
+	/* Move cursor onto entry, viewport follows */
+	session->list_views[pane].cursor = ind;
+
+
+	return dbt_list_render(pane, session);
+}
+
+
+int dbt_list_focus(enum dbt_windows pane, struct dbt_session *session) {
+	/* Check input */
+	if (!session || pane > DBT_WIN_COLUMNS) return 1;
+
+
+	/* Redraw old and new pane (title and cursor only show in focused pane) */
+	enum dbt_windows previous = session->list_focus;
+	session->list_focus = pane;
+	if (previous != pane) dbt_list_render(previous, session);
+
+
+	return dbt_list_render(pane, session);
+}
+
+
+int dbt_list_scroll(long rows, struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	enum dbt_windows pane = session->list_focus;
+	struct dbt_list_view *view = &session->list_views[pane];
+
+
+	/* Move cursor (clamped by render) */
+	if (rows < 0 && (size_t)-rows > view->cursor) view->cursor = 0;
+	else view->cursor += rows;
+
+
+	return dbt_list_render(pane, session);
+}
+
+
+int dbt_list_page(int direction, struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+
+
+	/* One pane height per page */
+	int visible = getmaxy(session->app_windows[session->list_focus]) - 2;
+
+
+	return dbt_list_scroll((long)direction * (visible > 1 ? visible : 1), session);
+}
+
+
+int dbt_list_activate(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	enum dbt_windows pane = session->list_focus;
+	struct dbt_list_view *view = &session->list_views[pane];
+	if (view->cursor >= list_count(pane, session)) return 1;
+
+
+	/* Select entry under cursor like a typed name */
+	const char *name = list_item(pane, view->cursor, 0, 0, session);
+	switch (pane) {
+		case DBT_WIN_SERVERS: return dbt_servers_select(name, session);
+		case DBT_WIN_DATABASES: return dbt_databases_select(name, session);
+		case DBT_WIN_SCHEMAS: return dbt_schemas_select(name, session);
+		case DBT_WIN_TABLESVIEWS: return dbt_tables_select(name, session);
+		case DBT_WIN_COLUMNS: return dbt_columns_select(name, session);
+		default: return 1;
+	}
+}
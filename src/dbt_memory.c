@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_MEMORY_RENDER_MS 1000
+
+
+/* Allocation header (two words, so payloads keep malloc alignment) */
+struct dbt_memory_header {
+	size_t size;
+	size_t subsystem;
+};
+
+
+/* Counters per subsystem (updated from worker threads too) */
+static struct {
+	size_t bytes;
+	size_t peak;
+	size_t live;
+	size_t total;
+} memory_counters[DBT_MEMORY_SUBSYSTEMS];
+static _Thread_local enum dbt_memory_subsystem memory_current = DBT_MEMORY_OTHER;
+
+static const char *memory_names[DBT_MEMORY_SUBSYSTEMS] = { "Other", "Config", "Results", "Properties", "Dashboard", "Plans" };
+
+
+/* Helper functions */
+static void *memory_alloc(size_t size) {
+	/* Tag with subsystem of the calling thread */
+	struct dbt_memory_header *header = (struct dbt_memory_header *)malloc(sizeof(struct dbt_memory_header) + size);
+	if (!header) return 0;
+
+	header->size = size;
+	header->subsystem = memory_current;
+
+
+	/* Count (peak is best effort under concurrent updates) */
+	size_t bytes = __atomic_add_fetch(&memory_counters[header->subsystem].bytes, size, __ATOMIC_RELAXED);
+	if (bytes > __atomic_load_n(&memory_counters[header->subsystem].peak, __ATOMIC_RELAXED)) __atomic_store_n(&memory_counters[header->subsystem].peak, bytes, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&memory_counters[header->subsystem].live, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&memory_counters[header->subsystem].total, 1, __ATOMIC_RELAXED);
+
+
+	return header + 1;
+}
+
+static void memory_release(void *ptr) {
+	/* Check input */
+	if (!ptr) return;
+
+
+	/* Uncount from the subsystem that allocated it */
+	struct dbt_memory_header *header = (struct dbt_memory_header *)ptr - 1;
+	__atomic_sub_fetch(&memory_counters[header->subsystem].bytes, header->size, __ATOMIC_RELAXED);
+	__atomic_sub_fetch(&memory_counters[header->subsystem].live, 1, __ATOMIC_RELAXED);
+
+	free(header);
+}
+
+static void memory_format(char *out, size_t out_size, double bytes) {
+	const char *units[] = { "B", "kB", "MB", "GB" };
+	size_t unit = 0;
+	while (bytes >= 1024 && unit < 3) {
+		bytes /= 1024;
+		unit++;
+	}
+
+	snprintf(out, out_size, unit ? "%.1f %s" : "%.0f %s", bytes, units[unit]);
+}
+
+static size_t memory_resultset_bytes(const struct dbt_resultset *resultset) {
+	/* Arena, column arrays, null bitmaps and view (group results also keep their source) */
+	size_t bytes = 0;
+	for (; resultset; resultset = resultset->source) {
+		bytes += resultset->arena_size + resultset->row_count * sizeof(uint32_t);
+		bytes += resultset->column_count * resultset->row_count * (sizeof(const char *) + sizeof(uint32_t) + sizeof(double));
+		bytes += resultset->column_count * (resultset->row_count / 8 + 1);
+	}
+
+	return bytes;
+}
+
+static void memory_render(struct dbt_session *session) {
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+	clock_gettime(CLOCK_MONOTONIC, &session->memory.last_render);
+	int max_y = getmaxy(win) - 1;
+
+
+	/* Clear previous content */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Memory");
+
+
+	/* Json values by subsystem */
+	char value[32], other[32];
+	int y = 1;
+	mvwprintw(win, y++, 2, "%-11s %9s %9s %8s", "Json", "live", "peak", "values");
+	for (size_t i=0; i < DBT_MEMORY_SUBSYSTEMS && y < max_y; i++) {
+		memory_format(value, sizeof(value), __atomic_load_n(&memory_counters[i].bytes, __ATOMIC_RELAXED));
+		memory_format(other, sizeof(other), __atomic_load_n(&memory_counters[i].peak, __ATOMIC_RELAXED));
+		mvwprintw(win, y++, 2, "%-11s %9s %9s %8zu", memory_names[i], value, other, __atomic_load_n(&memory_counters[i].live, __ATOMIC_RELAXED));
+	}
+
+
+	/* Materialized results (one arena per tab) and interned catalog names */
+	size_t resultset_bytes = 0, resultset_count = 0;
+	for (size_t i=0; i < DBT_TAB_MAX; i++) {
+		if (!session->tabs[i].resultset) continue;
+		resultset_bytes += memory_resultset_bytes(session->tabs[i].resultset);
+		resultset_count++;
+	}
+
+	y++;
+	memory_format(value, sizeof(value), resultset_bytes);
+	if (y < max_y) mvwprintw(win, y++, 2, "%-11s %9s %zu tabs", "Result sets", value, resultset_count);
+	size_t string_bytes = 0;
+	for (size_t i=0; i < session->strings.count; i++) string_bytes += session->strings.lengths[i] + 1;
+	memory_format(value, sizeof(value), string_bytes);
+	if (y < max_y) mvwprintw(win, y++, 2, "%-11s %9s %zu names", "Strings", value, session->strings.count);
+
+
+	/* Allocation churn (values created since start) */
+	size_t total = 0;
+	for (size_t i=0; i < DBT_MEMORY_SUBSYSTEMS; i++) total += __atomic_load_n(&memory_counters[i].total, __ATOMIC_RELAXED);
+	if (y + 1 < max_y) mvwprintw(win, ++y, 2, "%zu json values allocated since start", total);
+
+
+	/* Refresh window */
+	wrefresh(win);
+}
+
+
+
+
+void dbt_memory_init(void) {
+	/* Route every json value through the counters (before the first one is created, also covers adapter plugins) */
+	json_set_alloc_funcs(memory_alloc, memory_release);
+}
+
+
+enum dbt_memory_subsystem dbt_memory_scope(enum dbt_memory_subsystem subsystem) {
+	/* Json created on this thread is counted for subsystem until restored (returns previous scope) */
+	enum dbt_memory_subsystem previous = memory_current;
+	if (subsystem < DBT_MEMORY_SUBSYSTEMS) memory_current = subsystem;
+
+	return previous;
+}
+
+
+int dbt_memory_toggle(struct dbt_session *session) {
+	/* Check input (dashboard owns the pane while active) */
+	if (!session || session->dashboard.active) return 1;
+
+
+	/* Second press closes the view, the pane goes back to the selected table (or is cleared) */
+	session->memory.active = !session->memory.active;
+	if (session->memory.active) memory_render(session);
+	else if (dbt_properties_refresh(session)) {
+		WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+		wclear(win);
+		box(win, 0, 0);
+		mvwprintw(win, 0, 2, "Properties");
+		wrefresh(win);
+	}
+
+
+	return 0;
+}
+
+
+int dbt_memory_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session || !session->memory.active) return 0;
+
+
+	/* Redraw counters while open (pane belongs to the dashboard and running jobs meanwhile) */
+	if (session->dashboard.active || session->profile.active || session->export.active || session->import.active) return 0;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	uint64_t elapsed_ms = (now.tv_sec - session->memory.last_render.tv_sec) * 1000ull + (now.tv_nsec - session->memory.last_render.tv_nsec) / 1000000;
+	if (elapsed_ms < DBT_MEMORY_RENDER_MS) return 0;
+
+	memory_render(session);
+
+
+	return 1;
+}
@@ -0,0 +1,435 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "dbt.h"
+
+
+/* Helper functions */
+static double node_number(json_t *node, const char *key) {
+	json_t *value = json_object_get(node, key);
+	return json_is_number(value) ? json_number_value(value) : 0;
+}
+
+static double node_total_ms(json_t *node) {
+	/* Actual Total Time is per loop */
+	return node_number(node, "Actual Total Time") * node_number(node, "Actual Loops");
+}
+
+static char *node_label(json_t *node) {
+	/* 'Node Type [using index] [on relation]' */
+	const char *node_type = json_string_value(json_object_get(node, "Node Type"));
+	const char *index = json_string_value(json_object_get(node, "Index Name"));
+	const char *relation = json_string_value(json_object_get(node, "Relation Name"));
+
+	char label[256];
+	int len = snprintf(label, sizeof(label), "%s", node_type ? node_type : "?");
+	if (index && len < (int)sizeof(label)) len += snprintf(label + len, sizeof(label) - len, " using %s", index);
+	if (relation && len < (int)sizeof(label)) snprintf(label + len, sizeof(label) - len, " on %s", relation);
+
+
+	return strdup(label);
+}
+
+static int plan_word_in(const char *word, size_t word_len, const char **words, size_t count) {
+	for (size_t i=0; i < count; i++) {
+		if (word_len == strlen(words[i]) && !strncasecmp(word, words[i], word_len)) return 1;
+	}
+
+	return 0;
+}
+
+static int plan_append_node(struct dbt_plan *plan, size_t *cap, json_t *node, int depth) {
+	/* Grow node list */
+	if (plan->node_count >= *cap) {
+		size_t new_cap = *cap ? *cap * 2 : 32;
+		struct dbt_plan_node *nodes = (struct dbt_plan_node *)realloc(plan->nodes, new_cap * sizeof(struct dbt_plan_node));
+		if (!nodes) return 1;
+
+		plan->nodes = nodes;
+		*cap = new_cap;
+	}
+
+
+	/* Inclusive totals (EXPLAIN reports timing and buffers including children) */
+	size_t ind = plan->node_count++;
+	struct dbt_plan_node *plan_node = &plan->nodes[ind];
+	memset(plan_node, 0, sizeof(*plan_node));
+	plan_node->label = node_label(node);
+	plan_node->depth = depth;
+	plan_node->loops = node_number(node, "Actual Loops");
+	plan_node->total_ms = node_total_ms(node);
+	plan_node->actual_rows = node_number(node, "Actual Rows") * plan_node->loops;
+	plan_node->plan_rows = node_number(node, "Plan Rows") * (plan_node->loops > 1 ? plan_node->loops : 1);
+	plan_node->shared_hit = (int64_t)node_number(node, "Shared Hit Blocks");
+	plan_node->shared_read = (int64_t)node_number(node, "Shared Read Blocks");
+
+
+	/* Self values subtract direct children (clamped, parallel workers can overlap) */
+	double self_ms = plan_node->total_ms;
+	int64_t self_hit = plan_node->shared_hit, self_read = plan_node->shared_read;
+
+	json_t *children = json_object_get(node, "Plans");
+	size_t child_ind;
+	json_t *child;
+	json_array_foreach(children, child_ind, child) {
+		self_ms -= node_total_ms(child);
+		self_hit -= (int64_t)node_number(child, "Shared Hit Blocks");
+		self_read -= (int64_t)node_number(child, "Shared Read Blocks");
+	}
+
+	plan->nodes[ind].self_ms = self_ms > 0 ? self_ms : 0;
+	plan->nodes[ind].self_hit = self_hit > 0 ? self_hit : 0;
+	plan->nodes[ind].self_read = self_read > 0 ? self_read : 0;
+
+
+	/* Children in preorder (node pointer may move while growing) */
+	json_array_foreach(children, child_ind, child) {
+		if (plan_append_node(plan, cap, child, depth + 1)) return 1;
+	}
+
+
+	return 0;
+}
+
+static void plan_find_hot(struct dbt_plan *plan) {
+	/* Pick nodes with most self time (small fixed count, selection is enough) */
+	plan->hot_count = 0;
+	for (size_t k=0; k < DBT_PLAN_HOT; k++) {
+		size_t best = plan->node_count;
+		for (size_t i=0; i < plan->node_count; i++) {
+			int taken = 0;
+			for (size_t j=0; j < plan->hot_count; j++) taken |= plan->hot[j] == i;
+			if (taken || plan->nodes[i].self_ms <= 0) continue;
+			if (best == plan->node_count || plan->nodes[i].self_ms > plan->nodes[best].self_ms) best = i;
+		}
+
+		if (best == plan->node_count) break;
+		plan->hot[plan->hot_count++] = best;
+	}
+}
+
+static int plan_same_shape(const struct dbt_plan *plan, const struct dbt_plan *other) {
+	if (plan->node_count != other->node_count) return 0;
+
+	for (size_t i=0; i < plan->node_count; i++) {
+		if (plan->nodes[i].depth != other->nodes[i].depth || strcmp(plan->nodes[i].label, other->nodes[i].label)) return 0;
+	}
+
+	return 1;
+}
+
+static void format_estimate_error(char *out, size_t out_size, const struct dbt_plan *plan, const struct dbt_plan_node *node) {
+	/* Ratio between actual and estimated rows (never executed nodes and estimate only plans have no actuals) */
+	if (plan->estimated) {
+		snprintf(out, out_size, "-");
+		return;
+	} else if (node->loops <= 0) {
+		snprintf(out, out_size, "never run");
+		return;
+	}
+
+	double actual = node->actual_rows > 1 ? node->actual_rows : 1;
+	double estimate = node->plan_rows > 1 ? node->plan_rows : 1;
+	if (actual >= estimate) snprintf(out, out_size, "x%.1f under", actual / estimate);
+	else snprintf(out, out_size, "x%.1f over", estimate / actual);
+}
+
+static void plan_refresh_properties(struct dbt_plan *plan, struct dbt_session *session) {
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+	int width = getmaxx(win) - 4;
+	int max_y = getmaxy(win) - 1;
+	char line[256];
+
+
+	/* Clear previous properties */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Plan");
+
+
+	/* Summary (estimate only plans come from statements that were not executed) */
+	int y = 1;
+	if (plan->estimated) {
+		mvwprintw(win, y++, 2, "Estimate only: statement writes, not run");
+		wrefresh(win);
+		return;
+	}
+	mvwprintw(win, y++, 2, "Planning  %10.2f ms", plan->planning_ms);
+	mvwprintw(win, y++, 2, "Execution %10.2f ms", plan->execution_ms);
+	mvwprintw(win, y++, 2, "Nodes     %10zu", plan->node_count);
+
+
+	/* Hottest nodes by self time */
+	y++;
+	mvwprintw(win, y++, 2, "Hottest (self time)");
+	for (size_t i=0; i < plan->hot_count && y < max_y; i++) {
+		struct dbt_plan_node *node = &plan->nodes[plan->hot[i]];
+		double share = plan->execution_ms > 0 ? node->self_ms * 100 / plan->execution_ms : 0;
+		snprintf(line, sizeof(line), "%zu %9.2f ms %3.0f%% %s", i+1, node->self_ms, share, node->label);
+		mvwaddnstr(win, y++, 2, line, width);
+	}
+
+
+	/* Compare with previous plan of the same query */
+	struct dbt_plan *previous = plan->previous;
+	if (!previous || y + 2 >= max_y) {
+		wrefresh(win);
+		return;
+	}
+
+	y++;
+	double change = previous->execution_ms > 0 ? (plan->execution_ms - previous->execution_ms) * 100 / previous->execution_ms : 0;
+	mvwprintw(win, y++, 2, "Previous run");
+	snprintf(line, sizeof(line), "Execution %.2f -> %.2f ms (%+.1f%%)", previous->execution_ms, plan->execution_ms, change);
+	mvwaddnstr(win, y++, 2, line, width);
+
+	if (!plan_same_shape(plan, previous)) {
+		if (y < max_y) mvwprintw(win, y++, 2, "Plan shape changed");
+		wrefresh(win);
+		return;
+	}
+
+
+	/* Same shape: nodes whose self time moved the most */
+	size_t shown[DBT_PLAN_HOT];
+	size_t shown_count = 0;
+	for (size_t k=0; k < DBT_PLAN_HOT && y < max_y; k++) {
+		size_t best = plan->node_count;
+		double best_delta = 0;
+		for (size_t i=0; i < plan->node_count; i++) {
+			int taken = 0;
+			for (size_t j=0; j < shown_count; j++) taken |= shown[j] == i;
+			double delta = plan->nodes[i].self_ms - previous->nodes[i].self_ms;
+			if (!taken && (delta < 0 ? -delta : delta) > (best_delta < 0 ? -best_delta : best_delta)) {
+				best = i;
+				best_delta = delta;
+			}
+		}
+
+		if (best == plan->node_count) break;
+		shown[shown_count++] = best;
+		snprintf(line, sizeof(line), "%+9.2f ms %s", best_delta, plan->nodes[best].label);
+		mvwaddnstr(win, y++, 2, line, width);
+	}
+
+
+	/* Refresh window */
+	wrefresh(win);
+}
+
+
+
+
+int dbt_plan_analyzable(const char *query) {
+	/* Check input */
+	if (!query) return 0;
+
+
+	/* ANALYZE executes the statement: only plain reads qualify (SELECT INTO creates a table, FOR UPDATE locks rows) */
+	static const char *reads[] = { "select", "with", "values", "table" };
+	static const char *writes[] = { "insert", "update", "delete", "merge", "into", "truncate" };
+	int words = 0;
+	const char *c = query;
+	while (*c) {
+		/* Skip literals, quoted identifiers and comments */
+		if (*c == '\'' || *c == '"') {
+			const char *end = strchr(c + 1, *c);
+			c = end ? end + 1 : c + strlen(c);
+			continue;
+		} else if (c[0] == '-' && c[1] == '-') {
+			const char *end = strchr(c, '\n');
+			c = end ? end : c + strlen(c);
+			continue;
+		} else if (c[0] == '/' && c[1] == '*') {
+			const char *end = strstr(c + 2, "*/");
+			c = end ? end + 2 : c + strlen(c);
+			continue;
+		} else if (!isalpha((unsigned char)*c) && *c != '_') {
+			c++;
+			continue;
+		}
+
+		size_t len = 0;
+		while (isalnum((unsigned char)c[len]) || c[len] == '_' || c[len] == '$') len++;
+		if (!words++ && !plan_word_in(c, len, reads, sizeof(reads) / sizeof(reads[0]))) return 0;
+		else if (plan_word_in(c, len, writes, sizeof(writes) / sizeof(writes[0]))) return 0;
+		c += len;
+	}
+
+
+	return words > 0;
+}
+
+
+struct dbt_plan *dbt_plan_from_json(const char *query, json_t *result) {
+	/* Check input */
+	if (!query || !result) return 0;
+
+
+	/* EXPLAIN (FORMAT JSON) returns one row holding the plan document */
+	const char *text = json_string_value(json_array_get(json_array_get(json_object_get(result, "rows"), 0), 0));
+	if (!text) return 0;
+
+	enum dbt_memory_subsystem scope = dbt_memory_scope(DBT_MEMORY_PLANS);
+	json_t *document = json_loads(text, 0, 0);
+	dbt_memory_scope(scope);
+	json_t *root = json_array_get(document, 0);
+	json_t *root_node = json_object_get(root, "Plan");
+	if (!json_is_object(root_node)) {
+		json_decref(document);
+		return 0;
+	}
+
+
+	/* Flatten tree */
+	struct dbt_plan *plan = (struct dbt_plan *)calloc(1, sizeof(struct dbt_plan));
+	if (!plan) {
+		json_decref(document);
+		return 0;
+	}
+
+	plan->query = strdup(query);
+	plan->planning_ms = node_number(root, "Planning Time");
+	plan->execution_ms = node_number(root, "Execution Time");
+	plan->estimated = !json_object_get(root, "Execution Time");
+
+	size_t cap = 0;
+	int failed = !plan->query || plan_append_node(plan, &cap, root_node, 0);
+	json_decref(document);
+	if (failed) {
+		dbt_plan_free(plan);
+		return 0;
+	}
+
+	plan_find_hot(plan);
+
+
+	return plan;
+}
+
+
+void dbt_plan_free(struct dbt_plan *plan) {
+	/* Check input */
+	if (!plan) return;
+
+	for (size_t i=0; i < plan->node_count; i++) free(plan->nodes[i].label);
+	free(plan->nodes);
+	free(plan->query);
+	free(plan);
+}
+
+
+int dbt_plan_keep(struct dbt_plan *plan, struct dbt_session *session) {
+	/* Check input */
+	if (!plan || !session) return 1;
+
+
+	/* Drop oldest plan when full (clearing every reference to it) */
+	if (session->plan_count >= DBT_PLAN_KEEP) {
+		struct dbt_plan *oldest = session->plans[0];
+		for (size_t i=1; i < session->plan_count; i++) {
+			if (session->plans[i]->previous == oldest) session->plans[i]->previous = 0;
+		}
+		for (size_t i=0; i < DBT_TAB_MAX; i++) {
+			if (session->tabs[i].plan == oldest) session->tabs[i].plan = 0;
+		}
+
+		dbt_plan_free(oldest);
+		memmove(session->plans, session->plans + 1, (session->plan_count - 1) * sizeof(struct dbt_plan *));
+		session->plan_count--;
+	}
+
+
+	/* Link to latest plan of the same query for diffing */
+	plan->previous = 0;
+	for (size_t i=session->plan_count; i > 0; i--) {
+		if (!strcmp(session->plans[i-1]->query, plan->query) && session->plans[i-1]->estimated == plan->estimated) {
+			plan->previous = session->plans[i-1];
+			break;
+		}
+	}
+
+	session->plans[session->plan_count++] = plan;
+
+
+	return 0;
+}
+
+
+int dbt_plan_refresh(struct dbt_plan *plan, struct dbt_session *session) {
+	/* Check input */
+	if (!plan || !session) return 1;
+	WINDOW *win = session->app_windows[DBT_WIN_RESULT];
+	int max_x = getmaxx(win), max_y = getmaxy(win);
+	int width = max_x - 4;
+	size_t visible = max_y > 5 ? max_y - 5 : 0;
+	char line[512];
+
+
+	/* Clear previous result */
+	wclear(win);
+	box(win, 0, 0);
+	if (plan->estimated) mvwprintw(win, 0, 2, "Plan (%d/%d) - estimate only, not executed", session->tab_ind + 1, DBT_TAB_MAX);
+	else mvwprintw(win, 0, 2, "Plan (%d/%d) - %.2fms execution", session->tab_ind + 1, DBT_TAB_MAX, plan->execution_ms);
+
+
+	/* Print header */
+	snprintf(line, sizeof(line), "%10s %6s %10s %10s %10s %12s %8s %8s  %s", "self ms", "self%", "total ms", "rows", "estimate", "error", "hit", "read", "node");
+	mvwaddnstr(win, 2, 2, line, width);
+	mvwhline(win, 3, 1, ACS_HLINE, max_x-2);
+
+
+	/* Print visible nodes (hottest highlighted) */
+	for (size_t i=0; i < visible && plan->view_offset + i < plan->node_count; i++) {
+		size_t ind = plan->view_offset + i;
+		struct dbt_plan_node *node = &plan->nodes[ind];
+
+		char error[32];
+		format_estimate_error(error, sizeof(error), plan, node);
+		double share = plan->execution_ms > 0 ? node->self_ms * 100 / plan->execution_ms : 0;
+		snprintf(line, sizeof(line), "%10.2f %5.1f%% %10.2f %10.0f %10.0f %12s %8lld %8lld  %*s%s",
+			node->self_ms, share, node->total_ms, node->actual_rows, node->plan_rows, error,
+			(long long)node->self_hit, (long long)node->self_read, node->depth * 2, "", node->label);
+
+		attr_t attrs = 0;
+		for (size_t j=0; j < plan->hot_count; j++) {
+			if (plan->hot[j] == ind) attrs = j ? A_BOLD : A_REVERSE;
+		}
+
+		wattron(win, attrs);
+		mvwaddnstr(win, 4+i, 2, line, width);
+		wattroff(win, attrs);
+	}
+
+
+	/* Print position on bottom border */
+	if (plan->node_count) {
+		size_t last = plan->view_offset + visible < plan->node_count ? plan->view_offset + visible : plan->node_count;
+		mvwprintw(win, max_y-1, 2, "%zu-%zu/%zu", plan->view_offset+1, last, plan->node_count);
+	}
+
+	wrefresh(win);
+
+
+	/* Summary and diff go to properties */
+	plan_refresh_properties(plan, session);
+
+
+	return 0;
+}
+
+
+void dbt_plan_close(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+
+
+	/* Release kept plans */
+	for (size_t i=0; i < session->plan_count; i++) dbt_plan_free(session->plans[i]);
+	session->plan_count = 0;
+
+	for (size_t i=0; i < DBT_TAB_MAX; i++) session->tabs[i].plan = 0;
+}
@@ -0,0 +1,454 @@
+#include <float.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_PROFILE_RENDER_MS 250
+#define DBT_PROFILE_SHOWN_TOP 3
+#define DBT_PROFILE_WIDEN_MAX (DBL_MAX_EXP - DBL_MIN_EXP + 8)
+
+
+/* Helper functions */
+static uint64_t profile_elapsed_us(const struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) * 1000000ull + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static inline uint64_t profile_mix(uint64_t hash) {
+	/* Spread bits (murmur3 finalizer), registers and sketch rows read different parts */
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+static uint64_t profile_hash(const char *value, size_t length) {
+	/* FNV-1a (64 bit), then mixed */
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i=0; i < length; i++) {
+		hash ^= (unsigned char)value[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return profile_mix(hash);
+}
+
+static int profile_keep_text(char **text, size_t *text_length, const char *value, size_t length) {
+	/* Copy value over previous extreme */
+	char *copy = (char *)realloc(*text, length + 1);
+	if (!copy) return 1;
+
+	memcpy(copy, value, length);
+	copy[length] = 0;
+	*text = copy;
+	*text_length = length;
+
+
+	return 0;
+}
+
+static int profile_text_cmp(const char *a, size_t a_length, const char *b, size_t b_length) {
+	int cmp = memcmp(a, b, a_length < b_length ? a_length : b_length);
+	return cmp ? cmp : (a_length > b_length) - (a_length < b_length);
+}
+
+static size_t profile_histogram_bin(const struct dbt_profile_column *column, double number) {
+	/* Out of range (or not a number once widths overflow) lands in the outer bins */
+	double position = (number - column->bin_low) / column->bin_width;
+	if (!(position > 0)) return 0;
+	else if (position >= DBT_PROFILE_BINS) return DBT_PROFILE_BINS - 1;
+
+	return (size_t)position;
+}
+
+static void profile_histogram_add(struct dbt_profile_column *column, double number) {
+	/* First value anchors the range, second one sets a width that leaves room on both sides (values a denormal apart would underflow it to 0) */
+	if (column->bin_width == 0) {
+		if (number == column->bin_low) {
+			column->bins[0]++;
+			return;
+		}
+
+		double anchor = column->bin_low;
+		column->bin_low = number < anchor ? number : anchor;
+		column->bin_width = fmax(fabs(number - anchor) * 2 / DBT_PROFILE_BINS, DBL_MIN);
+
+		uint64_t anchored = column->bins[0];
+		column->bins[0] = 0;
+		column->bins[profile_histogram_bin(column, anchor)] += anchored;
+	}
+
+
+	/* Double bin width (merging neighbours) towards the side the value is on until it fits (bounded, DBL_MIN to DBL_MAX takes fewer doublings) */
+	for (size_t widened=0; widened < DBT_PROFILE_WIDEN_MAX && (number < column->bin_low || number >= column->bin_low + column->bin_width * DBT_PROFILE_BINS); widened++) {
+		uint64_t merged[DBT_PROFILE_BINS] = {0};
+		int left = number < column->bin_low;
+		for (size_t i=0; i < DBT_PROFILE_BINS; i++) merged[left ? (DBT_PROFILE_BINS + i) / 2 : i / 2] += column->bins[i];
+
+		if (left) column->bin_low -= column->bin_width * DBT_PROFILE_BINS;
+		column->bin_width *= 2;
+		memcpy(column->bins, merged, sizeof(merged));
+	}
+
+	column->bins[profile_histogram_bin(column, number)]++;
+}
+
+static void profile_add(struct dbt_profile_column *column, const char *value, size_t length, int first) {
+	/* Text range (kept for every column, numbers may turn out to be text later) */
+	if (first || profile_text_cmp(value, length, column->min_text, column->min_length) < 0) profile_keep_text(&column->min_text, &column->min_length, value, length);
+	if (first || profile_text_cmp(value, length, column->max_text, column->max_length) > 0) profile_keep_text(&column->max_text, &column->max_length, value, length);
+
+
+	/* Numeric range and histogram */
+	if (column->numeric) {
+		char *end;
+		double number = length ? strtod(value, &end) : 0;
+		if (!length || end != value + length || !isfinite(number)) column->numeric = 0;
+		else if (first) {
+			column->min_number = column->max_number = column->bin_low = number;
+			column->bins[0] = 1;
+		} else {
+			if (number < column->min_number) column->min_number = number;
+			if (number > column->max_number) column->max_number = number;
+			profile_histogram_add(column, number);
+		}
+	}
+
+
+	/* Distinct estimate: register by leading bits, rank by leading zeros of the rest */
+	uint64_t hash = profile_hash(value, length);
+	size_t reg = hash >> (64 - DBT_PROFILE_HLL_BITS);
+	uint64_t rest = (hash << DBT_PROFILE_HLL_BITS) | (1ull << (DBT_PROFILE_HLL_BITS - 1));
+	uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+	if (rank > column->registers[reg]) column->registers[reg] = rank;
+
+
+	/* Frequency estimate (minimum over sketch rows, double hashing) */
+	uint64_t sketch_hash = profile_mix(hash ^ 0x9e3779b97f4a7c15ull);
+	uint32_t h1 = (uint32_t)sketch_hash, h2 = (uint32_t)(sketch_hash >> 32) | 1;
+	uint32_t estimate = UINT32_MAX;
+	for (size_t d=0; d < DBT_PROFILE_SKETCH_DEPTH; d++) {
+		uint32_t *cell = &column->sketch[d][(h1 + d * h2) & (DBT_PROFILE_SKETCH_WIDTH - 1)];
+		if (*cell < UINT32_MAX) (*cell)++;
+		if (*cell < estimate) estimate = *cell;
+	}
+
+
+	/* Frequent candidates: update known value, otherwise take a free slot or beat the lowest */
+	size_t lowest = 0;
+	for (size_t i=0; i < column->top_count; i++) {
+		if (strlen(column->top_values[i]) == length && !memcmp(column->top_values[i], value, length)) {
+			column->top_counts[i] = estimate;
+			return;
+		}
+		if (column->top_counts[i] < column->top_counts[lowest]) lowest = i;
+	}
+
+	if (column->top_count < DBT_PROFILE_TOP) lowest = column->top_count++;
+	else if (estimate <= column->top_counts[lowest]) return;
+
+	char *copy = strndup(value, length);
+	if (!copy) return;
+	free(column->top_values[lowest]);
+	column->top_values[lowest] = copy;
+	column->top_counts[lowest] = estimate;
+}
+
+static double profile_distinct(const struct dbt_profile_column *column) {
+	/* HyperLogLog estimate, linear counting while registers are sparse */
+	double m = 1 << DBT_PROFILE_HLL_BITS, sum = 0;
+	size_t zeros = 0;
+	for (size_t i=0; i < (1 << DBT_PROFILE_HLL_BITS); i++) {
+		sum += ldexp(1.0, -column->registers[i]);
+		zeros += !column->registers[i];
+	}
+
+	double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+	return estimate <= 2.5 * m && zeros ? m * log(m / zeros) : estimate;
+}
+
+static void profile_feed(struct dbt_profile *profile, json_t *result) {
+	/* Columns of the first batch (later statements with other columns are not mixed in) */
+	json_t *column_list = json_object_get(result, "columns");
+	if (!profile->columns && json_array_size(column_list)) {
+		profile->columns = (struct dbt_profile_column *)calloc(json_array_size(column_list), sizeof(struct dbt_profile_column));
+		if (!profile->columns) return;
+
+		profile->column_count = json_array_size(column_list);
+		for (size_t j=0; j < profile->column_count; j++) {
+			profile->columns[j].name = strdup(json_string_value(json_array_get(column_list, j)) ? json_string_value(json_array_get(column_list, j)) : "");
+			profile->columns[j].numeric = 1;
+		}
+	}
+	if (json_array_size(column_list) != profile->column_count) return;
+
+
+	/* One pass per row, nulls only counted */
+	size_t row_ind;
+	json_t *row;
+	json_array_foreach(json_object_get(result, "rows"), row_ind, row) {
+		for (size_t j=0; j < profile->column_count; j++) {
+			struct dbt_profile_column *column = &profile->columns[j];
+			json_t *cell = json_array_get(row, j);
+			if (!json_is_string(cell)) {
+				column->nulls++;
+				continue;
+			}
+
+			profile_add(column, json_string_value(cell), json_string_length(cell), profile->rows == column->nulls);
+		}
+		profile->rows++;
+	}
+}
+
+static void profile_format_number(char *out, size_t out_size, double number) {
+	/* Integers in full, everything else short */
+	if (number == floor(number) && fabs(number) < 1e15) snprintf(out, out_size, "%.0f", number);
+	else snprintf(out, out_size, "%.6g", number);
+}
+
+static int profile_render(struct dbt_session *session, int force) {
+	struct dbt_profile *profile = &session->profile;
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+
+
+	/* Throttled while rows stream in, properties pane belongs to the dashboard while it runs */
+	if (session->dashboard.active) return 0;
+	else if (!force && profile_elapsed_us(&profile->last_render) < DBT_PROFILE_RENDER_MS * 1000ull) return 0;
+	clock_gettime(CLOCK_MONOTONIC, &profile->last_render);
+
+
+	/* Clear previous content */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Profile %s", profile->active ? "(running)" : profile->message[0] ? "(stopped)" : "(done)");
+
+
+	/* Print row count and throughput */
+	int width = getmaxx(win) - 4;
+	int max_y = getmaxy(win) - 1 - (profile->message[0] != 0);
+	double seconds = (profile->active ? profile_elapsed_us(&profile->started) : profile->duration_us) / 1e6;
+	char line[512], low[64], high[64];
+	int y = 1;
+	mvwprintw(win, y++, 2, "Rows %llu (%.0f/s) %.1fs", (unsigned long long)profile->rows, seconds > 0 ? profile->rows / seconds : 0, seconds);
+
+
+	/* Print columns as long as they fit */
+	size_t shown = 0;
+	for (; shown < profile->column_count && y + 4 < max_y; shown++) {
+		struct dbt_profile_column *column = &profile->columns[shown];
+		uint64_t values = profile->rows - column->nulls;
+		mvwaddnstr(win, y++, 2, column->name, width);
+
+		snprintf(line, sizeof(line), "  null %.1f%%  distinct ~%.0f", profile->rows ? 100.0 * column->nulls / profile->rows : 0, values ? profile_distinct(column) : 0);
+		mvwaddnstr(win, y++, 2, line, width);
+
+
+		/* Range (numbers as numbers) */
+		if (!values) snprintf(line, sizeof(line), "  range -");
+		else if (column->numeric) {
+			profile_format_number(low, sizeof(low), column->min_number);
+			profile_format_number(high, sizeof(high), column->max_number);
+			snprintf(line, sizeof(line), "  range %s .. %s", low, high);
+		} else snprintf(line, sizeof(line), "  range %.*s .. %.*s", (int)strcspn(column->min_text, "\n"), column->min_text, (int)strcspn(column->max_text, "\n"), column->max_text);
+		mvwaddnstr(win, y++, 2, line, width);
+
+
+		/* Most frequent values (estimates), highest first */
+		int line_len = snprintf(line, sizeof(line), "  top");
+		uint8_t used[DBT_PROFILE_TOP] = {0};
+		for (size_t k=0; k < DBT_PROFILE_SHOWN_TOP && k < column->top_count; k++) {
+			size_t best = DBT_PROFILE_TOP;
+			for (size_t i=0; i < column->top_count; i++) {
+				if (!used[i] && (best == DBT_PROFILE_TOP || column->top_counts[i] > column->top_counts[best])) best = i;
+			}
+			used[best] = 1;
+			line_len += snprintf(line + line_len, sizeof(line) - line_len, " %.*s~%u", 20, column->top_values[best], column->top_counts[best]);
+			if (line_len >= (int)sizeof(line)) break;
+		}
+		mvwaddnstr(win, y++, 2, line, width);
+
+
+		/* Histogram as a bar ramp relative to the fullest bin */
+		if (column->numeric && values && column->bin_width > 0 && y < max_y) {
+			const char *ramp = " .:-=+*#%@";
+			uint64_t fullest = 1;
+			for (size_t i=0; i < DBT_PROFILE_BINS; i++) {
+				if (column->bins[i] > fullest) fullest = column->bins[i];
+			}
+
+			char bars[DBT_PROFILE_BINS + 1];
+			for (size_t i=0; i < DBT_PROFILE_BINS; i++) bars[i] = ramp[column->bins[i] ? 1 + column->bins[i] * 8 / fullest : 0];
+			bars[DBT_PROFILE_BINS] = 0;
+
+			profile_format_number(low, sizeof(low), column->bin_low);
+			profile_format_number(high, sizeof(high), column->bin_low + column->bin_width * DBT_PROFILE_BINS);
+			snprintf(line, sizeof(line), "  [%s] %s..%s", bars, low, high);
+			mvwaddnstr(win, y++, 2, line, width);
+		}
+	}
+	if (shown < profile->column_count && y < max_y) mvwprintw(win, y, 2, "(+%zu columns)", profile->column_count - shown);
+
+	if (profile->message[0]) mvwaddnstr(win, getmaxy(win) - 2, 2, profile->message, width);
+
+
+	/* Refresh window */
+	wrefresh(win);
+
+
+	return 1;
+}
+
+static void profile_free_columns(struct dbt_profile *profile) {
+	for (size_t j=0; j < profile->column_count; j++) {
+		struct dbt_profile_column *column = &profile->columns[j];
+		free(column->name);
+		free(column->min_text);
+		free(column->max_text);
+		for (size_t i=0; i < column->top_count; i++) free(column->top_values[i]);
+	}
+
+	free(profile->columns);
+	profile->columns = 0;
+	profile->column_count = 0;
+	profile->rows = 0;
+}
+
+static void profile_finish(struct dbt_session *session, const char *format, ...) {
+	struct dbt_profile *profile = &session->profile;
+
+
+	if (profile->active) profile->duration_us = profile_elapsed_us(&profile->started);
+	profile->active = 0;
+
+
+	/* Keep stats on screen with the outcome (empty when the result was read to the end) */
+	va_list args;
+	va_start(args, format);
+	vsnprintf(profile->message, sizeof(profile->message), format, args);
+	va_end(args);
+
+	profile_render(session, 1);
+}
+
+
+
+
+int dbt_profile_toggle(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_profile *profile = &session->profile;
+
+
+	/* Second press stops a running profile (stats so far stay, the tab's query is cancelled) */
+	if (profile->active) {
+		struct dbt_tab *tab = &session->tabs[profile->tab_ind];
+		if (tab->state == DBT_TAB_RUNNING && tab->profiling) tab->adapter.cancel_query(tab->conn_handle, &tab->adapter);
+		profile_finish(session, "cancelled");
+		return 0;
+	}
+
+
+	/* Run the tab's query once, its batches are folded as they arrive (tab service calls dbt_profile_fold) */
+	profile_free_columns(profile);
+	profile->message[0] = 0;
+	profile->tab_ind = session->tab_ind;
+	clock_gettime(CLOCK_MONOTONIC, &profile->started);
+	profile->active = 1;
+	if (dbt_tabs_profile(DBT_PROFILE_BATCH, session)) {
+		profile->active = 0;
+		return 1;
+	}
+
+	profile_render(session, 1);
+
+
+	return 0;
+}
+
+
+int dbt_profile_fold(struct dbt_tab *tab, struct dbt_session *session) {
+	/* Check input */
+	if (!tab || !session) return 0;
+	struct dbt_profile *profile = &session->profile;
+	json_t *rows = json_object_get(tab->pending, "rows");
+
+
+	/* Cancelled profile lets the tab finish with what arrived */
+	if (!profile->active) {
+		json_array_clear(rows);
+		return 0;
+	}
+
+
+	/* Errors end the profile (tab shows the error) */
+	json_t *error = json_object_get(tab->pending, "error");
+	if (!json_is_object(tab->pending) || error) {
+		const char *message = json_string_value(error);
+		profile_finish(session, "%.*s", (int)strcspn(message ? message : "failed", "\n"), message ? message : "failed");
+		return 0;
+	}
+
+
+	/* Fold batch into the sketches, then drop its rows */
+	profile_feed(profile, tab->pending);
+	json_array_clear(rows);
+
+
+	/* Ask for the next batch until the result is read to the end */
+	if (json_is_true(json_object_get(tab->pending, "truncated")) && tab->adapter.fetch_more) {
+		if (!tab->adapter.fetch_more(tab->conn_handle, tab->pending, &tab->adapter)) {
+			profile_render(session, 0);
+			return 1;
+		}
+		profile_finish(session, "fetch failed");
+		return 0;
+	}
+
+	profile_finish(session, "");
+
+
+	return 0;
+}
+
+
+void dbt_profile_stop(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+	struct dbt_profile *profile = &session->profile;
+
+
+	/* Abort running profile, release stats */
+	if (profile->active) profile_finish(session, "cancelled");
+	profile_free_columns(profile);
+	memset(profile, 0, sizeof(*profile));
+}
+
+
+int dbt_profile_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 0;
+	struct dbt_profile *profile = &session->profile;
+	if (!profile->active) return 0;
+
+
+	/* Tab stopped without handing over its result (connection lost or reset) */
+	if (session->tabs[profile->tab_ind].state != DBT_TAB_RUNNING) {
+		profile_finish(session, "stopped");
+		return 1;
+	}
+
+
+	return 0;
+}
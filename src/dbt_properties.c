@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Helper functions */
+static const char *property(json_t *properties, const char *key) {
+	const char *value = json_string_value(json_object_get(properties, key));
+	return value ? value : "-";
+}
+
+static void format_bytes(char *out, size_t out_size, double bytes) {
+	const char *units[] = { "B", "kB", "MB", "GB", "TB" };
+	size_t unit = 0;
+	while (bytes >= 1024 && unit < 4) {
+		bytes /= 1024;
+		unit++;
+	}
+
+	snprintf(out, out_size, unit ? "%.1f %s" : "%.0f %s", bytes, units[unit]);
+}
+
+static void format_count(char *out, size_t out_size, const char *value) {
+	/* Planner estimates are shown rounded (reltuples is -1 until first analyze) */
+	if (!value) {
+		snprintf(out, out_size, "-");
+		return;
+	}
+
+	double count = strtod(value, 0);
+	if (count < 0) snprintf(out, out_size, "unknown (never analyzed)");
+	else if (count >= 1e9) snprintf(out, out_size, "~%.1fG", count / 1e9);
+	else if (count >= 1e6) snprintf(out, out_size, "~%.1fM", count / 1e6);
+	else if (count >= 1e3) snprintf(out, out_size, "~%.1fk", count / 1e3);
+	else snprintf(out, out_size, "~%.0f", count);
+}
+
+static void format_maintenance(char *out, size_t out_size, json_t *properties, const char *manual_key, const char *auto_key) {
+	/* Latest of manual and automatic run (timestamps compare as text) */
+	const char *manual = json_string_value(json_object_get(properties, manual_key));
+	const char *automatic = json_string_value(json_object_get(properties, auto_key));
+	int use_auto = automatic && (!manual || strcmp(automatic, manual) > 0);
+	const char *latest = use_auto ? automatic : manual;
+
+	if (!latest) snprintf(out, out_size, "never");
+	else snprintf(out, out_size, "%.16s%s", latest, use_auto ? " (auto)" : "");
+}
+
+static void properties_send(struct dbt_session *session) {
+	struct dbt_properties *shown = &session->properties;
+	if (!shown->queued) return;
+
+
+	/* Dedicated connection to current database (kept between tables, reopened after a database switch or failure) */
+	const char *database = session->current_database ? session->current_database : "postgres";
+	if (shown->conn_handle && (!shown->database || strcmp(shown->database, database))) {
+		shown->adapter.close_connection(shown->conn_handle, &shown->adapter);
+		shown->conn_handle = 0;
+	}
+
+	if (!shown->conn_handle && session->adapter_handle.open_connection) {
+		shown->adapter = session->adapter_handle;
+		shown->adapter.conn_handle = 0;
+		shown->adapter.db_conn_handle = 0;
+		shown->adapter.row_limit = 0;
+		shown->conn_handle = shown->adapter.open_connection(database, &shown->adapter);
+
+		free(shown->database);
+		shown->database = shown->conn_handle ? strdup(database) : 0;
+	}
+
+
+	/* Send queued preview (result is attached only if no other table was selected meanwhile) */
+	char *query = shown->queued;
+	shown->queued = 0;
+	int failed = !shown->conn_handle || shown->adapter.send_query(query, shown->conn_handle, &shown->adapter);
+	free(query);
+
+	if (failed && shown->conn_handle) {
+		shown->adapter.close_connection(shown->conn_handle, &shown->adapter);
+		shown->conn_handle = 0;
+	}
+	shown->busy = !failed;
+	shown->sent_generation = shown->generation;
+}
+
+static void properties_render(struct dbt_session *session) {
+	struct dbt_properties *shown = &session->properties;
+	json_t *properties = shown->table;
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+	int width = getmaxx(win) - 4;
+	int max_y = getmaxy(win) - 1;
+
+
+	/* Memory view keeps the pane while it is open */
+	if (session->memory.active) return;
+
+
+	/* Clear previous properties */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Properties");
+
+
+	/* Print row estimates, sizes and maintenance */
+	char line[256], value[64], other[64];
+	int y = 1;
+	snprintf(line, sizeof(line), "%s.%s", session->current_schema, session->current_table);
+	mvwaddnstr(win, y++, 2, line, width);
+
+	format_count(value, sizeof(value), json_string_value(json_object_get(properties, "reltuples")));
+	mvwprintw(win, y++, 2, "Rows      %s", value);
+
+	format_count(value, sizeof(value), json_string_value(json_object_get(properties, "n_live_tup")));
+	format_count(other, sizeof(other), json_string_value(json_object_get(properties, "n_dead_tup")));
+	mvwprintw(win, y++, 2, "Live/dead %s / %s", value, other);
+
+	format_bytes(value, sizeof(value), strtod(property(properties, "total_size"), 0));
+	mvwprintw(win, y++, 2, "Total     %s", value);
+	format_bytes(value, sizeof(value), strtod(property(properties, "table_size"), 0));
+	format_bytes(other, sizeof(other), strtod(property(properties, "index_size"), 0));
+	mvwprintw(win, y++, 2, "Heap/idx  %s / %s", value, other);
+
+	format_maintenance(value, sizeof(value), properties, "last_vacuum", "last_autovacuum");
+	mvwprintw(win, y++, 2, "Vacuum    %s", value);
+	format_maintenance(value, sizeof(value), properties, "last_analyze", "last_autoanalyze");
+	mvwprintw(win, y++, 2, "Analyze   %s", value);
+
+
+	/* Print indexes ([name, size, primary, unique]) */
+	json_t *indexes = json_object_get(properties, "indexes");
+	y++;
+	mvwprintw(win, y++, 2, "Indexes (%zu)", json_array_size(indexes));
+
+	size_t index_ind;
+	json_t *index;
+	json_array_foreach(indexes, index_ind, index) {
+		if (y >= max_y) break;
+
+		format_bytes(value, sizeof(value), json_number_value(json_array_get(index, 1)));
+		const char *kind = json_is_true(json_array_get(index, 2)) ? " PK" : json_is_true(json_array_get(index, 3)) ? " UQ" : "";
+		snprintf(line, sizeof(line), "%9s%s %s", value, kind, json_string_value(json_array_get(index, 0)));
+		mvwaddnstr(win, y++, 2, line, width);
+	}
+
+
+	/* Print sampled preview once it arrived, rows formatted like the result window */
+	struct dbt_resultset *resultset = dbt_resultset_from_json(json_object_get(properties, "sample"));
+	if (!resultset && shown->busy && shown->sent_generation == shown->generation && y + 2 < max_y) {
+		y++;
+		mvwprintw(win, y++, 2, "Sample loading...");
+	} else if (resultset && width > 0 && y + 2 < max_y) {
+		y++;
+		mvwprintw(win, y++, 2, "Sample (%.2f%% of pages)", json_real_value(json_object_get(properties, "sample_percent")));
+		dbt_format_measure(resultset);
+
+		size_t line_size = (size_t)width * 4 + 1;
+		char *sample_line = (char *)malloc(line_size);
+		for (size_t i=0; sample_line && i < resultset->row_count && y < max_y; i++) {
+			dbt_format_line(sample_line, line_size, width, resultset, i);
+			mvwaddstr(win, y++, 2, sample_line);
+		}
+
+		free(sample_line);
+	}
+
+	dbt_resultset_free(resultset);
+
+
+	/* Refresh window */
+	wrefresh(win);
+}
+
+
+
+
+int dbt_properties_refresh(struct dbt_session *session) {
+	/* Check input */
+	if (!session || !session->current_schema || !session->current_table) return 1;
+	else if (!session->adapter_handle.load_table_properties) return 1;
+	struct dbt_properties *shown = &session->properties;
+
+
+	/* Load statistics (estimates only, never a full scan) */
+	enum dbt_memory_subsystem scope = dbt_memory_scope(DBT_MEMORY_PROPERTIES);
+	json_t *properties = session->adapter_handle.load_table_properties(session->current_schema, session->current_table, &session->adapter_handle);
+	dbt_memory_scope(scope);
+	if (!properties) return 1;
+
+
+	/* Replace shown table and queue its sampled preview (runs in background, a newer table replaces a queued one) */
+	json_decref(shown->table);
+	shown->table = properties;
+	shown->generation++;
+
+	const char *sample_query = json_string_value(json_object_get(properties, "sample_query"));
+	free(shown->queued);
+	shown->queued = sample_query ? strdup(sample_query) : 0;
+	if (!shown->busy) properties_send(session);
+
+
+	/* Print statistics, preview follows */
+	properties_render(session);
+
+
+	return 0;
+}
+
+
+void dbt_properties_stop(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+	struct dbt_properties *shown = &session->properties;
+
+
+	/* Release preview connection and shown table */
+	if (shown->conn_handle) shown->adapter.close_connection(shown->conn_handle, &shown->adapter);
+	json_decref(shown->table);
+	json_decref(shown->pending);
+	free(shown->database);
+	free(shown->queued);
+	memset(shown, 0, sizeof(*shown));
+}
+
+
+size_t dbt_properties_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session) {
+	/* Check input */
+	if (!fds || !max || !session) return 0;
+	struct dbt_properties *shown = &session->properties;
+	if (!shown->busy) return 0;
+
+
+	/* Socket of preview in flight */
+	fds[0].fd = shown->adapter.connection_fd(shown->conn_handle, &shown->adapter);
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+
+
+	return 1;
+}
+
+
+int dbt_properties_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 0;
+	struct dbt_properties *shown = &session->properties;
+	if (!shown->busy) return 0;
+
+
+	/* Wait for preview rows */
+	enum dbt_memory_subsystem scope = dbt_memory_scope(DBT_MEMORY_PROPERTIES);
+	int busy = shown->adapter.poll_query(shown->conn_handle, &shown->pending, &shown->adapter);
+	dbt_memory_scope(scope);
+	if (busy) return 0;
+	shown->busy = 0;
+
+
+	/* Attach to the table it was taken from (failed previews are left out), then send the one queued meanwhile */
+	int current = shown->table && shown->sent_generation == shown->generation;
+	if (current && !json_object_get(shown->pending, "error")) json_object_set(shown->table, "sample", shown->pending);
+	json_decref(shown->pending);
+	shown->pending = 0;
+	properties_send(session);
+
+
+	/* Properties pane belongs to the dashboard or a running profile */
+	if (!current || session->dashboard.active || session->profile.active) return 0;
+	properties_render(session);
+
+
+	return 1;
+}
@@ -0,0 +1,239 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Helper functions */
+static struct dbt_resultset *current_resultset(struct dbt_session *session) {
+	return session->tabs[session->tab_ind].resultset;
+}
+
+static int visible_row_count(struct dbt_session *session) {
+	/* Rows between separator and bottom border */
+	int max_y = getmaxy(session->app_windows[DBT_WIN_RESULT]);
+	return max_y > 5 ? max_y - 5 : 0;
+}
+
+
+
+
+
+int dbt_results_refresh(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	struct dbt_resultset *resultset = tab->resultset;
+	WINDOW *win = session->app_windows[DBT_WIN_RESULT];
+
+
+	/* Explained runs show their plan tree */
+	if (tab->plan && tab->state != DBT_TAB_RUNNING) return dbt_plan_refresh(tab->plan, session);
+
+
+	/* Clear previous result */
+	wclear(win);
+	box(win, 0, 0);
+
+
+	/* Print title with tab state */
+	switch (tab->state) {
+		case DBT_TAB_RUNNING: {
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			double elapsed = (now.tv_sec - tab->started.tv_sec) + (now.tv_nsec - tab->started.tv_nsec) / 1e9;
+			mvwprintw(win, 0, 2, "Result (%d/%d) - running %.1fs", session->tab_ind + 1, DBT_TAB_MAX, elapsed);
+			break;
+		}
+		case DBT_TAB_DONE:
+			mvwprintw(win, 0, 2, "Result (%d/%d) - %zu rows in %.1fms", session->tab_ind + 1, DBT_TAB_MAX,
+				resultset ? resultset->row_count : 0, tab->duration_us / 1000.0);
+			if (resultset && resultset->view_count != resultset->row_count) wprintw(win, ", %zu shown", resultset->view_count);
+			if (resultset && resultset->source) wprintw(win, ", %s", resultset->kind);
+			if (tab->more) wprintw(win, ", row limit reached (m: fetch more)");
+			else if (tab->partial) wprintw(win, ", row limit reached on some servers");
+			break;
+		case DBT_TAB_FAILED:
+			mvwprintw(win, 0, 2, "Result (%d/%d) - failed after %.1fms", session->tab_ind + 1, DBT_TAB_MAX, tab->duration_us / 1000.0);
+			break;
+		default:
+			mvwprintw(win, 0, 2, "Result (%d/%d)", session->tab_ind + 1, DBT_TAB_MAX);
+			break;
+	}
+
+
+	/* Print error or command status */
+	json_t *result = tab->result;
+	const char *error = json_string_value(json_object_get(result, "error"));
+	const char *command = json_string_value(json_object_get(result, "command"));
+	if (error) mvwprintw(win, 2, 2, "%s", error);
+	else if (command) mvwprintw(win, 2, 2, "%s", command);
+
+	if (!resultset || command) {
+		wrefresh(win);
+		return 0;
+	}
+
+
+	/* Measure column widths (cached on the result set, widened by visible rows) */
+	int max_x = getmaxx(win), max_y = getmaxy(win);
+	int line_width = max_x - 4;
+	size_t visible = visible_row_count(session);
+	dbt_format_measure(resultset);
+	dbt_format_widen(resultset, resultset->view_offset, visible);
+
+	size_t line_size = (size_t)(line_width > 0 ? line_width : 0) * 4 + 1;
+	char *line = (char *)malloc(line_size);
+	if (!line || line_width <= 0) {
+		free(line);
+		wrefresh(win);
+		return 1;
+	}
+
+
+	/* Print columns */
+	dbt_format_line(line, line_size, line_width, resultset, -1);
+	mvwaddstr(win, 2, 2, line);
+
+
+	/* Print separator row */
+	mvwhline(win, 3, 1, ACS_HLINE, max_x-2);
+
+
+	/* Print visible rows through view permutation */
+	size_t offset = resultset->view_offset;
+	for (size_t i=0; i < visible && offset+i < resultset->view_count; i++) {
+		dbt_format_line(line, line_size, line_width, resultset, resultset->view[offset+i]);
+		mvwaddstr(win, 4+i, 2, line);
+	}
+
+	free(line);
+
+
+	/* Print position on bottom border */
+	if (resultset->view_count) {
+		size_t last = offset + visible < resultset->view_count ? offset + visible : resultset->view_count;
+		mvwprintw(win, max_y-1, 2, "%zu-%zu/%zu", offset+1, last, resultset->view_count);
+	}
+
+
+	/* Refresh output */
+	wrefresh(win);
+
+
+	return 0;
+}
+
+
+int dbt_results_scroll(int pages, struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_plan *plan = session->tabs[session->tab_ind].plan;
+	struct dbt_resultset *resultset = current_resultset(session);
+	if (!plan && !resultset) return 1;
+
+
+	/* Move viewport by whole pages, clamped to view (plan nodes when showing a plan) */
+	int64_t page = visible_row_count(session);
+	int64_t count = plan ? (int64_t)plan->node_count : (int64_t)resultset->view_count;
+	int64_t offset = (int64_t)(plan ? plan->view_offset : resultset->view_offset) + pages * page;
+	if (offset > count - page) offset = count - page;
+	if (offset < 0) offset = 0;
+
+	if (plan) plan->view_offset = (size_t)offset;
+	else resultset->view_offset = (size_t)offset;
+
+
+	return dbt_results_refresh(session);
+}
+
+
+int dbt_results_sort(const char *input, struct dbt_session *session) {
+	/* Check input */
+	if (!input || !session) return 1;
+	struct dbt_resultset *resultset = current_resultset(session);
+	if (!resultset) return 1;
+
+
+	/* Parse 'column [desc]' */
+	char column_name[64];
+	char direction[8] = "";
+	if (sscanf(input, "%63s %7s", column_name, direction) < 1) return 1;
+
+	size_t column;
+	if (dbt_resultset_find_column(resultset, column_name, &column)) return 1;
+
+
+	/* Sort view and redraw */
+	if (dbt_resultset_sort(resultset, column, !strcmp(direction, "desc"))) return 1;
+
+
+	return dbt_results_refresh(session);
+}
+
+
+int dbt_results_filter(const char *input, struct dbt_session *session) {
+	/* Check input */
+	if (!input || !session) return 1;
+	struct dbt_resultset *resultset = current_resultset(session);
+	if (!resultset) return 1;
+
+
+	/* Empty filter shows every row again */
+	if (!input[0]) {
+		dbt_resultset_reset(resultset);
+		return dbt_results_refresh(session);
+	}
+
+
+	/* Parse 'column<op>pattern' (= exact, : substring, ~ regex, < > numeric) */
+	size_t name_len = strcspn(input, "=:~<>");
+	if (!input[name_len] || !name_len || name_len >= 64) return 1;
+
+	char column_name[64];
+	memcpy(column_name, input, name_len);
+	column_name[name_len] = 0;
+
+	size_t column;
+	if (dbt_resultset_find_column(resultset, column_name, &column)) return 1;
+
+
+	/* Narrow view and redraw */
+	if (dbt_resultset_filter(resultset, column, input[name_len], input + name_len + 1)) return 1;
+
+
+	return dbt_results_refresh(session);
+}
+
+
+int dbt_results_group(const char *input, struct dbt_session *session) {
+	/* Check input */
+	if (!input || !session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->resultset) return 1;
+
+
+	/* Empty input returns to ungrouped rows */
+	if (!input[0]) {
+		struct dbt_resultset *grouped = tab->resultset;
+		if (!grouped->source) return 1;
+
+		tab->resultset = grouped->source;
+		grouped->source = 0;
+		dbt_resultset_free(grouped);
+
+		return dbt_results_refresh(session);
+	}
+
+
+	/* Group visible rows by column */
+	size_t column;
+	if (dbt_resultset_find_column(tab->resultset, input, &column)) return 1;
+
+	struct dbt_resultset *grouped = dbt_resultset_group(tab->resultset, column);
+	if (!grouped) return 1;
+	tab->resultset = grouped;
+
+
+	return dbt_results_refresh(session);
+}
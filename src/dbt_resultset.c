@@ -0,0 +1,800 @@
+#define _GNU_SOURCE
+
+#include <math.h>
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "dbt.h"
+
+
+/* Helper functions */
+static const struct dbt_resultset_column *sort_column_ctx;
+static const uint32_t *sort_position_ctx;
+static int sort_descending_ctx;
+
+static int compare_text_rows(const void *a, const void *b) {
+	uint32_t row_a = *(const uint32_t *)a, row_b = *(const uint32_t *)b;
+	const struct dbt_resultset_column *column = sort_column_ctx;
+
+
+	/* Compare bytes, then length (shorter first) */
+	uint32_t len_a = column->lengths[row_a], len_b = column->lengths[row_b];
+	int cmp = memcmp(column->values[row_a], column->values[row_b], len_a < len_b ? len_a : len_b);
+	if (!cmp) cmp = (len_a > len_b) - (len_a < len_b);
+	if (sort_descending_ctx) cmp = -cmp;
+
+
+	/* Ties keep their order in the current view (stable, so sorting by another column first gives multi-key order) */
+	uint32_t position_a = sort_position_ctx[row_a], position_b = sort_position_ctx[row_b];
+	return cmp ? cmp : (position_a > position_b) - (position_a < position_b);
+}
+
+static inline uint64_t number_sort_key(double value, int descending) {
+	/* Map double to unsigned key with the same ordering, empty values (NaN) always last */
+	if (isnan(value)) return UINT64_MAX;
+
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	uint64_t key = (bits >> 63) ? ~bits : bits ^ 0x8000000000000000ull;
+	if (descending) key = ~key - 1;
+
+	return key;
+}
+
+static int sort_numeric_view(struct dbt_resultset *resultset, const struct dbt_resultset_column *column, int descending) {
+	/* Prepare key and scratch buffers */
+	size_t count = resultset->view_count;
+	uint64_t *keys = (uint64_t *)malloc(count * sizeof(uint64_t));
+	uint64_t *keys_tmp = (uint64_t *)malloc(count * sizeof(uint64_t));
+	uint32_t *view_tmp = (uint32_t *)malloc(count * sizeof(uint32_t));
+	size_t *histogram = (size_t *)malloc(65536 * sizeof(size_t));
+	if (!keys || !keys_tmp || !view_tmp || !histogram) {
+		free(keys);
+		free(keys_tmp);
+		free(view_tmp);
+		free(histogram);
+		return 1;
+	}
+
+
+	/* Gather keys (branch-free per element, vectorizes) */
+	const double *numbers = column->numbers;
+	const uint32_t *view = resultset->view;
+	for (size_t i=0; i < count; i++) keys[i] = number_sort_key(numbers[view[i]], descending);
+
+
+	/* Stable LSD radix sort, 4 passes of 16 bits */
+	uint64_t *src_keys = keys, *dst_keys = keys_tmp;
+	uint32_t *src_view = resultset->view, *dst_view = view_tmp;
+	for (int shift=0; shift < 64; shift += 16) {
+		memset(histogram, 0, 65536 * sizeof(size_t));
+		for (size_t i=0; i < count; i++) histogram[(src_keys[i] >> shift) & 0xffff]++;
+
+		size_t offset = 0;
+		for (size_t i=0; i < 65536; i++) {
+			size_t bucket = histogram[i];
+			histogram[i] = offset;
+			offset += bucket;
+		}
+
+		for (size_t i=0; i < count; i++) {
+			size_t pos = histogram[(src_keys[i] >> shift) & 0xffff]++;
+			dst_keys[pos] = src_keys[i];
+			dst_view[pos] = src_view[i];
+		}
+
+		uint64_t *swap_keys = src_keys; src_keys = dst_keys; dst_keys = swap_keys;
+		uint32_t *swap_view = src_view; src_view = dst_view; dst_view = swap_view;
+	}
+
+
+	/* Even pass count leaves result in original buffer */
+	free(keys);
+	free(keys_tmp);
+	free(view_tmp);
+	free(histogram);
+
+
+	return 0;
+}
+
+static uint64_t hash_bytes(const char *value, uint32_t length) {
+	/* FNV-1a */
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (uint32_t i=0; i < length; i++) {
+		hash ^= (unsigned char)value[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+/* Hash join state for diffs (previous rows by key, chained in view order) */
+struct diff_join {
+	size_t capacity;
+	uint32_t *slot_rows;
+	uint32_t *slot_next;
+	uint32_t *slot_hashes;
+	uint32_t *chain;
+	uint8_t *matched;
+
+	size_t count;
+	char *ops;
+	uint32_t *rows;
+	uint32_t *previous_rows;
+};
+
+static uint64_t hash_key(const struct dbt_resultset *resultset, const size_t *keys, size_t key_count, uint32_t row) {
+	/* Combine key column hashes (column order matters) */
+	uint64_t hash = 0;
+	for (size_t k=0; k < key_count; k++) {
+		const struct dbt_resultset_column *column = &resultset->columns[keys[k]];
+		hash = (hash ^ hash_bytes(column->values[row], column->lengths[row]) ^ DBT_RESULTSET_NULL(column, row)) * 0x9e3779b97f4a7c15ull;
+	}
+
+	return hash ^ (hash >> 32);
+}
+
+static inline void mark_null(struct dbt_resultset_column *column, size_t row, int null) {
+	column->nulls[row >> 3] |= (uint8_t)((null != 0) << (row & 7));
+}
+
+static inline int values_equal(const struct dbt_resultset_column *a, uint32_t row_a, const struct dbt_resultset_column *b, uint32_t row_b) {
+	/* NULL only equals NULL (not empty text) */
+	return a->lengths[row_a] == b->lengths[row_b] && DBT_RESULTSET_NULL(a, row_a) == DBT_RESULTSET_NULL(b, row_b) && !memcmp(a->values[row_a], b->values[row_b], a->lengths[row_a]);
+}
+
+static int keys_equal(const struct dbt_resultset *a, const size_t *a_keys, uint32_t a_row, const struct dbt_resultset *b, const size_t *b_keys, uint32_t b_row, size_t key_count) {
+	for (size_t k=0; k < key_count; k++) {
+		if (!values_equal(&a->columns[a_keys[k]], a_row, &b->columns[b_keys[k]], b_row)) return 0;
+	}
+
+	return 1;
+}
+
+static int rows_differ(const struct dbt_resultset *resultset, uint32_t row, const struct dbt_resultset *previous, uint32_t previous_row, const size_t *previous_columns) {
+	/* Columns missing on either side are not compared */
+	for (size_t j=0; j < resultset->column_count; j++) {
+		if (previous_columns[j] != SIZE_MAX && !values_equal(&resultset->columns[j], row, &previous->columns[previous_columns[j]], previous_row)) return 1;
+	}
+
+	return 0;
+}
+
+static size_t changed_columns(const struct dbt_resultset *resultset, uint32_t row, const struct dbt_resultset *previous, uint32_t previous_row, const size_t *previous_columns, char *out) {
+	/* Comma separated names of differing columns (only measures without out) */
+	size_t length = 0;
+	for (size_t j=0; j < resultset->column_count; j++) {
+		if (previous_columns[j] == SIZE_MAX || values_equal(&resultset->columns[j], row, &previous->columns[previous_columns[j]], previous_row)) continue;
+
+		size_t name_length = strlen(resultset->columns[j].name);
+		if (out && length) out[length] = ',';
+		if (out) memcpy(out + length + (length != 0), resultset->columns[j].name, name_length);
+		length += (length != 0) + name_length;
+	}
+
+	return length;
+}
+
+static void diff_match(struct diff_join *join, const struct dbt_resultset *resultset, const struct dbt_resultset *previous, const size_t *keys, const size_t *previous_keys, size_t key_count, const size_t *previous_columns, struct dbt_resultset_diff_counts *counts) {
+	size_t mask = join->capacity - 1;
+
+
+	/* Build side: previous rows, inserted backwards so each key chain runs in view order */
+	memset(join->slot_rows, 0xff, join->capacity * sizeof(uint32_t));
+	for (size_t i=previous->view_count; i-- > 0;) {
+		uint32_t row = previous->view[i];
+		uint64_t hash = hash_key(previous, previous_keys, key_count, row);
+
+		size_t slot = hash & mask;
+		while (join->slot_rows[slot] != UINT32_MAX && (join->slot_hashes[slot] != (uint32_t)(hash >> 32) || !keys_equal(previous, previous_keys, row, previous, previous_keys, join->slot_rows[slot], key_count))) slot = (slot + 1) & mask;
+
+		join->chain[row] = join->slot_rows[slot] == UINT32_MAX ? UINT32_MAX : join->slot_next[slot];
+		join->slot_rows[slot] = row;
+		join->slot_next[slot] = row;
+		join->slot_hashes[slot] = (uint32_t)(hash >> 32);
+	}
+
+
+	/* Probe side: each current row takes the next unmatched previous row with its key (duplicate keys pair up in order) */
+	for (size_t i=0; i < resultset->view_count; i++) {
+		uint32_t row = resultset->view[i];
+		uint64_t hash = hash_key(resultset, keys, key_count, row);
+
+		size_t slot = hash & mask;
+		while (join->slot_rows[slot] != UINT32_MAX && (join->slot_hashes[slot] != (uint32_t)(hash >> 32) || !keys_equal(resultset, keys, row, previous, previous_keys, join->slot_rows[slot], key_count))) slot = (slot + 1) & mask;
+
+		uint32_t match = join->slot_rows[slot] == UINT32_MAX ? UINT32_MAX : join->slot_next[slot];
+		if (match == UINT32_MAX) {
+			join->ops[join->count] = 'a';
+			join->rows[join->count] = row;
+			join->previous_rows[join->count++] = UINT32_MAX;
+			counts->added++;
+			continue;
+		}
+
+		join->slot_next[slot] = join->chain[match];
+		join->matched[match] = 1;
+		if (!rows_differ(resultset, row, previous, match, previous_columns)) {
+			counts->unchanged++;
+			continue;
+		}
+
+
+		/* Changed rows are followed by their previous values */
+		join->ops[join->count] = 'c';
+		join->rows[join->count] = row;
+		join->previous_rows[join->count++] = match;
+		join->ops[join->count] = 'b';
+		join->rows[join->count] = row;
+		join->previous_rows[join->count++] = match;
+		counts->changed++;
+	}
+
+
+	/* Previous rows nobody took were removed */
+	for (size_t i=0; i < previous->view_count; i++) {
+		uint32_t row = previous->view[i];
+		if (join->matched[row]) continue;
+
+		join->ops[join->count] = 'r';
+		join->rows[join->count] = UINT32_MAX;
+		join->previous_rows[join->count++] = row;
+		counts->removed++;
+	}
+}
+
+static struct dbt_resultset *diff_build(const struct diff_join *join, struct dbt_resultset *resultset, const struct dbt_resultset *previous, const size_t *previous_columns) {
+	/* Measure copied values (previous rows may go away, current values are borrowed from the owned source) */
+	size_t arena_size = 0;
+	for (size_t i=0; i < join->count; i++) {
+		if (join->ops[i] == 'c') arena_size += changed_columns(resultset, join->rows[i], previous, join->previous_rows[i], previous_columns, 0) + 1;
+		if (join->ops[i] != 'r' && join->ops[i] != 'b') continue;
+
+		for (size_t j=0; j < resultset->column_count; j++) {
+			if (previous_columns[j] != SIZE_MAX) arena_size += previous->columns[previous_columns[j]].lengths[join->previous_rows[i]] + 1;
+		}
+	}
+
+
+	/* Build 'diff, <columns>, changed' result */
+	size_t column_count = resultset->column_count + 2;
+	struct dbt_resultset *diff = dbt_resultset_alloc(column_count, join->count);
+	char *arena = diff ? (char *)malloc(arena_size ? arena_size : 1) : 0;
+	if (!diff || !arena) {
+		free(arena);
+		dbt_resultset_free(diff);
+		return 0;
+	}
+
+	diff->arena = arena;
+	diff->arena_size = arena_size;
+	diff->columns[0].name = strdup("diff");
+	diff->columns[column_count - 1].name = strdup("changed");
+	for (size_t j=0; j < resultset->column_count; j++) {
+		diff->columns[j + 1].name = strdup(resultset->columns[j].name);
+		diff->columns[j + 1].is_numeric = resultset->columns[j].is_numeric;
+	}
+
+	char *cursor = arena;
+	for (size_t i=0; i < join->count; i++) {
+		char op = join->ops[i];
+		int current = op == 'a' || op == 'c';
+		uint32_t row = join->rows[i], previous_row = join->previous_rows[i];
+
+		const char *label = op == 'a' ? "added" : op == 'c' ? "changed" : op == 'b' ? "before" : "removed";
+		diff->columns[0].values[i] = label;
+		diff->columns[0].lengths[i] = strlen(label);
+		diff->columns[0].numbers[i] = NAN;
+
+
+		/* Cells from the current row or copied from the previous one (empty where the column is missing) */
+		for (size_t j=0; j < resultset->column_count; j++) {
+			struct dbt_resultset_column *column = &diff->columns[j + 1];
+			if (current) {
+				column->values[i] = resultset->columns[j].values[row];
+				column->lengths[i] = resultset->columns[j].lengths[row];
+				column->numbers[i] = resultset->columns[j].numbers[row];
+				mark_null(column, i, DBT_RESULTSET_NULL(&resultset->columns[j], row));
+			} else if (previous_columns[j] != SIZE_MAX) {
+				const struct dbt_resultset_column *previous_column = &previous->columns[previous_columns[j]];
+				uint32_t length = previous_column->lengths[previous_row];
+				memcpy(cursor, previous_column->values[previous_row], length);
+				cursor[length] = 0;
+				column->values[i] = cursor;
+				column->lengths[i] = length;
+				column->numbers[i] = previous_column->numbers[previous_row];
+				mark_null(column, i, DBT_RESULTSET_NULL(previous_column, previous_row));
+				cursor += length + 1;
+			} else {
+				column->values[i] = "";
+				column->lengths[i] = 0;
+				column->numbers[i] = NAN;
+			}
+		}
+
+
+		/* Names of differing columns on changed rows */
+		struct dbt_resultset_column *changed = &diff->columns[column_count - 1];
+		size_t length = op == 'c' ? changed_columns(resultset, row, previous, previous_row, previous_columns, cursor) : 0;
+		if (op == 'c') {
+			cursor[length] = 0;
+			changed->values[i] = cursor;
+			cursor += length + 1;
+		} else changed->values[i] = "";
+		changed->lengths[i] = (uint32_t)length;
+		changed->numbers[i] = NAN;
+	}
+
+
+	return diff;
+}
+
+static int decimal_literal(const char *value, uint32_t length) {
+	/* Optional sign, digits with optional fraction (at least one digit), optional exponent; no nan/inf, hex or spaces */
+	uint32_t i = value[0] == '+' || value[0] == '-';
+	uint32_t digits = 0;
+	for (; i < length && value[i] >= '0' && value[i] <= '9'; i++) digits++;
+	if (i < length && value[i] == '.') {
+		for (i++; i < length && value[i] >= '0' && value[i] <= '9'; i++) digits++;
+	}
+	if (!digits) return 0;
+
+	if (i < length && (value[i] == 'e' || value[i] == 'E')) {
+		i += i + 1 < length && (value[i+1] == '+' || value[i+1] == '-');
+		uint32_t exponent_digits = 0;
+		for (i++; i < length && value[i] >= '0' && value[i] <= '9'; i++) exponent_digits++;
+		if (!exponent_digits) return 0;
+	}
+
+
+	return i == length;
+}
+
+static void resultset_detect_numeric(struct dbt_resultset_column *column, size_t row_count) {
+	/* Column is numeric when every non-empty value is a decimal literal */
+	column->is_numeric = 1;
+	size_t non_empty = 0;
+	for (size_t i=0; i < row_count; i++) {
+		if (!column->lengths[i]) {
+			column->numbers[i] = NAN;
+			continue;
+		}
+
+		if (!decimal_literal(column->values[i], column->lengths[i])) {
+			column->is_numeric = 0;
+			for (; i < row_count; i++) column->numbers[i] = NAN;
+			return;
+		}
+		column->numbers[i] = strtod(column->values[i], 0);
+		non_empty++;
+	}
+
+	if (!non_empty) column->is_numeric = 0;
+}
+
+
+
+
+struct dbt_resultset *dbt_resultset_alloc(size_t column_count, size_t row_count) {
+	/* Allocate result set with identity view (no cell is null yet) */
+	struct dbt_resultset *resultset = (struct dbt_resultset *)calloc(1, sizeof(struct dbt_resultset));
+	if (!resultset) return 0;
+
+	resultset->column_count = column_count;
+	resultset->row_count = row_count;
+	resultset->columns = (struct dbt_resultset_column *)calloc(column_count ? column_count : 1, sizeof(struct dbt_resultset_column));
+	resultset->view = (uint32_t *)malloc((row_count ? row_count : 1) * sizeof(uint32_t));
+	if (!resultset->columns || !resultset->view) {
+		dbt_resultset_free(resultset);
+		return 0;
+	}
+
+	for (size_t i=0; i < column_count; i++) {
+		struct dbt_resultset_column *column = &resultset->columns[i];
+		column->values = (const char **)malloc((row_count ? row_count : 1) * sizeof(const char *));
+		column->lengths = (uint32_t *)malloc((row_count ? row_count : 1) * sizeof(uint32_t));
+		column->numbers = (double *)malloc((row_count ? row_count : 1) * sizeof(double));
+		column->nulls = (uint8_t *)calloc(row_count / 8 + 1, sizeof(uint8_t));
+		if (!column->values || !column->lengths || !column->numbers || !column->nulls) {
+			dbt_resultset_free(resultset);
+			return 0;
+		}
+	}
+
+	dbt_resultset_reset(resultset);
+
+
+	return resultset;
+}
+
+
+struct dbt_resultset *dbt_resultset_from_json(json_t *result) {
+	/* Check input */
+	json_t *column_list = json_object_get(result, "columns");
+	json_t *row_list = json_object_get(result, "rows");
+	if (!json_is_array(column_list) || !json_is_array(row_list)) return 0;
+
+	size_t column_count = json_array_size(column_list);
+	size_t row_count = json_array_size(row_list);
+	if (row_count > UINT32_MAX) return 0;
+
+
+	/* Measure values for a single arena */
+	size_t arena_size = 0;
+	for (size_t i=0; i < row_count; i++) {
+		json_t *row_values = json_array_get(row_list, i);
+		for (size_t j=0; j < column_count; j++) arena_size += json_string_length(json_array_get(row_values, j)) + 1;
+	}
+
+
+	/* Allocate */
+	struct dbt_resultset *resultset = dbt_resultset_alloc(column_count, row_count);
+	if (!resultset) return 0;
+
+	resultset->arena = (char *)malloc(arena_size ? arena_size : 1);
+	if (!resultset->arena) {
+		dbt_resultset_free(resultset);
+		return 0;
+	}
+	resultset->arena_size = arena_size;
+
+
+	/* Copy values column by column */
+	char *cursor = resultset->arena;
+	for (size_t j=0; j < column_count; j++) {
+		struct dbt_resultset_column *column = &resultset->columns[j];
+		const char *name = json_string_value(json_array_get(column_list, j));
+		column->name = strdup(name ? name : "");
+
+		for (size_t i=0; i < row_count; i++) {
+			json_t *cell = json_array_get(json_array_get(row_list, i), j);
+			const char *value = json_string_value(cell);
+			size_t length = value ? json_string_length(cell) : 0;
+
+			memcpy(cursor, value ? value : "", length);
+			cursor[length] = 0;
+			column->values[i] = cursor;
+			column->lengths[i] = (uint32_t)length;
+			mark_null(column, i, !value);
+			cursor += length + 1;
+		}
+
+		resultset_detect_numeric(column, row_count);
+	}
+
+
+	return resultset;
+}
+
+
+void dbt_resultset_free(struct dbt_resultset *resultset) {
+	/* Check input */
+	if (!resultset) return;
+
+
+	/* Release columns, arena and source (group results keep their source alive) */
+	for (size_t i=0; i < resultset->column_count && resultset->columns; i++) {
+		free(resultset->columns[i].name);
+		free(resultset->columns[i].values);
+		free(resultset->columns[i].lengths);
+		free(resultset->columns[i].numbers);
+		free(resultset->columns[i].nulls);
+	}
+
+	free(resultset->columns);
+	free(resultset->arena);
+	if (resultset->mapping) munmap(resultset->mapping, resultset->mapping_size);
+	free(resultset->view);
+	dbt_resultset_free(resultset->source);
+	free(resultset);
+}
+
+
+void dbt_resultset_reset(struct dbt_resultset *resultset) {
+	/* Check input */
+	if (!resultset) return;
+
+
+	/* Identity view */
+	for (size_t i=0; i < resultset->row_count; i++) resultset->view[i] = (uint32_t)i;
+	resultset->view_count = resultset->row_count;
+	resultset->view_offset = 0;
+}
+
+
+int dbt_resultset_find_column(const struct dbt_resultset *resultset, const char *name, size_t *column) {
+	/* Check input */
+	if (!resultset || !name || !column) return 1;
+
+
+	/* Match by name */
+	for (size_t i=0; i < resultset->column_count; i++) {
+		if (strcmp(resultset->columns[i].name, name)) continue;
+
+		*column = i;
+		return 0;
+	}
+
+
+	/* Fall back to 1-based position */
+	char *end;
+	long position = strtol(name, &end, 10);
+	if (*end || position < 1 || (size_t)position > resultset->column_count) return 1;
+	*column = position - 1;
+
+
+	return 0;
+}
+
+
+int dbt_resultset_sort(struct dbt_resultset *resultset, size_t column, int descending) {
+	/* Check input */
+	if (!resultset || column >= resultset->column_count) return 1;
+	struct dbt_resultset_column *sort_column = &resultset->columns[column];
+
+
+	/* Sort visible rows only (permutation, rows are never moved; both sorts are stable over the current view) */
+	resultset->view_offset = 0;
+	if (sort_column->is_numeric) return sort_numeric_view(resultset, sort_column, descending);
+
+
+	/* Text compares bytes, ties by position in the current view */
+	uint32_t *positions = (uint32_t *)malloc((resultset->row_count ? resultset->row_count : 1) * sizeof(uint32_t));
+	if (!positions) return 1;
+	for (size_t i=0; i < resultset->view_count; i++) positions[resultset->view[i]] = (uint32_t)i;
+
+	sort_column_ctx = sort_column;
+	sort_position_ctx = positions;
+	sort_descending_ctx = descending;
+	qsort(resultset->view, resultset->view_count, sizeof(uint32_t), compare_text_rows);
+	sort_column_ctx = 0;
+	sort_position_ctx = 0;
+	free(positions);
+
+
+	return 0;
+}
+
+
+int dbt_resultset_filter(struct dbt_resultset *resultset, size_t column, char op, const char *pattern) {
+	/* Check input */
+	if (!resultset || !pattern || column >= resultset->column_count) return 1;
+	struct dbt_resultset_column *filter_column = &resultset->columns[column];
+	uint32_t *view = resultset->view;
+	size_t count = resultset->view_count, kept = 0;
+
+
+	/* Narrow current view in place */
+	switch (op) {
+		case '<':
+		case '>': {
+			/* Numeric comparison over contiguous doubles (NaN never matches) */
+			char *end;
+			double bound = strtod(pattern, &end);
+			if (*end || end == pattern) return 1;
+
+			const double *numbers = filter_column->numbers;
+			if (!filter_column->is_numeric) return 1;
+
+			for (size_t i=0; i < count; i++) {
+				double value = numbers[view[i]];
+				int match = op == '<' ? value < bound : value > bound;
+				view[kept] = view[i];
+				kept += match;
+			}
+			break;
+		}
+		case '=': {
+			/* Exact match */
+			size_t pattern_len = strlen(pattern);
+			for (size_t i=0; i < count; i++) {
+				uint32_t row = view[i];
+				int match = filter_column->lengths[row] == pattern_len && !memcmp(filter_column->values[row], pattern, pattern_len);
+				view[kept] = row;
+				kept += match;
+			}
+			break;
+		}
+		case ':': {
+			/* Substring */
+			size_t pattern_len = strlen(pattern);
+			for (size_t i=0; i < count; i++) {
+				uint32_t row = view[i];
+				int match = memmem(filter_column->values[row], filter_column->lengths[row], pattern, pattern_len) != 0;
+				view[kept] = row;
+				kept += match;
+			}
+			break;
+		}
+		case '~': {
+			/* POSIX extended regex */
+			regex_t regex;
+			if (regcomp(&regex, pattern, REG_EXTENDED | REG_NOSUB)) return 1;
+
+			for (size_t i=0; i < count; i++) {
+				uint32_t row = view[i];
+				int match = !regexec(&regex, filter_column->values[row], 0, 0, 0);
+				view[kept] = row;
+				kept += match;
+			}
+
+			regfree(&regex);
+			break;
+		}
+		default:
+			return 1;
+	}
+
+	resultset->view_count = kept;
+	resultset->view_offset = 0;
+
+
+	return 0;
+}
+
+
+struct dbt_resultset *dbt_resultset_group(struct dbt_resultset *resultset, size_t column) {
+	/* Check input */
+	if (!resultset || column >= resultset->column_count) return 0;
+	struct dbt_resultset_column *group_column = &resultset->columns[column];
+
+
+	/* Prepare open addressing table (power of two, at most half full) */
+	size_t capacity = 16;
+	while (capacity < resultset->view_count * 2) capacity <<= 1;
+
+	uint32_t *slot_rows = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+	uint64_t *slot_counts = (uint64_t *)calloc(capacity, sizeof(uint64_t));
+	uint32_t *group_rows = (uint32_t *)malloc((resultset->view_count ? resultset->view_count : 1) * sizeof(uint32_t));
+	uint64_t *group_slots = (uint64_t *)malloc((resultset->view_count ? resultset->view_count : 1) * sizeof(uint64_t));
+	if (!slot_rows || !slot_counts || !group_rows || !group_slots) {
+		free(slot_rows);
+		free(slot_counts);
+		free(group_rows);
+		free(group_slots);
+		return 0;
+	}
+
+
+	/* Count visible rows per distinct value (first-seen order) */
+	size_t group_count = 0;
+	for (size_t i=0; i < resultset->view_count; i++) {
+		uint32_t row = resultset->view[i];
+		const char *value = group_column->values[row];
+		uint32_t length = group_column->lengths[row];
+
+		size_t slot = (hash_bytes(value, length) ^ DBT_RESULTSET_NULL(group_column, row)) & (capacity - 1);
+		while (slot_counts[slot]) {
+			if (values_equal(group_column, slot_rows[slot], group_column, row)) break;
+			slot = (slot + 1) & (capacity - 1);
+		}
+
+		if (!slot_counts[slot]) {
+			slot_rows[slot] = row;
+			group_rows[group_count] = row;
+			group_slots[group_count] = slot;
+			group_count++;
+		}
+		slot_counts[slot]++;
+	}
+
+
+	/* Build '<column>, count' result (values borrowed from source arena, so it takes ownership of source) */
+	struct dbt_resultset *grouped = dbt_resultset_alloc(2, group_count);
+	char *arena = grouped ? (char *)malloc((group_count ? group_count : 1) * 21) : 0;
+	if (!grouped || !arena) {
+		free(arena);
+		dbt_resultset_free(grouped);
+		grouped = 0;
+	} else {
+		grouped->arena = arena;
+		grouped->arena_size = (group_count ? group_count : 1) * 21;
+		grouped->source = resultset;
+		grouped->kind = "grouped";
+		grouped->columns[0].name = strdup(group_column->name);
+		grouped->columns[1].name = strdup("count");
+
+		char *cursor = arena;
+		for (size_t i=0; i < group_count; i++) {
+			uint32_t row = group_rows[i];
+			grouped->columns[0].values[i] = group_column->values[row];
+			grouped->columns[0].lengths[i] = group_column->lengths[row];
+			grouped->columns[0].numbers[i] = group_column->numbers[row];
+			mark_null(&grouped->columns[0], i, DBT_RESULTSET_NULL(group_column, row));
+
+			int length = snprintf(cursor, 21, "%llu", (unsigned long long)slot_counts[group_slots[i]]);
+			grouped->columns[1].values[i] = cursor;
+			grouped->columns[1].lengths[i] = length;
+			grouped->columns[1].numbers[i] = (double)slot_counts[group_slots[i]];
+			cursor += length + 1;
+		}
+
+		grouped->columns[0].is_numeric = group_column->is_numeric;
+		grouped->columns[1].is_numeric = 1;
+
+
+		/* Most frequent first */
+		dbt_resultset_sort(grouped, 1, 1);
+	}
+
+	free(slot_rows);
+	free(slot_counts);
+	free(group_rows);
+	free(group_slots);
+
+
+	return grouped;
+}
+
+
+
+struct dbt_resultset *dbt_resultset_diff(struct dbt_resultset *resultset, const struct dbt_resultset *previous, const size_t *keys, size_t key_count, struct dbt_resultset_diff_counts *counts) {
+	/* Check input */
+	if (!resultset || !previous || !keys || !key_count || !counts) return 0;
+	else if (resultset->view_count + previous->view_count > UINT32_MAX) return 0;
+	memset(counts, 0, sizeof(*counts));
+
+
+	/* Match columns by name, key columns must exist on both sides */
+	size_t *previous_columns = (size_t *)malloc((resultset->column_count ? resultset->column_count : 1) * sizeof(size_t));
+	size_t *previous_keys = (size_t *)malloc(key_count * sizeof(size_t));
+	int keys_found = previous_columns && previous_keys;
+	for (size_t j=0; keys_found && j < resultset->column_count; j++) {
+		previous_columns[j] = SIZE_MAX;
+		for (size_t c=0; c < previous->column_count && previous_columns[j] == SIZE_MAX; c++) {
+			if (!strcmp(resultset->columns[j].name, previous->columns[c].name)) previous_columns[j] = c;
+		}
+	}
+	for (size_t k=0; keys_found && k < key_count; k++) {
+		if (keys[k] >= resultset->column_count || previous_columns[keys[k]] == SIZE_MAX) keys_found = 0;
+		else previous_keys[k] = previous_columns[keys[k]];
+	}
+
+
+	/* Prepare open addressing table over previous rows (power of two, at most half full) and output slots */
+	struct diff_join join = {0};
+	join.capacity = 16;
+	while (join.capacity < previous->view_count * 2) join.capacity <<= 1;
+
+	size_t out_max = resultset->view_count + previous->view_count;
+	if (keys_found) {
+		join.slot_rows = (uint32_t *)malloc(join.capacity * sizeof(uint32_t));
+		join.slot_next = (uint32_t *)malloc(join.capacity * sizeof(uint32_t));
+		join.slot_hashes = (uint32_t *)malloc(join.capacity * sizeof(uint32_t));
+		join.chain = (uint32_t *)malloc((previous->row_count ? previous->row_count : 1) * sizeof(uint32_t));
+		join.matched = (uint8_t *)calloc(previous->row_count ? previous->row_count : 1, sizeof(uint8_t));
+		join.ops = (char *)malloc(out_max ? out_max : 1);
+		join.rows = (uint32_t *)malloc((out_max ? out_max : 1) * sizeof(uint32_t));
+		join.previous_rows = (uint32_t *)malloc((out_max ? out_max : 1) * sizeof(uint32_t));
+	}
+
+
+	/* Join, then build result over the join output (takes ownership of the current rows as source) */
+	struct dbt_resultset *diff = 0;
+	if (join.slot_rows && join.slot_next && join.slot_hashes && join.chain && join.matched && join.ops && join.rows && join.previous_rows) {
+		diff_match(&join, resultset, previous, keys, previous_keys, key_count, previous_columns, counts);
+		diff = diff_build(&join, resultset, previous, previous_columns);
+	}
+
+	if (diff) {
+		diff->source = resultset;
+		diff->kind = "diff";
+	}
+
+	free(join.slot_rows);
+	free(join.slot_next);
+	free(join.slot_hashes);
+	free(join.chain);
+	free(join.matched);
+	free(join.ops);
+	free(join.rows);
+	free(join.previous_rows);
+	free(previous_columns);
+	free(previous_keys);
+
+
+	return diff;
+}
@@ -9,27 +9,12 @@ int dbt_schemas_refresh(struct dbt_session *session) {
 
 
 	/* Load schemas */
-	session->schema_list = session->adapter_handle.load_schema_list(&session->adapter_handle);
-	if (!json_is_array(session->schema_list)) return 1;
+	if (session->adapter_handle.load_schema_list(&session->schema_list, &session->strings, &session->adapter_handle)) return 1;
+	dbt_complete_names(DBT_COMPLETE_SCHEMAS, 0, 0, session->schema_list.names, session->schema_list.count, 1, session);
 
 
-	/* Clear previous list */
-	wclear(session->app_windows[DBT_WIN_SCHEMAS]);
-	box(session->app_windows[DBT_WIN_SCHEMAS], 0, 0);
-	mvwprintw(session->app_windows[DBT_WIN_SCHEMAS], 0, 2, "Schemas");
-
-
-	/* Print new schema list */
-	size_t list_size = json_array_size(session->schema_list);
-	for (size_t i=0; i < list_size; i++) {
-		const char *schema_name = json_string_value(json_array_get(session->schema_list, i));
-
-		mvwprintw(session->app_windows[DBT_WIN_SCHEMAS], i+1, 2, "[ ] %s", schema_name);
-	}
-
-
-	/* Refresh window */
-	wrefresh(session->app_windows[DBT_WIN_SCHEMAS]);
+	/* Print new schema list (from top) */
+	dbt_list_reset(DBT_WIN_SCHEMAS, session);
 
 
 	return 0;
@@ -38,43 +23,32 @@ int dbt_schemas_refresh(struct dbt_session *session) {
 int dbt_schemas_select(const char *schema, struct dbt_session *session) {
 	/* Check input */
 	if (!schema || !session) return 1;
-	else if (!json_is_array(session->schema_list)) return 1;
-
-
-	/* Load requested schema */
-	int found_schema = 0;
-	size_t schema_count = json_array_size(session->schema_list);
-	for (size_t i=0; i < schema_count; i++) {
-		const char *schema_name = json_string_value(json_array_get(session->schema_list, i));
-		if (!strcmp(schema_name, schema)) {
-			/* Set found schema flag */
-			found_schema = 1;
 
 
-			/* Mark as selected */
-			mvwprintw(session->app_windows[DBT_WIN_SCHEMAS], i+1, 2, "[*]");
-
-
-			/* Store as current */
-			session->current_schema = schema_name;
+	/* Find requested schema */
+	size_t schema_count = session->schema_list.count;
+	size_t ind = 0;
+	for (; ind < schema_count; ind++) {
+		if (!strcmp(dbt_strings_get(&session->strings, session->schema_list.names[ind]), schema)) break;
+	}
 
 
-			/* Refresh tables */
-			dbt_tables_refresh(session);
-		} else mvwprintw(session->app_windows[DBT_WIN_SCHEMAS], i+1, 2, "[ ]");
+	/* Clear variables if schema not found */
+	if (ind == schema_count) {
+		session->current_schema = 0;
+		dbt_list_render(DBT_WIN_SCHEMAS, session);
+		return 1;
 	}
 
 
-	/* Refresh window */
-	wrefresh(session->app_windows[DBT_WIN_SCHEMAS]);
+	/* Store as current and mark as selected (scrolled into view) */
+	session->current_schema = dbt_strings_get(&session->strings, session->schema_list.names[ind]);
+	dbt_list_reveal(DBT_WIN_SCHEMAS, ind, session);
 
 
-	/* Clear windows/variables if schema not found */
-	if (!found_schema) {
-		session->current_schema = 0;
-	}
+	/* Refresh tables */
+	dbt_tables_refresh(session);
 
 
-
-	return !found_schema;
+	return 0;
 }
@@ -0,0 +1,470 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_SCRIPT_WINDOW 64
+#define DBT_SCRIPT_TEXT_WIDTH 80
+
+
+/* Lexer state of one statement (keywords outside quotes and comments) */
+struct script_words {
+	const char *first;
+	size_t first_len;
+	const char *second;
+	size_t second_len;
+	const char *previous;
+	size_t previous_len;
+	size_t count;
+	int concurrently;
+	int atomic_depth;
+};
+
+
+/* Helper functions */
+static uint64_t script_elapsed_us(const struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) * 1000000ull + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static int script_ident_char(char c) {
+	return isalnum((unsigned char)c) || c == '_' || c == '$' || (unsigned char)c >= 0x80;
+}
+
+static int script_word_is(const char *word, size_t word_len, const char *keyword) {
+	return word && word_len == strlen(keyword) && !strncasecmp(word, keyword, word_len);
+}
+
+static void script_add_word(struct script_words *words, const char *word, size_t word_len) {
+	/* Remember leading keywords, track BEGIN ATOMIC bodies (their semicolons do not end the statement) */
+	if (words->count == 0) {
+		words->first = word;
+		words->first_len = word_len;
+	} else if (words->count == 1) {
+		words->second = word;
+		words->second_len = word_len;
+	}
+
+	if (script_word_is(word, word_len, "CONCURRENTLY")) words->concurrently = 1;
+
+	if (script_word_is(words->first, words->first_len, "CREATE")) {
+		if (script_word_is(word, word_len, "ATOMIC") && script_word_is(words->previous, words->previous_len, "BEGIN")) words->atomic_depth++;
+		else if (words->atomic_depth && script_word_is(word, word_len, "CASE")) words->atomic_depth++;
+		else if (words->atomic_depth && script_word_is(word, word_len, "END")) words->atomic_depth--;
+	}
+
+	words->previous = word;
+	words->previous_len = word_len;
+	words->count++;
+}
+
+static size_t script_skip_quoted(const char *text, size_t i, char quote, int backslash) {
+	/* Position after closing quote (doubled quotes and optional backslash escapes stay inside) */
+	for (i++; text[i]; i++) {
+		if (backslash && text[i] == '\\' && text[i+1]) i++;
+		else if (text[i] == quote && text[i+1] == quote) i++;
+		else if (text[i] == quote) return i + 1;
+	}
+
+
+	return i;
+}
+
+static size_t script_skip_dollar(const char *text, size_t i) {
+	/* '$tag$ ... $tag$' (0 when this is no dollar quote, e.g. a $1 parameter) */
+	size_t tag_end = i + 1;
+	if (isdigit((unsigned char)text[tag_end])) return 0;
+	while (text[tag_end] && text[tag_end] != '$' && script_ident_char(text[tag_end])) tag_end++;
+	if (text[tag_end] != '$') return 0;
+
+	size_t tag_len = tag_end - i + 1;
+	for (const char *close = strchr(text + tag_end + 1, '$'); close; close = strchr(close + 1, '$')) {
+		if (!strncmp(close, text + i, tag_len)) return close - text + tag_len;
+	}
+
+
+	return strlen(text);
+}
+
+static size_t script_skip_comment(const char *text, size_t i) {
+	/* Line comments end at newline, block comments nest */
+	if (text[i] == '-') {
+		while (text[i] && text[i] != '\n') i++;
+		return i;
+	}
+
+	int depth = 0;
+	while (text[i]) {
+		if (text[i] == '/' && text[i+1] == '*') {
+			depth++;
+			i += 2;
+		} else if (text[i] == '*' && text[i+1] == '/') {
+			i += 2;
+			if (!--depth) return i;
+		} else i++;
+	}
+
+
+	return i;
+}
+
+static int script_add_statement(struct dbt_script *script, char *text, size_t length, const struct script_words *words, size_t *cap) {
+	/* Trim whitespace, statements without keywords (only comments) are dropped */
+	while (length && isspace((unsigned char)*text)) {
+		text++;
+		length--;
+	}
+	while (length && isspace((unsigned char)text[length-1])) length--;
+	text[length] = 0;
+	if (!words->count) return 0;
+
+
+	/* Grow statement list */
+	if (script->count == *cap) {
+		size_t new_cap = *cap ? *cap * 2 : 32;
+		struct dbt_script_statement *statements = (struct dbt_script_statement *)realloc(script->statements, new_cap * sizeof(*statements));
+		if (!statements) return 1;
+		script->statements = statements;
+		*cap = new_cap;
+	}
+
+
+	/* Statements refused inside transaction blocks get their own sync group */
+	struct dbt_script_statement *statement = &script->statements[script->count++];
+	memset(statement, 0, sizeof(*statement));
+	statement->text = text;
+	statement->isolated = words->concurrently
+		|| script_word_is(words->first, words->first_len, "VACUUM")
+		|| (script_word_is(words->first, words->first_len, "ALTER") && script_word_is(words->second, words->second_len, "SYSTEM"))
+		|| (script_word_is(words->first, words->first_len, "REINDEX") && (script_word_is(words->second, words->second_len, "DATABASE") || script_word_is(words->second, words->second_len, "SYSTEM")))
+		|| ((script_word_is(words->first, words->first_len, "CREATE") || script_word_is(words->first, words->first_len, "DROP"))
+			&& (script_word_is(words->second, words->second_len, "DATABASE") || script_word_is(words->second, words->second_len, "TABLESPACE")));
+
+	statement->ends_transaction = script_word_is(words->first, words->first_len, "COMMIT")
+		|| script_word_is(words->first, words->first_len, "END")
+		|| script_word_is(words->first, words->first_len, "ABORT")
+		|| (script_word_is(words->first, words->first_len, "ROLLBACK") && !script_word_is(words->second, words->second_len, "TO"))
+		|| (script_word_is(words->first, words->first_len, "PREPARE") && script_word_is(words->second, words->second_len, "TRANSACTION"));
+
+
+	return 0;
+}
+
+static int script_split(struct dbt_script *script) {
+	/* Cut text in place at top level semicolons (quotes, dollar quotes, comments and BEGIN ATOMIC bodies are skipped) */
+	char *text = script->text;
+	size_t start = 0, cap = 0, i = 0;
+	struct script_words words = { 0 };
+
+	while (text[i]) {
+		char c = text[i];
+		size_t skip;
+
+		if ((c == '-' && text[i+1] == '-') || (c == '/' && text[i+1] == '*')) i = script_skip_comment(text, i);
+		else if (c == '\'') i = script_skip_quoted(text, i, '\'', 0);
+		else if (c == '"') i = script_skip_quoted(text, i, '"', 0);
+		else if (c == '$' && (skip = script_skip_dollar(text, i))) i = skip;
+		else if (isalpha((unsigned char)c) || c == '_' || (unsigned char)c >= 0x80) {
+			/* Keyword or identifier, E'' strings take backslash escapes */
+			size_t word_start = i;
+			while (script_ident_char(text[i])) i++;
+
+			if (i - word_start == 1 && (c == 'E' || c == 'e') && text[i] == '\'') i = script_skip_quoted(text, i, '\'', 1);
+			else script_add_word(&words, text + word_start, i - word_start);
+		} else if (c == ';' && !words.atomic_depth) {
+			if (script_add_statement(script, text + start, i - start, &words, &cap)) return 1;
+			memset(&words, 0, sizeof(words));
+			start = ++i;
+		} else i++;
+	}
+
+
+	/* Last statement may lack its semicolon */
+	return script_add_statement(script, text + start, i - start, &words, &cap);
+}
+
+static void script_set_status(struct dbt_script_statement *statement, const char *status) {
+	json_object_set_new(statement->result, "status", json_string(status));
+}
+
+static void script_record(struct dbt_script *script, json_t *outcome) {
+	/* Time since the previous result (statements run one after another on the server) */
+	struct dbt_script_statement *statement = &script->statements[script->next_result++];
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	const struct timespec *since = &script->last_result;
+	if (statement->sent.tv_sec > since->tv_sec || (statement->sent.tv_sec == since->tv_sec && statement->sent.tv_nsec > since->tv_nsec)) since = &statement->sent;
+	statement->duration_us = (now.tv_sec - since->tv_sec) * 1000000ull + (now.tv_nsec - since->tv_nsec) / 1000;
+	statement->result = outcome;
+	script->last_result = now;
+
+
+	/* Statement ending a transaction moves the rollback mark */
+	const char *status = json_string_value(json_object_get(outcome, "status"));
+	int ok = status && !strcmp(status, "ok");
+	if (ok && statement->ends_transaction) script->commit_mark = script->next_result;
+	else if (ok || (status && !strcmp(status, "skipped"))) return;
+
+
+	/* Failed statement, in stop mode the open transaction is lost and the rest of its group is aborted by the server */
+	script->failed_count++;
+	if (script->continue_on_error) return;
+
+	script->stopping = 1;
+	for (size_t i=script->commit_mark; i + 1 < script->next_result; i++) {
+		status = json_string_value(json_object_get(script->statements[i].result, "status"));
+		if (status && !strcmp(status, "ok")) script_set_status(&script->statements[i], "rolled back");
+	}
+}
+
+static void script_send(struct dbt_script *script) {
+	/* Keep up to a window of statements on the wire */
+	while (!script->error) {
+		int status;
+
+		if (script->stopping) {
+			/* Close group cut short by an error or cancel (its unsent statements never run) */
+			if (!script->group_open) break;
+
+			status = script->adapter->pipeline_send(0, 1, script->conn_handle, script->adapter);
+			if (!status) {
+				script->group_open = 0;
+				script->pending_syncs++;
+			}
+		} else {
+			if (script->next_send == script->count || script->next_send - script->next_result >= DBT_SCRIPT_WINDOW) break;
+
+			/* Stop mode sends the next group only once the previous one succeeded */
+			if (!script->continue_on_error && script->pending_syncs) break;
+
+
+			/* Sync after every statement when errors are skipped, otherwise only around isolated statements and at the end */
+			size_t ind = script->next_send;
+			struct dbt_script_statement *statement = &script->statements[ind];
+			int sync = script->continue_on_error || statement->isolated || ind + 1 == script->count || script->statements[ind+1].isolated;
+
+			status = script->adapter->pipeline_send(statement->text, sync, script->conn_handle, script->adapter);
+			if (!status) {
+				clock_gettime(CLOCK_MONOTONIC, &statement->sent);
+				script->next_send++;
+				script->group_open = !sync;
+				if (sync) script->pending_syncs++;
+			}
+		}
+
+		if (status > 0) {
+			script->events |= POLLOUT;
+			break;
+		} else if (status < 0) script->error = strdup("send failed");
+	}
+}
+
+static json_t *script_merge(struct dbt_script *script) {
+	/* One row per statement */
+	json_t *merged = json_object();
+	json_t *column_list = json_array();
+	const char *columns[] = { "#", "statement", "status", "rows", "ms" };
+	for (size_t i=0; i < sizeof(columns) / sizeof(columns[0]); i++) json_array_append_new(column_list, json_string(columns[i]));
+	json_object_set_new(merged, "columns", column_list);
+
+	json_t *row_list = json_array();
+	for (size_t i=0; i < script->count; i++) {
+		struct dbt_script_statement *statement = &script->statements[i];
+		char number[24], text[DBT_SCRIPT_TEXT_WIDTH + 1], rows[24] = "", ms[32] = "";
+
+
+		/* Statement on one line */
+		size_t text_len = 0;
+		for (const char *c = statement->text; *c && text_len < DBT_SCRIPT_TEXT_WIDTH; c++) {
+			if (isspace((unsigned char)*c) && (!text_len || text[text_len-1] == ' ')) continue;
+			text[text_len++] = isspace((unsigned char)*c) ? ' ' : *c;
+		}
+		text[text_len] = 0;
+
+
+		/* Outcome (command tag, first error line, or why it did not run) */
+		const char *status = json_string_value(json_object_get(statement->result, "status"));
+		const char *detail = status ? status : "not run";
+		if (status && !strcmp(status, "ok")) detail = json_string_value(json_object_get(statement->result, "command"));
+		else if (status && !strcmp(status, "error")) detail = json_string_value(json_object_get(statement->result, "error"));
+
+		char detail_line[256];
+		snprintf(detail_line, sizeof(detail_line), "%.*s", (int)strcspn(detail ? detail : "", "\n"), detail ? detail : "");
+
+		json_int_t row_count = json_integer_value(json_object_get(statement->result, "rows"));
+		if (status && !strcmp(status, "ok") && row_count >= 0) snprintf(rows, sizeof(rows), "%lld", (long long)row_count);
+		if (statement->result) snprintf(ms, sizeof(ms), "%.1f", statement->duration_us / 1000.0);
+		snprintf(number, sizeof(number), "%zu", i + 1);
+
+		json_t *row_values = json_array();
+		json_array_append_new(row_values, json_string(number));
+		json_array_append_new(row_values, json_string(text));
+		json_array_append_new(row_values, json_string(detail_line));
+		json_array_append_new(row_values, json_string(rows));
+		json_array_append_new(row_values, json_string(ms));
+		json_array_append_new(row_list, row_values);
+	}
+	json_object_set_new(merged, "rows", row_list);
+
+
+	/* Connection loss fails the whole run */
+	if (script->error) json_object_set_new(merged, "error", json_string(script->error));
+
+
+	return merged;
+}
+
+static void script_render(struct dbt_script *script, struct dbt_session *session) {
+	/* Properties pane belongs to the dashboard while it runs */
+	if (session->dashboard.active) return;
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+
+
+	/* Clear previous content */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Script (%zu statements, %s)", script->count, script->continue_on_error ? "continue on error" : "stop on error");
+
+
+	/* Print progress */
+	int width = getmaxx(win) - 4;
+	mvwprintw(win, 1, 2, "Done      %zu/%zu", script->next_result, script->count);
+	mvwprintw(win, 2, 2, "In flight %zu", script->next_send - script->next_result);
+	mvwprintw(win, 3, 2, "Failed    %zu", script->failed_count);
+	mvwprintw(win, 4, 2, "Elapsed   %.1fs", script_elapsed_us(&script->started) / 1e6);
+
+	if (script->next_result < script->count) {
+		const char *text = script->statements[script->next_result].text;
+		int text_len = (int)strcspn(text, "\n");
+		mvwaddnstr(win, 6, 2, text, text_len < width ? text_len : width);
+	}
+
+
+	/* Refresh window */
+	wrefresh(win);
+}
+
+
+
+
+struct dbt_script *dbt_script_new(const char *text, int continue_on_error, struct dbt_adapter *adapter, void *conn) {
+	/* Check input */
+	if (!text || !adapter || !conn || !adapter->pipeline_send) return 0;
+
+
+	/* Split copy of query buffer into statements */
+	struct dbt_script *script = (struct dbt_script *)calloc(1, sizeof(struct dbt_script));
+	if (!script) return 0;
+
+	script->text = strdup(text);
+	if (!script->text || script_split(script) || !script->count) {
+		dbt_script_free(script);
+		return 0;
+	}
+
+
+	/* Statements are sent by the event loop */
+	script->continue_on_error = continue_on_error;
+	script->adapter = adapter;
+	script->conn_handle = conn;
+	script->events = POLLOUT;
+	clock_gettime(CLOCK_MONOTONIC, &script->started);
+	script->last_result = script->started;
+
+
+	return script;
+}
+
+
+size_t dbt_script_collect_fds(struct dbt_script *script, struct pollfd *fds, size_t max) {
+	/* Check input */
+	if (!script || !fds || !max) return 0;
+
+
+	/* Socket of the tab, writable while statements wait to go out */
+	fds[0].fd = script->adapter->connection_fd(script->conn_handle, script->adapter);
+	fds[0].events = script->events;
+	fds[0].revents = 0;
+
+
+	return 1;
+}
+
+
+int dbt_script_poll(struct dbt_script *script, json_t **result, struct dbt_session *session) {
+	/* Check input */
+	if (!script || !result) return 0;
+
+
+	/* Collect results (one per statement, sync points close groups) */
+	script->events = POLLIN;
+	while (!script->error) {
+		int write_pending = 0;
+		int status = script->adapter->pipeline_poll(script->conn_handle, &write_pending, &script->pending, script->adapter);
+		if (write_pending) script->events |= POLLOUT;
+
+		if (status < 0) script->error = strdup("connection failed");
+		else if (status == 2 && script->pending_syncs) {
+			script->pending_syncs--;
+			script->commit_mark = script->next_result;
+		} else if (status == 1) {
+			if (script->next_result < script->next_send) script_record(script, script->pending);
+			else json_decref(script->pending);
+			script->pending = 0;
+		} else if (status != 2) break;
+	}
+
+
+	/* Queue next statements, show progress */
+	script_send(script);
+	script_render(script, session);
+
+
+	/* Finished once everything sent came back */
+	int idle = !script->pending_syncs && !script->group_open && script->next_result == script->next_send;
+	if (!script->error && (!idle || (script->next_send < script->count && !script->stopping))) return 1;
+
+	/* Leave pipeline mode on every path (a connection stuck with unread results must be reset by its owner) */
+	if (script->adapter->pipeline_end && script->adapter->pipeline_end(script->conn_handle, script->adapter)) script->needs_reset = 1;
+	*result = script_merge(script);
+
+
+	return 0;
+}
+
+
+int dbt_script_cancel(struct dbt_script *script) {
+	/* Check input */
+	if (!script) return 1;
+
+
+	/* Send nothing more, cancel running statement (statements already on the wire still report back) */
+	script->stopping = 1;
+
+
+	return script->adapter->cancel_query(script->conn_handle, script->adapter);
+}
+
+
+void dbt_script_free(struct dbt_script *script) {
+	/* Check input */
+	if (!script) return;
+
+
+	/* Release statement results */
+	for (size_t i=0; i < script->count; i++) json_decref(script->statements[i].result);
+
+	json_decref(script->pending);
+	free(script->statements);
+	free(script->text);
+	free(script->error);
+	free(script);
+}
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "dbt.h"
@@ -24,6 +25,24 @@ static int dbt_session_commit_input(struct dbt_session *session) {
 			return dbt_tables_select(session->input_buffer, session);
 		case DBT_MODE_COLUMN_SELECT:
 			return dbt_columns_select(session->input_buffer, session);
+		case DBT_MODE_HISTORY_SEARCH:
+			return dbt_history_search(session->input_buffer, session);
+		case DBT_MODE_FANOUT_SELECT:
+			return dbt_fanout_execute(session->input_buffer, session);
+		case DBT_MODE_RESULT_SORT:
+			return dbt_results_sort(session->input_buffer, session);
+		case DBT_MODE_RESULT_FILTER:
+			return dbt_results_filter(session->input_buffer, session);
+		case DBT_MODE_RESULT_GROUP:
+			return dbt_results_group(session->input_buffer, session);
+		case DBT_MODE_WATCH_SELECT:
+			return dbt_watch_command(session->input_buffer, session);
+		case DBT_MODE_EXPORT_SELECT:
+			return dbt_export_command(session->input_buffer, session);
+		case DBT_MODE_IMPORT_SELECT:
+			return dbt_import_command(session->input_buffer, session);
+		case DBT_MODE_SNAPSHOT_SELECT:
+			return dbt_snapshot_command(session->input_buffer, session);
 		default:
 			break;
 	}
@@ -31,55 +50,10 @@ static int dbt_session_commit_input(struct dbt_session *session) {
 	return 0;
 }
 
-static int dbt_session_commit_query(struct dbt_session *session) {
-	/* Perform query */
-	const char *query = session->q_buffers[session->q_buffer_ind];
-	json_t *result = session->adapter_handle.perform_query(query, &session->adapter_handle);
-	if (!json_is_object(result)) return 1;
-
-
-	/* Clear previous result */
-	wclear(session->app_windows[DBT_WIN_RESULT]);
-	box(session->app_windows[DBT_WIN_RESULT], 0, 0);
-	mvwprintw(session->app_windows[DBT_WIN_RESULT], 0, 2, "Result (1/7)");
-
-
-	/* Print columns */
-	json_t *column_list = json_object_get(result, "columns");
-	size_t column_count = json_array_size(column_list);
-	wmove(session->app_windows[DBT_WIN_RESULT], 2, 2);
-	
-	for (size_t i=0; i < column_count; i++) {
-		const char *col_name = json_string_value(json_array_get(column_list, i));
-		wprintw(session->app_windows[DBT_WIN_RESULT], "\t%s\t", col_name);
-	}
-
-
-	/* Print separator row */
-	int maxX = getmaxx(session->app_windows[DBT_WIN_RESULT]);
-	for (size_t i=1; i < maxX-1; i++) mvwprintw(session->app_windows[DBT_WIN_RESULT], 3, i, "+");
-
-
-	/* Print rows */
-	json_t *row_list = json_object_get(result, "rows");
-	size_t row_count = json_array_size(row_list);
-
-	for (size_t i=0; i < row_count; i++) {
-		wmove(session->app_windows[DBT_WIN_RESULT], 4+i, 2);
-
-		json_t *row_values = json_array_get(row_list, i);
-		for (size_t j=0; j < column_count; j++) {
-			const char *cell_value = json_string_value(json_array_get(row_values, j));
-			wprintw(session->app_windows[DBT_WIN_RESULT], "\t%s\t", cell_value);
-		}	
-	}
-
-
-	/* Refresh output */
-	wrefresh(session->app_windows[DBT_WIN_RESULT]);
-
-
-	return 0;
+static void dbt_session_restore_cursor(struct dbt_session *session) {
+	/* Put cursor back where the user is typing */
+	if (session->mode == DBT_MODE_QUERY) wrefresh(session->app_windows[DBT_WIN_QUERY]);
+	else refresh();
 }
 
 
@@ -96,36 +70,136 @@ int dbt_session_handle_input(int input, struct dbt_session *session) {
 			case 'S':
 				/* Enter server mode */
 				session->mode = DBT_MODE_SERVER_SELECT;
+				dbt_list_focus(DBT_WIN_SERVERS, session);
 				break;
 			case 'd':
 				/* Enter database mode */
 				session->mode = DBT_MODE_DATABASE_SELECT;
+				dbt_list_focus(DBT_WIN_DATABASES, session);
 				break;
 			case 's':
 				/* Enter schema mode */
 				session->mode = DBT_MODE_SCHEMA_SELECT;
+				dbt_list_focus(DBT_WIN_SCHEMAS, session);
 				break;
 			case 't':
 				/* Enter table mode */
 				session->mode = DBT_MODE_TABLEVIEW_SELECT;
+				dbt_list_focus(DBT_WIN_TABLESVIEWS, session);
 				break;
 			case 'c':
 				/* Enter column mode */
 				session->mode = DBT_MODE_COLUMN_SELECT;
+				dbt_list_focus(DBT_WIN_COLUMNS, session);
 				break;
 			case 'i':
 				/* Enter query mode */
 				session->mode = DBT_MODE_QUERY;
 				break;
+			case 'H':
+				/* Enter history search mode */
+				session->mode = DBT_MODE_HISTORY_SEARCH;
+				break;
+			case 'F':
+				/* Enter fan-out mode (runs current query on matching servers) */
+				session->mode = DBT_MODE_FANOUT_SELECT;
+				break;
+			case 'o':
+				/* Enter result sort mode */
+				session->mode = DBT_MODE_RESULT_SORT;
+				break;
+			case 'f':
+				/* Enter result filter mode */
+				session->mode = DBT_MODE_RESULT_FILTER;
+				break;
+			case 'g':
+				/* Enter result group mode */
+				session->mode = DBT_MODE_RESULT_GROUP;
+				break;
+			case 'W':
+				/* Enter catalog watch mode (notify, poll, install or off) */
+				session->mode = DBT_MODE_WATCH_SELECT;
+				break;
+			case 'j':
+			case 'k':
+				/* Move cursor in focused list pane */
+				dbt_list_scroll(input == 'j' ? 1 : -1, session);
+				break;
+			case 'J':
+			case 'K':
+				/* Page through focused list pane */
+				dbt_list_page(input == 'J' ? 1 : -1, session);
+				break;
+			case '\t':
+				/* Focus next list pane (servers to columns) */
+				dbt_list_focus(session->list_focus < DBT_WIN_COLUMNS ? session->list_focus + 1 : DBT_WIN_SERVERS, session);
+				break;
+			case 13:
+				/* Select entry under cursor of focused list pane */
+				dbt_list_activate(session);
+				break;
+			case 'x':
+				/* Enter export mode (current table, parallel ranges in one snapshot) */
+				session->mode = DBT_MODE_EXPORT_SELECT;
+				break;
+			case 'I':
+				/* Enter import mode (file into current table through COPY) */
+				session->mode = DBT_MODE_IMPORT_SELECT;
+				break;
+			case 'Z':
+				/* Enter snapshot mode (save, load or diff current result by key columns) */
+				session->mode = DBT_MODE_SNAPSHOT_SELECT;
+				break;
+			case 'n':
+				/* Next result page */
+				dbt_results_scroll(1, session);
+				break;
+			case 'p':
+				/* Previous result page */
+				dbt_results_scroll(-1, session);
+				break;
+			case 'A':
+				/* Toggle server activity dashboard in properties window */
+				dbt_dashboard_toggle(session);
+				break;
+			case 'P':
+				/* Toggle streaming profile of current tab's query in properties window */
+				dbt_profile_toggle(session);
+				break;
+			case 'M':
+				/* Toggle live memory counters in properties window */
+				dbt_memory_toggle(session);
+				break;
+			case 'R':
+				/* Run query of current tab as a script (statements pipelined, one result row each) */
+				dbt_tabs_script(session);
+				break;
+			case 'E':
+				/* Explain query of current tab in background (analyzed when it only reads) */
+				dbt_tabs_explain(session);
+				break;
+			case 'm':
+				/* Fetch next batch of a result stopped at the row limit */
+				dbt_tabs_fetch_more(session);
+				break;
+			case 'X':
+				/* Cancel query running in current tab */
+				dbt_tabs_cancel(session);
+				break;
+			case '1': case '2': case '3': case '4': case '5': case '6': case '7':
+				/* Switch query/result tab */
+				dbt_tabs_select(input - '1', session);
+				break;
 		}
 
 
 		/* Check if mode changed */
 		if (session->mode == DBT_MODE_QUERY) {	
 			/* Init query buffer (TODO: improve) */
-			if (!session->q_buffers[session->q_buffer_ind]) {
-				session->q_buffers[session->q_buffer_ind] = (char *)calloc(4096, sizeof(char));
-				session->q_buffer_head = 0;
+			struct dbt_tab *tab = &session->tabs[session->tab_ind];
+			if (!tab->q_buffer) {
+				tab->q_buffer = (char *)calloc(4096, sizeof(char));
+				tab->q_buffer_head = 0;
 			}
 
 
@@ -133,9 +207,8 @@ int dbt_session_handle_input(int input, struct dbt_session *session) {
 			curs_set(1);
 
 
-			/* Move cursor to query window */
-			wmove(session->app_windows[DBT_WIN_QUERY], 1, 2);
-			wrefresh(session->app_windows[DBT_WIN_QUERY]);
+			/* Move cursor to end of query */
+			dbt_session_refresh_query(session);
 		} else if (session->mode != DBT_MODE_NORMAL) {
 			/* Set input prompt */
 			switch (session->mode) {
@@ -154,6 +227,33 @@ int dbt_session_handle_input(int input, struct dbt_session *session) {
 				case DBT_MODE_COLUMN_SELECT:
 					printw("Column: ");
 					break;
+				case DBT_MODE_HISTORY_SEARCH:
+					printw("History: ");
+					break;
+				case DBT_MODE_FANOUT_SELECT:
+					printw("Fan-out: ");
+					break;
+				case DBT_MODE_RESULT_SORT:
+					printw("Sort: ");
+					break;
+				case DBT_MODE_RESULT_FILTER:
+					printw("Filter: ");
+					break;
+				case DBT_MODE_RESULT_GROUP:
+					printw("Group: ");
+					break;
+				case DBT_MODE_WATCH_SELECT:
+					printw("Watch: ");
+					break;
+				case DBT_MODE_EXPORT_SELECT:
+					printw("Export: ");
+					break;
+				case DBT_MODE_IMPORT_SELECT:
+					printw("Import: ");
+					break;
+				case DBT_MODE_SNAPSHOT_SELECT:
+					printw("Snapshot: ");
+					break;
 				default:
 					break;
 			}
@@ -170,15 +270,18 @@ int dbt_session_handle_input(int input, struct dbt_session *session) {
 
 	/* Handle input for query mode */
 	if (session->mode == DBT_MODE_QUERY) {
+		struct dbt_tab *tab = &session->tabs[session->tab_ind];
+		dbt_complete_clear(session);
 		if (input == CTRL(13)) {
-			/* Commit (CTRL + ENTER) */
-			dbt_session_commit_query(session);
+			/* Commit (CTRL + ENTER), runs in background */
+			dbt_tabs_execute(session);
+			dbt_session_restore_cursor(session);
 
 			return 0;
 		} else if (input == 8 || input == 127) {
 			/* Backspace */
-			if (session->q_buffer_head <= 0) return 0;
-			session->q_buffers[session->q_buffer_ind][--session->q_buffer_head] = 0;
+			if (tab->q_buffer_head <= 0) return 0;
+			tab->q_buffer[--tab->q_buffer_head] = 0;
 
 			
 			/* Move to previous character */
@@ -192,6 +295,11 @@ int dbt_session_handle_input(int input, struct dbt_session *session) {
 			wmove(session->app_windows[DBT_WIN_QUERY], cur_y, cur_x-1);
 			wrefresh(session->app_windows[DBT_WIN_QUERY]);
 
+			return 0;
+		} else if (input == '\t') {
+			/* Complete keyword, table or column from cached catalog */
+			dbt_complete_query(session);
+
 			return 0;
 		} else if (input < ' ' || input > '~') {
 			/* Out of range of supported ascii characters */
@@ -200,8 +308,8 @@ int dbt_session_handle_input(int input, struct dbt_session *session) {
 
 
 		/* Append to buffer (TODO: auto-newline, realloc, etc) */
-		if (session->q_buffer_head >= 4095) return 0;
-		session->q_buffers[session->q_buffer_ind][session->q_buffer_head++] = (char)input;
+		if (tab->q_buffer_head >= 4095) return 0;
+		tab->q_buffer[tab->q_buffer_head++] = (char)input;
 
 
 		/* Print */
@@ -277,9 +385,102 @@ int dbt_session_handle_input(int input, struct dbt_session *session) {
 }
 
 
+int dbt_session_refresh_query(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	const char *query = session->tabs[session->tab_ind].q_buffer;
+
+
+	/* Redraw query window */
+	WINDOW *win = session->app_windows[DBT_WIN_QUERY];
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Query (%d/%d)", session->tab_ind + 1, DBT_TAB_MAX);
+
+
+	/* Print tab strip (~ running, + unseen result, ! failed) */
+	wprintw(win, " ");
+	for (size_t i=0; i < DBT_TAB_MAX; i++) {
+		struct dbt_tab *tab = &session->tabs[i];
+		char marker = ' ';
+		if (tab->state == DBT_TAB_RUNNING) marker = '~';
+		else if (tab->state == DBT_TAB_FAILED) marker = '!';
+		else if (tab->unseen) marker = '+';
+
+		wprintw(win, "%s%zu%c", i == session->tab_ind ? "[" : " ", i+1, i == session->tab_ind ? ']' : marker);
+	}
+
+
+	/* Print connection status of current tab (catalog connection until the tab has its own) */
+	char status[64];
+	struct dbt_tab *current = &session->tabs[session->tab_ind];
+	if (current->conn_handle) {
+		dbt_supervisor_describe(&current->link, status, sizeof(status));
+		wprintw(win, " %s ", status);
+	} else if (session->adapter_handle.db_conn_handle) {
+		dbt_supervisor_describe(&session->link, status, sizeof(status));
+		wprintw(win, " catalog %s ", status);
+	} else if (session->adapter_handle.connect_error[0]) {
+		wprintw(win, " %.60s ", session->adapter_handle.connect_error);
+	}
+
+
+	/* Print query, leaving cursor at its end */
+	wmove(win, 1, 2);
+	if (query) wprintw(win, "%s", query);
+	wrefresh(win);
+
+
+	return 0;
+}
+
+
+int dbt_session_poll(int timeout, struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 0;
+
+
+	/* Watch keyboard plus sockets of background work */
+	struct pollfd fds[DBT_POLL_MAX];
+	fds[0].fd = 0;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+
+	size_t fd_count = 1;
+	fd_count += dbt_tabs_collect_fds(fds + fd_count, DBT_POLL_MAX - fd_count, session);
+	fd_count += dbt_watch_collect_fds(fds + fd_count, DBT_POLL_MAX - fd_count, session);
+	fd_count += dbt_dashboard_collect_fds(fds + fd_count, DBT_POLL_MAX - fd_count, session);
+	fd_count += dbt_export_collect_fds(fds + fd_count, DBT_POLL_MAX - fd_count, session);
+	fd_count += dbt_import_collect_fds(fds + fd_count, DBT_POLL_MAX - fd_count, session);
+	fd_count += dbt_properties_collect_fds(fds + fd_count, DBT_POLL_MAX - fd_count, session);
+	fd_count += dbt_supervisor_collect_fds(fds + fd_count, DBT_POLL_MAX - fd_count, session);
+
+
+	/* Wait for input or timeout */
+	if (poll(fds, fd_count, timeout) < 0) return 0;
+
+
+	/* Advance background work */
+	int changed = dbt_tabs_service(session);
+	changed |= dbt_watch_service(session);
+	changed |= dbt_dashboard_service(session);
+	changed |= dbt_export_service(session);
+	changed |= dbt_import_service(session);
+	changed |= dbt_profile_service(session);
+	changed |= dbt_properties_service(session);
+	changed |= dbt_supervisor_service(session);
+	changed |= dbt_memory_service(session);
+	if (changed) dbt_session_restore_cursor(session);
+
+
+	return (fds[0].revents & POLLIN) != 0;
+}
+
+
 int dbt_session_init(const char *config_path, struct dbt_session *session) {
 	/* Check input */
 	if (!session) return 1;
+	memset(session, 0, sizeof(*session));
 
 
 	/* Generate windows */
@@ -290,12 +491,13 @@ int dbt_session_init(const char *config_path, struct dbt_session *session) {
 	session->app_windows[DBT_WIN_COLUMNS] = dbt_generate_window(LINES-1, 50, 0, 30, "Columns");
 	session->app_windows[DBT_WIN_PROPERTIES] = dbt_generate_window(30, 40, 0, 80, "Properties");
 	session->app_windows[DBT_WIN_QUERY] = dbt_generate_window(30, COLS-120, 0, 120, "Query (1/7)");
-	session->app_windows[DBT_WIN_RESULT] = dbt_generate_window(LINES-31, COLS-80, 30, 80, "Results (1/7)");
+	session->app_windows[DBT_WIN_RESULT] = dbt_generate_window(LINES-31, COLS-80, 30, 80, "Result (1/7)");
 
 
-	/* Refresh windows (display) */
+	/* Draw frame with a single terminal update, before config is touched */
 	size_t window_count = sizeof(session->app_windows) / sizeof(WINDOW *);
-	for (size_t i=0; i < window_count; i++) wrefresh(session->app_windows[i]);
+	for (size_t i=0; i < window_count; i++) wnoutrefresh(session->app_windows[i]);
+	doupdate();
 
 
 	/* Put session to 'normal' mode */
@@ -320,31 +522,21 @@ int dbt_session_init(const char *config_path, struct dbt_session *session) {
 	}
 
 
-	/* Load config file */
-	FILE *config_file = fopen(final_config_path, "r");
-	if (!config_file) return 1;
+	/* Open config (server list comes from its cache, full parse is deferred to first use) */
+	int config_failed = dbt_config_open(final_config_path, &session->config);
 	if (!config_path) free(final_config_path);
-
-
-	/* Parse config file */
-	session->config = json_loadf(config_file, 1, 0);
-	fclose(config_file);
-	if (!session->config) return 1;
+	if (config_failed) return 1;
 
 
 	/* Init input buffer */
 	session->input_buffer[0] = 0;
 	session->buffer_head = 0;
 
-	session->q_buffers[0] = 0;
-	session->q_buffers[1] = 0;
-	session->q_buffers[2] = 0;
-	session->q_buffers[3] = 0;
-	session->q_buffers[4] = 0;
-	session->q_buffers[5] = 0;
-	session->q_buffers[6] = 0;
-	session->q_buffer_head = 0;
-	session->q_buffer_ind = 0;
+	session->tab_ind = 0;
+
+
+	/* Load query history (optional) */
+	dbt_history_load(session);
 
 
 	/* Put cursor to resting position (and hide) */
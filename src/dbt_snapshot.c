@@ -0,0 +1,596 @@
+#include <fcntl.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_SNAPSHOT_MAGIC "DBTSNP02"
+#define DBT_SNAPSHOT_MAGIC_V1 "DBTSNP01"
+#define DBT_SNAPSHOT_MAX_KEYS 16
+#define DBT_SNAPSHOT_WRITE_BUFFER (1 << 20)
+
+
+/* File layout: header, column directory, then name, null bitmap and data of each column (sections 8-byte aligned, offsets from file start) */
+struct dbt_snapshot_header {
+	char magic[8];
+	uint64_t column_count;
+	uint64_t row_count;
+};
+struct dbt_snapshot_column {
+	uint64_t name_offset;
+	uint64_t is_numeric;
+
+	/* Plain columns hold NUL terminated values in row order (code width 0), dictionary columns hold codes and NUL terminated entries */
+	uint64_t code_width;
+	uint64_t data_offset;
+	uint64_t data_size;
+	uint64_t dictionary_offset;
+	uint64_t dictionary_size;
+	uint64_t dictionary_count;
+
+	/* Bit per row set for NULL (0 when no row is NULL, version 1 files end the entry before it) */
+	uint64_t nulls_offset;
+};
+
+
+/* Scratch for dictionary detection (shared by all columns of a save) */
+struct dbt_snapshot_dictionary {
+	size_t capacity;
+	uint32_t *slots;
+	uint32_t *entry_rows;
+	uint32_t *codes;
+};
+
+
+/* Helper functions */
+static uint64_t snapshot_elapsed_us(const struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) * 1000000ull + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static void snapshot_format_bytes(char *out, size_t out_size, double bytes) {
+	const char *units[] = { "B", "kB", "MB", "GB", "TB" };
+	size_t unit = 0;
+	while (bytes >= 1024 && unit < 4) {
+		bytes /= 1024;
+		unit++;
+	}
+
+	snprintf(out, out_size, unit ? "%.1f %s" : "%.0f %s", bytes, units[unit]);
+}
+
+static uint64_t snapshot_hash(const char *value, uint32_t length) {
+	/* FNV-1a */
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (uint32_t i=0; i < length; i++) {
+		hash ^= (unsigned char)value[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
+
+static int snapshot_write(FILE *file, const void *data, size_t size, uint64_t *offset) {
+	if (size && fwrite(data, size, 1, file) != 1) return 1;
+	*offset += size;
+
+	return 0;
+}
+
+static int snapshot_align(FILE *file, uint64_t *offset) {
+	/* Pad to the next section boundary */
+	static const char padding[8] = {0};
+	return snapshot_write(file, padding, (8 - *offset % 8) % 8, offset);
+}
+
+static int snapshot_encode_column(FILE *file, const struct dbt_resultset *resultset, size_t j, struct dbt_snapshot_dictionary *dictionary, struct dbt_snapshot_column *entry, uint64_t *offset) {
+	const struct dbt_resultset_column *column = &resultset->columns[j];
+	size_t count = resultset->view_count, mask = dictionary->capacity - 1;
+
+
+	/* Code visible rows by distinct value (first-seen order) and measure both encodings */
+	memset(dictionary->slots, 0xff, dictionary->capacity * sizeof(uint32_t));
+	size_t plain_size = 0, dictionary_size = 0, entry_count = 0;
+	for (size_t i=0; i < count; i++) {
+		uint32_t row = resultset->view[i];
+		const char *value = column->values[row];
+		uint32_t length = column->lengths[row];
+		plain_size += length + 1;
+
+		size_t slot = snapshot_hash(value, length) & mask;
+		while (dictionary->slots[slot] != UINT32_MAX) {
+			uint32_t other = dictionary->entry_rows[dictionary->slots[slot]];
+			if (column->lengths[other] == length && !memcmp(column->values[other], value, length)) break;
+			slot = (slot + 1) & mask;
+		}
+
+		if (dictionary->slots[slot] == UINT32_MAX) {
+			dictionary->slots[slot] = (uint32_t)entry_count;
+			dictionary->entry_rows[entry_count++] = row;
+			dictionary_size += length + 1;
+		}
+		dictionary->codes[i] = dictionary->slots[slot];
+	}
+
+	size_t code_width = entry_count <= 256 ? 1 : entry_count <= 65536 ? 2 : 4;
+	int use_dictionary = dictionary_size + count * code_width < plain_size;
+
+
+	/* Name */
+	entry->is_numeric = column->is_numeric;
+	entry->name_offset = *offset;
+	if (snapshot_write(file, column->name, strlen(column->name) + 1, offset) || snapshot_align(file, offset)) return 1;
+
+
+	/* Null bitmap in visible row order */
+	uint8_t *nulls = (uint8_t *)calloc(count / 8 + 1, sizeof(uint8_t));
+	if (!nulls) return 1;
+
+	int has_nulls = 0;
+	for (size_t i=0; i < count; i++) {
+		int null = DBT_RESULTSET_NULL(column, resultset->view[i]);
+		nulls[i >> 3] |= (uint8_t)(null << (i & 7));
+		has_nulls |= null;
+	}
+
+	entry->nulls_offset = has_nulls ? *offset : 0;
+	int failed = has_nulls && (snapshot_write(file, nulls, count / 8 + 1, offset) || snapshot_align(file, offset));
+	free(nulls);
+	if (failed) return 1;
+
+
+	/* Plain values (already NUL terminated in memory) */
+	entry->data_offset = *offset;
+	if (!use_dictionary) {
+		for (size_t i=0; i < count; i++) {
+			uint32_t row = resultset->view[i];
+			if (snapshot_write(file, column->values[row], column->lengths[row] + 1, offset)) return 1;
+		}
+		entry->data_size = plain_size;
+
+		return snapshot_align(file, offset);
+	}
+
+
+	/* Codes narrowed in place to the smallest width holding every entry, then entries */
+	unsigned char *packed = (unsigned char *)dictionary->codes;
+	for (size_t i=0; code_width < 4 && i < count; i++) {
+		uint32_t code = dictionary->codes[i];
+		if (code_width == 1) packed[i] = (unsigned char)code;
+		else {
+			uint16_t narrow = (uint16_t)code;
+			memcpy(packed + i * 2, &narrow, 2);
+		}
+	}
+
+	entry->code_width = code_width;
+	entry->data_size = count * code_width;
+	if (snapshot_write(file, packed, count * code_width, offset) || snapshot_align(file, offset)) return 1;
+
+	entry->dictionary_offset = *offset;
+	entry->dictionary_size = dictionary_size;
+	entry->dictionary_count = entry_count;
+	for (size_t k=0; k < entry_count; k++) {
+		uint32_t row = dictionary->entry_rows[k];
+		if (snapshot_write(file, column->values[row], column->lengths[row] + 1, offset)) return 1;
+	}
+
+
+	return snapshot_align(file, offset);
+}
+
+static const char *snapshot_section(const struct dbt_resultset *resultset, uint64_t offset, uint64_t size) {
+	/* Section inside the mapping (or null) */
+	if (offset > resultset->mapping_size || size > resultset->mapping_size - offset) return 0;
+	return (const char *)resultset->mapping + offset;
+}
+
+static int snapshot_split(const char *data, size_t size, size_t count, const char **values, uint32_t *lengths) {
+	/* Point at count NUL terminated strings, fails if section ends early */
+	const char *cursor = data, *end = data + size;
+	for (size_t i=0; i < count; i++) {
+		const char *terminator = (const char *)memchr(cursor, 0, end - cursor);
+		if (!terminator || terminator - cursor > UINT32_MAX) return 1;
+
+		values[i] = cursor;
+		lengths[i] = (uint32_t)(terminator - cursor);
+		cursor = terminator + 1;
+	}
+
+	return 0;
+}
+
+static double snapshot_number(const char *value, uint32_t length) {
+	/* Empty or non-numeric values (NaN) sort last */
+	char *end;
+	double number = length ? strtod(value, &end) : NAN;
+	return length && !*end && end != value ? number : NAN;
+}
+
+static int snapshot_decode_column(struct dbt_resultset *resultset, size_t j, const struct dbt_snapshot_column *entry) {
+	struct dbt_resultset_column *column = &resultset->columns[j];
+	size_t count = resultset->row_count;
+
+
+	/* Name */
+	const char *name = snapshot_section(resultset, entry->name_offset, 1);
+	if (!name || !memchr(name, 0, resultset->mapping_size - entry->name_offset)) return 1;
+	column->name = strdup(name);
+	column->is_numeric = entry->is_numeric != 0;
+
+	const char *data = snapshot_section(resultset, entry->data_offset, entry->data_size);
+	if (!column->name || !data) return 1;
+
+
+	/* Null bitmap is copied (values of NULL cells are empty) */
+	if (entry->nulls_offset) {
+		const char *nulls = snapshot_section(resultset, entry->nulls_offset, count / 8 + 1);
+		if (!nulls) return 1;
+		memcpy(column->nulls, nulls, count / 8 + 1);
+	}
+
+
+	/* Plain values are used in place */
+	if (!entry->code_width) {
+		if (snapshot_split(data, entry->data_size, count, column->values, column->lengths)) return 1;
+		for (size_t i=0; i < count; i++) column->numbers[i] = column->is_numeric ? snapshot_number(column->values[i], column->lengths[i]) : NAN;
+
+		return 0;
+	}
+
+
+	/* Dictionary entries are used in place too, numbers parsed once per entry */
+	const char *entry_data = snapshot_section(resultset, entry->dictionary_offset, entry->dictionary_size);
+	if (!entry_data || (entry->code_width != 1 && entry->code_width != 2 && entry->code_width != 4)) return 1;
+	else if (entry->data_size != count * entry->code_width || entry->dictionary_count > entry->dictionary_size) return 1;
+
+	size_t entry_count = entry->dictionary_count;
+	const char **entries = (const char **)malloc((entry_count ? entry_count : 1) * sizeof(const char *));
+	uint32_t *entry_lengths = (uint32_t *)malloc((entry_count ? entry_count : 1) * sizeof(uint32_t));
+	double *entry_numbers = (double *)malloc((entry_count ? entry_count : 1) * sizeof(double));
+	int failed = !entries || !entry_lengths || !entry_numbers || snapshot_split(entry_data, entry->dictionary_size, entry_count, entries, entry_lengths);
+
+	for (size_t k=0; !failed && k < entry_count; k++) entry_numbers[k] = column->is_numeric ? snapshot_number(entries[k], entry_lengths[k]) : NAN;
+	for (size_t i=0; !failed && i < count; i++) {
+		uint32_t code = 0;
+		if (entry->code_width == 1) code = (unsigned char)data[i];
+		else if (entry->code_width == 2) {
+			uint16_t narrow;
+			memcpy(&narrow, data + i * 2, 2);
+			code = narrow;
+		} else memcpy(&code, data + i * 4, 4);
+
+		if (code >= entry_count) {
+			failed = 1;
+			break;
+		}
+		column->values[i] = entries[code];
+		column->lengths[i] = entry_lengths[code];
+		column->numbers[i] = entry_numbers[code];
+	}
+
+	free(entries);
+	free(entry_lengths);
+	free(entry_numbers);
+
+
+	return failed;
+}
+
+static void snapshot_render(struct dbt_session *session, const char *state, char lines[][256], size_t line_count) {
+	WINDOW *win = session->app_windows[DBT_WIN_PROPERTIES];
+
+
+	/* Properties pane belongs to the dashboard while it runs */
+	if (session->dashboard.active) return;
+
+
+	/* Clear previous content */
+	wclear(win);
+	box(win, 0, 0);
+	mvwprintw(win, 0, 2, "Snapshot (%s)", state);
+
+
+	/* Print lines as long as they fit */
+	int width = getmaxx(win) - 4;
+	for (size_t i=0; i < line_count && (int)i + 1 < getmaxy(win) - 1; i++) mvwaddnstr(win, i + 1, 2, lines[i], width);
+
+
+	/* Refresh window */
+	wrefresh(win);
+}
+
+static int snapshot_save_command(const char *path, struct dbt_session *session) {
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->resultset || tab->state == DBT_TAB_RUNNING || !path[0]) return 1;
+
+
+	/* Write visible rows (sort and filter apply) */
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+
+	char lines[4][256];
+	size_t bytes = 0;
+	if (dbt_snapshot_save(tab->resultset, path, &bytes)) {
+		snprintf(lines[0], sizeof(lines[0]), "Cannot write %s", path);
+		snapshot_render(session, "failed", lines, 1);
+		return 1;
+	}
+
+
+	/* Compare with the text it holds */
+	size_t text_bytes = 0;
+	for (size_t j=0; j < tab->resultset->column_count; j++) {
+		for (size_t i=0; i < tab->resultset->view_count; i++) text_bytes += tab->resultset->columns[j].lengths[tab->resultset->view[i]] + 1;
+	}
+
+	char size[32];
+	snapshot_format_bytes(size, sizeof(size), bytes);
+	snprintf(lines[0], sizeof(lines[0]), "%s", path);
+	snprintf(lines[1], sizeof(lines[1]), "Rows      %zu, %zu columns", tab->resultset->view_count, tab->resultset->column_count);
+	snprintf(lines[2], sizeof(lines[2]), "Size      %s (%.0f%% of values)", size, text_bytes ? 100.0 * bytes / text_bytes : 0);
+	snprintf(lines[3], sizeof(lines[3]), "Time      %.1fms", snapshot_elapsed_us(&started) / 1000.0);
+	snapshot_render(session, "saved", lines, 4);
+
+
+	return 0;
+}
+
+static int snapshot_load_command(const char *path, struct dbt_session *session) {
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (tab->state == DBT_TAB_RUNNING || !path[0]) return 1;
+
+
+	/* Map snapshot */
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+
+	char lines[3][256];
+	struct dbt_resultset *resultset = dbt_snapshot_load(path);
+	if (!resultset) {
+		snprintf(lines[0], sizeof(lines[0]), "Cannot read %s", path);
+		snapshot_render(session, "failed", lines, 1);
+		return 1;
+	}
+
+
+	/* Loaded rows replace the tab's result (no query behind them, nothing left to fetch) */
+	dbt_resultset_free(tab->resultset);
+	tab->resultset = resultset;
+	json_decref(tab->result);
+	tab->result = 0;
+	tab->plan = 0;
+	tab->more = 0;
+	tab->partial = 0;
+	tab->state = DBT_TAB_DONE;
+	tab->duration_us = snapshot_elapsed_us(&started);
+	dbt_results_refresh(session);
+
+	snprintf(lines[0], sizeof(lines[0]), "%s", path);
+	snprintf(lines[1], sizeof(lines[1]), "Rows      %zu, %zu columns", resultset->row_count, resultset->column_count);
+	snprintf(lines[2], sizeof(lines[2]), "Time      %.1fms", tab->duration_us / 1000.0);
+	snapshot_render(session, "loaded", lines, 3);
+
+
+	return 0;
+}
+
+static int snapshot_diff_command(const char *input, struct dbt_session *session) {
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->resultset || tab->state == DBT_TAB_RUNNING) return 1;
+
+
+	/* Parse '<tab number or snapshot path> <key>[,<key>...]' */
+	size_t source_len = strcspn(input, " ");
+	const char *key_list = input + source_len + strspn(input + source_len, " ");
+	if (!source_len || source_len >= 4096 || !key_list[0]) return 1;
+
+	char source[4096];
+	memcpy(source, input, source_len);
+	source[source_len] = 0;
+
+	size_t keys[DBT_SNAPSHOT_MAX_KEYS], key_count = 0;
+	const char *key = key_list;
+	while (*(key += strspn(key, ", "))) {
+		char name[64];
+		size_t name_len = strcspn(key, ", ");
+		if (name_len >= sizeof(name) || key_count == DBT_SNAPSHOT_MAX_KEYS) return 1;
+		memcpy(name, key, name_len);
+		name[name_len] = 0;
+
+		if (dbt_resultset_find_column(tab->resultset, name, &keys[key_count++])) return 1;
+		key += name_len;
+	}
+
+
+	/* Compare with another tab's rows or a snapshot */
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+
+	char *end;
+	long tab_number = strtol(source, &end, 10);
+	int from_tab = !*end && tab_number >= 1 && tab_number <= DBT_TAB_MAX;
+	struct dbt_resultset *loaded = 0, *previous = 0;
+	if (from_tab) previous = tab_number - 1 != session->tab_ind ? session->tabs[tab_number - 1].resultset : 0;
+	else previous = loaded = dbt_snapshot_load(source);
+
+	char lines[7][256];
+	struct dbt_resultset_diff_counts counts;
+	struct dbt_resultset *diff = previous ? dbt_resultset_diff(tab->resultset, previous, keys, key_count, &counts) : 0;
+	dbt_resultset_free(loaded);
+	if (!diff) {
+		if (previous) snprintf(lines[0], sizeof(lines[0]), "Keys %s not in both results", key_list);
+		else snprintf(lines[0], sizeof(lines[0]), "No rows in %s%.200s", from_tab ? "tab " : "", source);
+		snapshot_render(session, "failed", lines, 1);
+		return 1;
+	}
+
+
+	/* Show differences in place of the rows (empty command returns to them) */
+	tab->resultset = diff;
+	dbt_results_refresh(session);
+
+	snprintf(lines[0], sizeof(lines[0]), "%s%.200s vs current rows", from_tab ? "tab " : "", source);
+	snprintf(lines[1], sizeof(lines[1]), "Keys      %s", key_list);
+	snprintf(lines[2], sizeof(lines[2]), "Added     %zu", counts.added);
+	snprintf(lines[3], sizeof(lines[3]), "Removed   %zu", counts.removed);
+	snprintf(lines[4], sizeof(lines[4]), "Changed   %zu", counts.changed);
+	snprintf(lines[5], sizeof(lines[5]), "Unchanged %zu", counts.unchanged);
+	snprintf(lines[6], sizeof(lines[6]), "Time      %.1fms", snapshot_elapsed_us(&started) / 1000.0);
+	snapshot_render(session, "diff", lines, 7);
+
+
+	return 0;
+}
+
+
+
+
+int dbt_snapshot_save(const struct dbt_resultset *resultset, const char *path, size_t *bytes) {
+	/* Check input */
+	if (!resultset || !path || !path[0]) return 1;
+
+
+	/* Write next to the target, renamed over it once complete (a failed save keeps the previous snapshot) */
+	char temp_path[4096];
+	if (snprintf(temp_path, sizeof(temp_path), "%s.tmp", path) >= (int)sizeof(temp_path)) return 1;
+
+	FILE *file = fopen(temp_path, "wb");
+	if (!file) return 1;
+	setvbuf(file, 0, _IOFBF, DBT_SNAPSHOT_WRITE_BUFFER);
+
+
+	/* Prepare dictionary scratch (power of two, at most half full) and directory */
+	struct dbt_snapshot_dictionary dictionary = {0};
+	dictionary.capacity = 16;
+	while (dictionary.capacity < resultset->view_count * 2) dictionary.capacity <<= 1;
+	dictionary.slots = (uint32_t *)malloc(dictionary.capacity * sizeof(uint32_t));
+	dictionary.entry_rows = (uint32_t *)malloc((resultset->view_count ? resultset->view_count : 1) * sizeof(uint32_t));
+	dictionary.codes = (uint32_t *)malloc((resultset->view_count ? resultset->view_count : 1) * sizeof(uint32_t));
+	struct dbt_snapshot_column *directory = (struct dbt_snapshot_column *)calloc(resultset->column_count ? resultset->column_count : 1, sizeof(struct dbt_snapshot_column));
+
+
+	/* Header and directory are written again once sections are placed */
+	struct dbt_snapshot_header header = {0};
+	memcpy(header.magic, DBT_SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.column_count = resultset->column_count;
+	header.row_count = resultset->view_count;
+
+	uint64_t offset = 0;
+	int failed = !dictionary.slots || !dictionary.entry_rows || !dictionary.codes || !directory;
+	failed = failed || snapshot_write(file, &header, sizeof(header), &offset) || snapshot_write(file, directory, resultset->column_count * sizeof(struct dbt_snapshot_column), &offset);
+	for (size_t j=0; !failed && j < resultset->column_count; j++) failed = snapshot_encode_column(file, resultset, j, &dictionary, &directory[j], &offset);
+
+	uint64_t size = offset;
+	failed = failed || fseek(file, 0, SEEK_SET);
+	failed = failed || snapshot_write(file, &header, sizeof(header), &offset) || snapshot_write(file, directory, resultset->column_count * sizeof(struct dbt_snapshot_column), &offset);
+	failed |= fclose(file) != 0;
+
+	free(dictionary.slots);
+	free(dictionary.entry_rows);
+	free(dictionary.codes);
+	free(directory);
+
+
+	/* Replace target */
+	if (failed || rename(temp_path, path)) {
+		unlink(temp_path);
+		return 1;
+	}
+	if (bytes) *bytes = size;
+
+
+	return 0;
+}
+
+
+struct dbt_resultset *dbt_snapshot_load(const char *path) {
+	/* Check input */
+	if (!path || !path[0]) return 0;
+
+
+	/* Map whole file read-only (values are used in place, pages load on first access) */
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) return 0;
+
+	struct stat file_stat;
+	void *mapping = MAP_FAILED;
+	if (!fstat(fd, &file_stat) && file_stat.st_size >= (off_t)sizeof(struct dbt_snapshot_header)) mapping = mmap(0, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) return 0;
+
+
+	/* Check header and directory bounds (version 1 entries lack the null bitmap) */
+	size_t size = file_stat.st_size;
+	const struct dbt_snapshot_header *header = (const struct dbt_snapshot_header *)mapping;
+	const char *directory = (const char *)(header + 1);
+	int version_1 = !memcmp(header->magic, DBT_SNAPSHOT_MAGIC_V1, sizeof(header->magic));
+	size_t entry_size = version_1 ? offsetof(struct dbt_snapshot_column, nulls_offset) : sizeof(struct dbt_snapshot_column);
+	if ((!version_1 && memcmp(header->magic, DBT_SNAPSHOT_MAGIC, sizeof(header->magic))) || header->row_count > UINT32_MAX || header->column_count > (size - sizeof(*header)) / entry_size) {
+		munmap(mapping, size);
+		return 0;
+	}
+
+
+	/* Result set owns the mapping from here */
+	struct dbt_resultset *resultset = dbt_resultset_alloc(header->column_count, header->row_count);
+	if (!resultset) {
+		munmap(mapping, size);
+		return 0;
+	}
+	resultset->mapping = mapping;
+	resultset->mapping_size = size;
+
+	for (size_t j=0; j < resultset->column_count; j++) {
+		struct dbt_snapshot_column entry = {0};
+		memcpy(&entry, directory + j * entry_size, entry_size);
+		if (!snapshot_decode_column(resultset, j, &entry)) continue;
+
+		dbt_resultset_free(resultset);
+		return 0;
+	}
+
+
+	return resultset;
+}
+
+
+int dbt_snapshot_command(const char *input, struct dbt_session *session) {
+	/* Check input */
+	if (!input || !session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+
+
+	/* Empty input returns from a diff to the compared rows */
+	if (!input[0]) {
+		struct dbt_resultset *diff = tab->resultset;
+		if (!diff || !diff->source || strcmp(diff->kind, "diff")) return 1;
+
+		tab->resultset = diff->source;
+		diff->source = 0;
+		dbt_resultset_free(diff);
+
+		return dbt_results_refresh(session);
+	}
+
+
+	/* Parse 'save <path>', 'load <path>' or 'diff <tab|path> <keys>' */
+	size_t command_len = strcspn(input, " ");
+	const char *argument = input + command_len + strspn(input + command_len, " ");
+	if (command_len == 4 && !strncmp(input, "save", 4)) return snapshot_save_command(argument, session);
+	else if (command_len == 4 && !strncmp(input, "load", 4)) return snapshot_load_command(argument, session);
+	else if (command_len == 4 && !strncmp(input, "diff", 4)) return snapshot_diff_command(argument, session);
+
+
+	return 1;
+}
@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_STRINGS_BLOCK_SIZE 65536
+
+
+/* Helper functions */
+static uint32_t hash_string(const char *value, size_t length) {
+	/* FNV-1a (32 bit) */
+	uint32_t hash = 0x811c9dc5u;
+	for (size_t i=0; i < length; i++) {
+		hash ^= (unsigned char)value[i];
+		hash *= 0x01000193u;
+	}
+
+	return hash;
+}
+
+static int strings_grow_slots(struct dbt_strings *strings) {
+	/* Double slot table and reinsert ids using cached hashes */
+	size_t slot_cap = strings->slot_cap ? strings->slot_cap * 2 : 1024;
+	uint32_t *slots = (uint32_t *)calloc(slot_cap, sizeof(uint32_t));
+	if (!slots) return 1;
+
+	for (size_t id=0; id < strings->count; id++) {
+		size_t slot = strings->hashes[id] & (slot_cap - 1);
+		while (slots[slot]) slot = (slot + 1) & (slot_cap - 1);
+		slots[slot] = (uint32_t)id + 1;
+	}
+
+	free(strings->slots);
+	strings->slots = slots;
+	strings->slot_cap = slot_cap;
+
+
+	return 0;
+}
+
+static char *strings_store(struct dbt_strings *strings, const char *value, size_t length) {
+	/* Start new block when current one is full (blocks never move, so pointers stay valid) */
+	if (!strings->block_count || strings->block_used + length + 1 > strings->block_size) {
+		size_t block_size = length + 1 > DBT_STRINGS_BLOCK_SIZE ? length + 1 : DBT_STRINGS_BLOCK_SIZE;
+		char **blocks = (char **)realloc(strings->blocks, (strings->block_count + 1) * sizeof(char *));
+		if (!blocks) return 0;
+		strings->blocks = blocks;
+
+		char *block = (char *)malloc(block_size);
+		if (!block) return 0;
+
+		strings->blocks[strings->block_count++] = block;
+		strings->block_used = 0;
+		strings->block_size = block_size;
+	}
+
+
+	/* Copy with terminator */
+	char *stored = strings->blocks[strings->block_count-1] + strings->block_used;
+	memcpy(stored, value, length);
+	stored[length] = 0;
+	strings->block_used += length + 1;
+
+
+	return stored;
+}
+
+
+
+
+uint32_t dbt_strings_intern(struct dbt_strings *strings, const char *value, size_t length) {
+	/* Check input */
+	if (!strings || !value) return DBT_STRING_NONE;
+
+
+	/* Keep slot table at most half full */
+	if ((strings->count + 1) * 2 > strings->slot_cap && strings_grow_slots(strings)) return DBT_STRING_NONE;
+
+
+	/* Look up existing id */
+	uint32_t hash = hash_string(value, length);
+	size_t slot = hash & (strings->slot_cap - 1);
+	while (strings->slots[slot]) {
+		uint32_t id = strings->slots[slot] - 1;
+		if (strings->hashes[id] == hash && strings->lengths[id] == length && !memcmp(strings->values[id], value, length)) return id;
+		slot = (slot + 1) & (strings->slot_cap - 1);
+	}
+
+
+	/* Grow id arrays */
+	if (strings->count >= strings->cap) {
+		size_t cap = strings->cap ? strings->cap * 2 : 1024;
+		const char **values = (const char **)realloc(strings->values, cap * sizeof(const char *));
+		if (values) strings->values = values;
+		uint32_t *lengths = (uint32_t *)realloc(strings->lengths, cap * sizeof(uint32_t));
+		if (lengths) strings->lengths = lengths;
+		uint32_t *hashes = (uint32_t *)realloc(strings->hashes, cap * sizeof(uint32_t));
+		if (hashes) strings->hashes = hashes;
+		if (!values || !lengths || !hashes) return DBT_STRING_NONE;
+
+		strings->cap = cap;
+	}
+
+
+	/* Store new string */
+	const char *stored = strings_store(strings, value, length);
+	if (!stored) return DBT_STRING_NONE;
+
+	uint32_t id = (uint32_t)strings->count++;
+	strings->values[id] = stored;
+	strings->lengths[id] = (uint32_t)length;
+	strings->hashes[id] = hash;
+	strings->slots[slot] = id + 1;
+
+
+	return id;
+}
+
+
+const char *dbt_strings_get(const struct dbt_strings *strings, uint32_t id) {
+	/* Check input */
+	if (!strings || id >= strings->count) return 0;
+
+	return strings->values[id];
+}
+
+
+int dbt_strings_rebuild(struct dbt_strings *strings, uint32_t *ids, size_t count) {
+	/* Check input */
+	if (!strings || (!ids && count)) return 1;
+
+
+	/* Intern kept names into a fresh pool (old pool stays intact until every name was copied) */
+	struct dbt_strings fresh;
+	memset(&fresh, 0, sizeof(fresh));
+	uint32_t *fresh_ids = (uint32_t *)malloc((count ? count : 1) * sizeof(uint32_t));
+	if (!fresh_ids) return 1;
+
+	for (size_t i=0; i < count; i++) {
+		fresh_ids[i] = ids[i] < strings->count ? dbt_strings_intern(&fresh, strings->values[ids[i]], strings->lengths[ids[i]]) : DBT_STRING_NONE;
+		if (fresh_ids[i] == DBT_STRING_NONE) {
+			free(fresh_ids);
+			dbt_strings_free(&fresh);
+			return 1;
+		}
+	}
+
+
+	/* Replace pool and rewrite ids */
+	memcpy(ids, fresh_ids, count * sizeof(uint32_t));
+	free(fresh_ids);
+	dbt_strings_free(strings);
+	*strings = fresh;
+
+
+	return 0;
+}
+
+
+void dbt_strings_free(struct dbt_strings *strings) {
+	/* Check input */
+	if (!strings) return;
+
+
+	/* Release blocks and tables */
+	for (size_t i=0; i < strings->block_count; i++) free(strings->blocks[i]);
+	free(strings->blocks);
+	free(strings->values);
+	free(strings->lengths);
+	free(strings->hashes);
+	free(strings->slots);
+
+	memset(strings, 0, sizeof(*strings));
+}
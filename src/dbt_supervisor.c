@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_SUPERVISOR_DEFAULT_INTERVAL_MS 30000
+#define DBT_SUPERVISOR_MIN_BACKOFF_MS 500
+#define DBT_SUPERVISOR_MAX_BACKOFF_MS 30000
+#define DBT_SUPERVISOR_RESET_TIMEOUT_MS 10000
+
+
+/* Helper functions */
+static int64_t elapsed_us(const struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) * 1000000ll + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static void link_backoff(struct dbt_link *link) {
+	/* Exponential backoff between reconnect attempts */
+	int64_t delay_ms = DBT_SUPERVISOR_MIN_BACKOFF_MS;
+	for (int i=0; i < link->attempts && delay_ms < DBT_SUPERVISOR_MAX_BACKOFF_MS; i++) delay_ms *= 2;
+	if (delay_ms > DBT_SUPERVISOR_MAX_BACKOFF_MS) delay_ms = DBT_SUPERVISOR_MAX_BACKOFF_MS;
+
+	clock_gettime(CLOCK_MONOTONIC, &link->next_attempt);
+	link->next_attempt.tv_sec += delay_ms / 1000;
+	link->next_attempt.tv_nsec += (delay_ms % 1000) * 1000000;
+	if (link->next_attempt.tv_nsec >= 1000000000) {
+		link->next_attempt.tv_sec++;
+		link->next_attempt.tv_nsec -= 1000000000;
+	}
+
+	link->attempts++;
+	link->state = DBT_LINK_BROKEN;
+}
+
+static void link_break(struct dbt_link *link) {
+	/* First reconnect attempt starts right away */
+	link->state = DBT_LINK_BROKEN;
+	link->attempts = 0;
+	clock_gettime(CLOCK_MONOTONIC, &link->next_attempt);
+}
+
+static void link_restore(struct dbt_link *link, void *conn, struct dbt_adapter *adapter) {
+	/* Send next restore statement, healthy again once none is left */
+	if (!adapter->restore_connection(conn, link->session_state, &link->restore_step, adapter)) return;
+
+	link->state = DBT_LINK_OK;
+	link->attempts = 0;
+	clock_gettime(CLOCK_MONOTONIC, &link->last_check);
+}
+
+static int link_socket_ready(void *conn, struct dbt_link *link, struct dbt_adapter *adapter) {
+	/* Reset is only advanced when the socket is ready in the wanted direction */
+	struct pollfd fd;
+	fd.fd = adapter->connection_fd(conn, adapter);
+	fd.events = link->reset_wants == 1 ? POLLIN : POLLOUT;
+	fd.revents = 0;
+
+	return fd.fd >= 0 && poll(&fd, 1, 0) > 0;
+}
+
+static size_t link_collect_fd(struct pollfd *fd, const struct dbt_link *link, void *conn, struct dbt_adapter *adapter) {
+	/* Socket while an answer or reconnect step is awaited */
+	if (!conn || !adapter->check_connection) return 0;
+	else if (link->state != DBT_LINK_CHECKING && link->state != DBT_LINK_RESETTING && link->state != DBT_LINK_RESTORING) return 0;
+
+	fd->fd = adapter->connection_fd(conn, adapter);
+	fd->events = link->state == DBT_LINK_RESETTING && link->reset_wants == 2 ? POLLOUT : POLLIN;
+	fd->revents = 0;
+
+
+	return fd->fd >= 0;
+}
+
+static int supervise(struct dbt_link *link, void *conn, struct dbt_adapter *adapter, int idle, int interval_ms) {
+	/* Check input (returns 1 when link status changed) */
+	if (!conn || !adapter->check_connection) return 0;
+
+
+	switch (link->state) {
+		case DBT_LINK_OK:
+			/* Health check idle connections once per interval (answer is awaited without blocking) */
+			if (!idle || elapsed_us(&link->last_check) < interval_ms * 1000ll) return 0;
+			clock_gettime(CLOCK_MONOTONIC, &link->last_check);
+
+			if (adapter->check_connection(conn, adapter)) {
+				link_break(link);
+				return 1;
+			}
+
+			link->state = DBT_LINK_CHECKING;
+			return 0;
+
+		case DBT_LINK_CHECKING: {
+			/* Unanswered checks (e.g. blackholed link) count as broken */
+			int status = elapsed_us(&link->last_check) > DBT_SUPERVISOR_RESET_TIMEOUT_MS * 1000ll ? -1 : adapter->poll_check(conn, &link->session_state, adapter);
+			if (status > 0) return 0;
+			else if (status < 0) {
+				link_break(link);
+				return 1;
+			}
+
+			link->latency_us = elapsed_us(&link->last_check);
+			link->state = DBT_LINK_OK;
+			return 1;
+		}
+
+		case DBT_LINK_BROKEN: {
+			/* Start reconnect once backoff passed */
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			if (now.tv_sec < link->next_attempt.tv_sec || (now.tv_sec == link->next_attempt.tv_sec && now.tv_nsec < link->next_attempt.tv_nsec)) return 0;
+
+			if (adapter->reset_connection(conn, adapter)) {
+				link_backoff(link);
+				return 1;
+			}
+
+			link->state = DBT_LINK_RESETTING;
+			link->reset_wants = 2;
+			link->reset_started = now;
+			return 1;
+		}
+
+		case DBT_LINK_RESETTING:
+			/* Give up on this attempt when the server does not answer */
+			if (elapsed_us(&link->reset_started) > DBT_SUPERVISOR_RESET_TIMEOUT_MS * 1000ll) {
+				link_backoff(link);
+				return 1;
+			}
+			if (!link_socket_ready(conn, link, adapter)) return 0;
+
+			link->reset_wants = adapter->poll_reset(conn, adapter);
+			if (link->reset_wants > 0) return 0;
+			else if (link->reset_wants < 0) {
+				link_backoff(link);
+				return 1;
+			}
+
+
+			/* Connected again, restore session state statement by statement */
+			link->reconnect_us = elapsed_us(&link->reset_started);
+			link->state = DBT_LINK_RESTORING;
+			link->restore_step = 0;
+			link_restore(link, conn, adapter);
+			return 1;
+
+		case DBT_LINK_RESTORING: {
+			/* Wait for answer of the statement in flight, then send the next one */
+			int status = elapsed_us(&link->reset_started) > 2 * DBT_SUPERVISOR_RESET_TIMEOUT_MS * 1000ll ? -1 : adapter->poll_check(conn, 0, adapter);
+			if (status > 0) return 0;
+			else if (status < 0) {
+				link_backoff(link);
+				return 1;
+			}
+
+			link_restore(link, conn, adapter);
+			return link->state == DBT_LINK_OK;
+		}
+	}
+
+
+	return 0;
+}
+
+
+
+
+void dbt_supervisor_reset(struct dbt_link *link) {
+	/* Check input */
+	if (!link) return;
+
+
+	/* Fresh connection starts healthy (first check after one interval) */
+	json_decref(link->session_state);
+	memset(link, 0, sizeof(*link));
+	clock_gettime(CLOCK_MONOTONIC, &link->last_check);
+}
+
+
+int dbt_supervisor_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 0;
+
+
+	/* Health check interval ('health_interval' in seconds, config is parsed once a server was selected) */
+	json_t *interval = json_object_get(session->config.root, "health_interval");
+	int interval_ms = json_is_number(interval) && json_number_value(interval) > 0 ? (int)(json_number_value(interval) * 1000) : DBT_SUPERVISOR_DEFAULT_INTERVAL_MS;
+
+
+	/* Catalog connection plus idle tab and dashboard connections (busy ones report failures through their query). Not
+	   supervised: the server connection only lists databases on server switch (failures show in the status line), export
+	   and import connections live for one job that ends with an error message, the properties preview reopens its
+	   connection for the next table */
+	int changed = supervise(&session->link, session->adapter_handle.db_conn_handle, &session->adapter_handle, 1, interval_ms);
+	for (size_t i=0; i < DBT_TAB_MAX; i++) {
+		struct dbt_tab *tab = &session->tabs[i];
+		int idle = tab->state != DBT_TAB_RUNNING && !tab->more;
+		changed |= supervise(&tab->link, tab->conn_handle, &tab->adapter, idle, interval_ms);
+	}
+
+	struct dbt_dashboard *dashboard = &session->dashboard;
+	if (dashboard->active) changed |= supervise(&dashboard->link, dashboard->conn_handle, &dashboard->adapter, !dashboard->busy, interval_ms);
+
+	if (changed) dbt_session_refresh_query(session);
+
+
+	return changed;
+}
+
+
+size_t dbt_supervisor_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session) {
+	/* Check input */
+	if (!fds || !session) return 0;
+
+
+	/* Sockets of supervised connections waiting for a check, reconnect or restore step */
+	size_t count = 0;
+	if (count < max) count += link_collect_fd(&fds[count], &session->link, session->adapter_handle.db_conn_handle, &session->adapter_handle);
+	for (size_t i=0; i < DBT_TAB_MAX && count < max; i++) {
+		struct dbt_tab *tab = &session->tabs[i];
+		count += link_collect_fd(&fds[count], &tab->link, tab->conn_handle, &tab->adapter);
+	}
+
+	struct dbt_dashboard *dashboard = &session->dashboard;
+	if (dashboard->active && count < max) count += link_collect_fd(&fds[count], &dashboard->link, dashboard->conn_handle, &dashboard->adapter);
+
+
+	return count;
+}
+
+
+void dbt_supervisor_describe(const struct dbt_link *link, char *out, size_t out_size) {
+	/* Check input */
+	if (!link || !out || !out_size) return;
+
+
+	/* Status with latency of last check and duration of last reconnect */
+	switch (link->state) {
+		case DBT_LINK_OK:
+		case DBT_LINK_CHECKING:
+			if (link->reconnect_us) snprintf(out, out_size, "ok %.1fms, reconnected in %.0fms", link->latency_us / 1000.0, link->reconnect_us / 1000.0);
+			else if (link->latency_us) snprintf(out, out_size, "ok %.1fms", link->latency_us / 1000.0);
+			else snprintf(out, out_size, "ok");
+			break;
+		case DBT_LINK_BROKEN:
+			snprintf(out, out_size, "down, retry %d", link->attempts + 1);
+			break;
+		case DBT_LINK_RESETTING:
+		case DBT_LINK_RESTORING:
+			snprintf(out, out_size, "reconnecting");
+			break;
+	}
+}
@@ -9,27 +9,65 @@ int dbt_tables_refresh(struct dbt_session *session) {
 
 
 	/* Load tables */
-	session->table_list = session->adapter_handle.load_table_list(session->current_schema, &session->adapter_handle);
-	if (!json_is_array(session->table_list)) return 1;
+	if (session->adapter_handle.load_table_list(session->current_schema, &session->table_list, &session->strings, &session->adapter_handle)) return 1;
+	dbt_complete_names(DBT_COMPLETE_TABLES, session->current_schema, 0, session->table_list.names, session->table_list.count, 1, session);
 
 
-	/* Clear previous list */
-	wclear(session->app_windows[DBT_WIN_TABLESVIEWS]);
-	box(session->app_windows[DBT_WIN_TABLESVIEWS], 0, 0);
-	mvwprintw(session->app_windows[DBT_WIN_TABLESVIEWS], 0, 2, "Tables/Views");
+	/* Print new table list (from top) */
+	dbt_list_reset(DBT_WIN_TABLESVIEWS, session);
 
 
-	/* Print new table list */
-	size_t list_size = json_array_size(session->table_list);
-	for (size_t i=0; i < list_size; i++) {
-		const char *table_name = json_string_value(json_array_get(session->table_list, i));
+	return 0;
+}
 
-		mvwprintw(session->app_windows[DBT_WIN_TABLESVIEWS], i+1, 2, "[ ] %s", table_name);
+int dbt_tables_apply_change(const struct dbt_catalog_change *change, struct dbt_session *session) {
+	/* Check input */
+	if (!change || !session) return 1;
+	struct dbt_name_list *list = &session->table_list;
+
+
+	/* Find table (list is sorted by name) */
+	uint32_t name = dbt_strings_intern(&session->strings, change->table, strlen(change->table));
+	if (name == DBT_STRING_NONE) return 1;
+
+	size_t ind = 0;
+	int found = 0;
+	for (; ind < list->count; ind++) {
+		int cmp = strcmp(dbt_strings_get(&session->strings, list->names[ind]), change->table);
+		if (cmp >= 0) {
+			found = !cmp;
+			break;
+		}
 	}
 
 
-	/* Refresh window */
-	wrefresh(session->app_windows[DBT_WIN_TABLESVIEWS]);
+	/* Patch cached list in place */
+	if (change->op == 'C' && !found) {
+		if (dbt_catalog_names_append(list, name)) return 1;
+		memmove(list->names + ind + 1, list->names + ind, (list->count - ind - 1) * sizeof(uint32_t));
+		list->names[ind] = name;
+		dbt_complete_names(DBT_COMPLETE_TABLES, session->current_schema, 0, &name, 1, 0, session);
+	} else if (change->op == 'D' && found) {
+		memmove(list->names + ind, list->names + ind + 1, (list->count - ind - 1) * sizeof(uint32_t));
+		list->count--;
+		dbt_complete_remove(DBT_COMPLETE_TABLES, session->current_schema, 0, change->table, session);
+
+
+		/* Dropped table was selected */
+		if (session->current_table == dbt_strings_get(&session->strings, name)) {
+			session->current_table = 0;
+			session->current_column = 0;
+			session->column_list.count = 0;
+			dbt_list_reset(DBT_WIN_COLUMNS, session);
+		}
+	} else if (change->op == 'A' && !found) {
+		/* Unknown table altered (e.g. renamed), reload this schema's list */
+		return dbt_tables_refresh(session);
+	} else return 0;
+
+
+	/* Redraw pane (keeps scroll position) */
+	dbt_list_render(DBT_WIN_TABLESVIEWS, session);
 
 
 	return 0;
@@ -38,42 +76,33 @@ int dbt_tables_refresh(struct dbt_session *session) {
 int dbt_tables_select(const char *table, struct dbt_session *session) {
 	/* Check input */
 	if (!table || !session) return 1;
-	else if (!json_is_array(session->table_list)) return 1;
-
 
-	/* Load requested table */
-	int found_table = 0;
-	size_t list_count = json_array_size(session->table_list);
-	for (size_t i=0; i < list_count; i++) {
-		const char *table_name = json_string_value(json_array_get(session->table_list, i));
-		if (!strcmp(table_name, table)) {
-			/* Set found table flag */
-			found_table = 1;
 
-
-			/* Mark as selected */
-			mvwprintw(session->app_windows[DBT_WIN_TABLESVIEWS], i+1, 2, "[*]");
-
-
-			/* Store as current */
-			session->current_table = table_name;
+	/* Find requested table */
+	size_t list_count = session->table_list.count;
+	size_t ind = 0;
+	for (; ind < list_count; ind++) {
+		if (!strcmp(dbt_strings_get(&session->strings, session->table_list.names[ind]), table)) break;
+	}
 
 
-			/* Refresh columns */
-			dbt_columns_refresh(session);
-		} else mvwprintw(session->app_windows[DBT_WIN_TABLESVIEWS], i+1, 2, "[ ]");
+	/* Clear variables if table not found */
+	if (ind == list_count) {
+		session->current_table = 0;
+		dbt_list_render(DBT_WIN_TABLESVIEWS, session);
+		return 1;
 	}
 
 
-	/* Refresh window */
-	wrefresh(session->app_windows[DBT_WIN_TABLESVIEWS]);
+	/* Store as current and mark as selected (scrolled into view) */
+	session->current_table = dbt_strings_get(&session->strings, session->table_list.names[ind]);
+	dbt_list_reveal(DBT_WIN_TABLESVIEWS, ind, session);
 
 
-	/* Clear windows/variables if table not found */
-	if (!found_table) {
-		session->current_table = 0;
-	}
+	/* Refresh columns and properties */
+	dbt_columns_refresh(session);
+	dbt_properties_refresh(session);
 
 
-	return !found_table;
+	return 0;
 }
@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Helper functions */
+static void tab_disconnect(struct dbt_tab *tab) {
+	if (tab->conn_handle) tab->adapter.close_connection(tab->conn_handle, &tab->adapter);
+	tab->conn_handle = 0;
+	tab->server = 0;
+	tab->server_name = 0;
+	dbt_supervisor_reset(&tab->link);
+
+	free(tab->database);
+	tab->database = 0;
+}
+
+static void tab_connection_lost(struct dbt_tab *tab, struct dbt_session *session) {
+	/* Connection is gone or unusable, let the supervisor reconnect and restore it (or drop it so next run reconnects) */
+	if (tab->adapter.reset_connection) {
+		tab->link.state = DBT_LINK_BROKEN;
+		tab->link.attempts = 0;
+		clock_gettime(CLOCK_MONOTONIC, &tab->link.next_attempt);
+		dbt_session_refresh_query(session);
+	} else tab_disconnect(tab);
+}
+
+static int tab_connect(struct dbt_tab *tab, struct dbt_session *session) {
+	/* Check input */
+	if (!session->current_server || !session->current_database) return 1;
+	else if (!session->adapter_handle.open_connection) return 1;
+
+
+	/* Reuse pooled connection if it targets the same server/database */
+	if (tab->conn_handle && tab->server == session->current_server && !strcmp(tab->database, session->current_database)) return 0;
+	tab_disconnect(tab);
+
+
+	/* Open dedicated connection (tab keeps its own adapter copy, so browsing other servers does not affect it) */
+	tab->adapter = session->adapter_handle;
+	tab->conn_handle = tab->adapter.open_connection(session->current_database, &tab->adapter);
+	if (!tab->conn_handle) return 1;
+
+	tab->server = session->current_server;
+	tab->server_name = session->current_server_name;
+	tab->database = strdup(session->current_database);
+
+
+	return 0;
+}
+
+static void tab_finish(struct dbt_tab *tab, json_t *result, struct dbt_session *session) {
+	/* Measure duration */
+	struct timespec finished;
+	clock_gettime(CLOCK_MONOTONIC, &finished);
+	tab->duration_us = (finished.tv_sec - tab->started.tv_sec) * 1000000ull + (finished.tv_nsec - tab->started.tv_nsec) / 1000;
+
+
+	/* Replace previous result */
+	int failed = !json_is_object(result) || json_object_get(result, "error");
+	json_decref(tab->result);
+	tab->result = result;
+	tab->state = failed ? DBT_TAB_FAILED : DBT_TAB_DONE;
+	tab->unseen = tab != &session->tabs[session->tab_ind];
+
+
+	/* Profiled runs kept no rows, restore the tab's row limit */
+	size_t row_count = json_array_size(json_object_get(result, "rows"));
+	if (tab->profiling) {
+		row_count = session->profile.rows;
+		tab->adapter.row_limit = tab->row_limit;
+		tab->profiling = 0;
+	}
+
+
+	/* Record in history (fan-out runs are recorded under their target spec, fetching more is not a new run) */
+	if (tab->running_query && tab->fanout) dbt_history_append(tab->running_query, tab->fanout->spec, "", tab->duration_us, row_count, failed, session);
+	else if (tab->running_query) dbt_history_append(tab->running_query, tab->server_name, tab->database, tab->duration_us, row_count, failed, session);
+
+
+	/* Keep plan of explained runs (result pane shows the plan tree instead of rows) */
+	tab->plan = 0;
+	if (tab->explain && !failed) {
+		struct dbt_plan *plan = dbt_plan_from_json(tab->running_query, result);
+		if (plan && !dbt_plan_keep(plan, session)) tab->plan = plan;
+		else dbt_plan_free(plan);
+	}
+	tab->explain = 0;
+
+	free(tab->running_query);
+	tab->running_query = 0;
+
+	dbt_fanout_free(tab->fanout);
+	tab->fanout = 0;
+
+	dbt_script_free(tab->script);
+	tab->script = 0;
+
+
+	/* Keep rows in columnar form only (for client-side sort/filter/group), results stopped at the row limit keep json rows to append to */
+	dbt_resultset_free(tab->resultset);
+	tab->resultset = dbt_resultset_from_json(result);
+	tab->more = json_is_true(json_object_get(result, "truncated"));
+	tab->partial = json_is_true(json_object_get(result, "partial"));
+	if (tab->resultset && !tab->more) json_object_del(result, "rows");
+}
+
+static int tab_start(struct dbt_tab *tab, const char *query, const char *sent_query, int explain, struct dbt_session *session) {
+	/* Check input */
+	if (tab->state == DBT_TAB_RUNNING) return 1;
+
+
+	/* Connect (or reuse connection, unless the supervisor is reconnecting it; a health check in flight is dropped by the next send) */
+	if (tab_connect(tab, session)) return 1;
+	else if (tab->link.state == DBT_LINK_CHECKING) tab->link.state = DBT_LINK_OK;
+	else if (tab->link.state != DBT_LINK_OK) return 1;
+
+
+	/* Send query in background */
+	if (tab->adapter.send_query(sent_query, tab->conn_handle, &tab->adapter)) {
+		tab_connection_lost(tab, session);
+		return 1;
+	}
+
+	tab->running_query = strdup(query);
+	tab->explain = explain;
+	tab->more = 0;
+	tab->state = DBT_TAB_RUNNING;
+	clock_gettime(CLOCK_MONOTONIC, &tab->started);
+
+
+	/* Show running state */
+	dbt_results_refresh(session);
+
+
+	return 0;
+}
+
+
+
+
+int dbt_tabs_execute(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->q_buffer || !tab->q_buffer[0]) return 1;
+
+
+	return tab_start(tab, tab->q_buffer, tab->q_buffer, 0, session);
+}
+
+
+int dbt_tabs_explain(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->q_buffer || !tab->q_buffer[0]) return 1;
+
+
+	/* Run reads under EXPLAIN ANALYZE, statements that write are only planned (plan is parsed when it finishes) */
+	const char *prefix = dbt_plan_analyzable(tab->q_buffer) ? DBT_PLAN_PREFIX : DBT_PLAN_ESTIMATE_PREFIX;
+	size_t query_size = strlen(prefix) + strlen(tab->q_buffer) + 1;
+	char *query = (char *)malloc(query_size);
+	if (!query) return 1;
+	snprintf(query, query_size, "%s%s", prefix, tab->q_buffer);
+
+	int failed = tab_start(tab, tab->q_buffer, query, 1, session);
+	free(query);
+
+
+	return failed;
+}
+
+
+int dbt_tabs_profile(int batch_rows, struct dbt_session *session) {
+	/* Check input */
+	if (!session || batch_rows <= 0) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->q_buffer || !tab->q_buffer[0] || tab->state == DBT_TAB_RUNNING) return 1;
+
+
+	/* Stream in batches on the tab's own connection (connected first so the limit is set on the adapter copy that sends) */
+	if (tab_connect(tab, session)) return 1;
+	tab->row_limit = tab->adapter.row_limit;
+	tab->adapter.row_limit = batch_rows;
+	tab->profiling = 1;
+
+	if (tab_start(tab, tab->q_buffer, tab->q_buffer, 0, session)) {
+		tab->adapter.row_limit = tab->row_limit;
+		tab->profiling = 0;
+		return 1;
+	}
+
+
+	return 0;
+}
+
+
+int dbt_tabs_script(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->q_buffer || !tab->q_buffer[0] || tab->state == DBT_TAB_RUNNING) return 1;
+
+
+	/* Connect (or reuse connection, unless the supervisor is reconnecting it; a health check in flight is dropped by the next send) */
+	if (tab_connect(tab, session)) return 1;
+	else if (tab->link.state == DBT_LINK_CHECKING) tab->link.state = DBT_LINK_OK;
+	else if (tab->link.state != DBT_LINK_OK) return 1;
+
+
+	/* Split buffer into statements ('script_on_error' is 'stop' or 'continue') */
+	const char *on_error = json_string_value(json_object_get(dbt_config_get(&session->config), "script_on_error"));
+	struct dbt_script *script = dbt_script_new(tab->q_buffer, on_error && !strcmp(on_error, "continue"), &tab->adapter, tab->conn_handle);
+	if (!script) return 1;
+
+
+	/* Attach to tab (statements are pipelined by the event loop) */
+	tab->script = script;
+	tab->running_query = strdup(tab->q_buffer);
+	tab->more = 0;
+	tab->state = DBT_TAB_RUNNING;
+	clock_gettime(CLOCK_MONOTONIC, &tab->started);
+
+
+	/* Show running state */
+	dbt_results_refresh(session);
+
+
+	return 0;
+}
+
+
+int dbt_tabs_select(short int tab, struct dbt_session *session) {
+	/* Check input */
+	if (!session || tab < 0 || tab >= DBT_TAB_MAX) return 1;
+
+
+	/* Switch tab */
+	session->tab_ind = tab;
+	session->tabs[tab].unseen = 0;
+
+
+	/* Redraw query and result windows */
+	dbt_results_refresh(session);
+	dbt_session_refresh_query(session);
+
+
+	return 0;
+}
+
+
+int dbt_tabs_cancel(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (tab->state != DBT_TAB_RUNNING) return 1;
+
+
+	/* Result (with cancellation error) arrives through the event loop */
+	if (tab->fanout) return dbt_fanout_cancel(tab->fanout);
+	else if (tab->script) return dbt_script_cancel(tab->script);
+	return tab->adapter.cancel_query(tab->conn_handle, &tab->adapter);
+}
+
+
+int dbt_tabs_fetch_more(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 1;
+	struct dbt_tab *tab = &session->tabs[session->tab_ind];
+	if (!tab->more || tab->state != DBT_TAB_DONE || !tab->adapter.fetch_more) return 1;
+
+
+	/* Continue streaming into the same result (rows are appended, finish rebuilds the result set) */
+	if (tab->adapter.fetch_more(tab->conn_handle, tab->result, &tab->adapter)) return 1;
+
+	tab->pending = tab->result;
+	tab->result = 0;
+	tab->more = 0;
+	tab->state = DBT_TAB_RUNNING;
+	clock_gettime(CLOCK_MONOTONIC, &tab->started);
+
+
+	/* Show running state */
+	dbt_results_refresh(session);
+
+
+	return 0;
+}
+
+
+size_t dbt_tabs_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session) {
+	/* Check input */
+	if (!fds || !session) return 0;
+
+
+	/* Watch sockets of running tabs */
+	size_t count = 0;
+	for (size_t i=0; i < DBT_TAB_MAX && count < max; i++) {
+		struct dbt_tab *tab = &session->tabs[i];
+		if (tab->state != DBT_TAB_RUNNING) continue;
+
+		if (tab->fanout) {
+			count += dbt_fanout_collect_fds(tab->fanout, fds + count, max - count);
+			continue;
+		} else if (tab->script) {
+			count += dbt_script_collect_fds(tab->script, fds + count, max - count);
+			continue;
+		}
+
+		fds[count].fd = tab->adapter.connection_fd(tab->conn_handle, &tab->adapter);
+		fds[count].events = POLLIN;
+		fds[count].revents = 0;
+		count++;
+	}
+
+
+	return count;
+}
+
+
+int dbt_tabs_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return 0;
+
+
+	/* Advance running tabs (result json is counted for results) */
+	enum dbt_memory_subsystem scope = dbt_memory_scope(DBT_MEMORY_RESULTS);
+	int running = 0, changed = 0;
+	for (size_t i=0; i < DBT_TAB_MAX; i++) {
+		struct dbt_tab *tab = &session->tabs[i];
+		if (tab->state != DBT_TAB_RUNNING) continue;
+		running = 1;
+
+		/* Partial statement results are kept in pending until the query finishes */
+		if (tab->fanout) {
+			if (dbt_fanout_poll(tab->fanout, &tab->pending, session)) continue;
+		} else if (tab->script) {
+			if (dbt_script_poll(tab->script, &tab->pending, session)) continue;
+			else if (tab->script->needs_reset) tab_connection_lost(tab, session);
+		} else if (tab->adapter.poll_query(tab->conn_handle, &tab->pending, &tab->adapter)) continue;
+		else if (tab->profiling && dbt_profile_fold(tab, session)) continue;
+
+		tab_finish(tab, tab->pending, session);
+		tab->pending = 0;
+		changed = 1;
+	}
+	dbt_memory_scope(scope);
+
+
+	/* Redraw (running tabs also update their elapsed time) */
+	struct dbt_tab *current = &session->tabs[session->tab_ind];
+	if (changed || current->state == DBT_TAB_RUNNING) dbt_results_refresh(session);
+	if (changed) dbt_session_refresh_query(session);
+
+
+	return running;
+}
+
+
+void dbt_tabs_close(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+
+
+	/* Release connections, buffers and results */
+	for (size_t i=0; i < DBT_TAB_MAX; i++) {
+		struct dbt_tab *tab = &session->tabs[i];
+		tab_disconnect(tab);
+
+		dbt_fanout_free(tab->fanout);
+		dbt_script_free(tab->script);
+		free(tab->q_buffer);
+		free(tab->running_query);
+		json_decref(tab->pending);
+		json_decref(tab->result);
+		dbt_resultset_free(tab->resultset);
+		memset(tab, 0, sizeof(*tab));
+	}
+}
@@ -0,0 +1,900 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_TRACE_MAGIC "DBTTRC01"
+#define DBT_TRACE_MAGIC_LEN 8
+#define DBT_TRACE_MAX_BACKENDS 8
+#define DBT_TRACE_MAX_CONNS 64
+#define DBT_TRACE_NONE SIZE_MAX
+
+enum dbt_trace_kind {
+	DBT_TRACE_KEY = 1,
+	DBT_TRACE_DATABASES,
+	DBT_TRACE_CONNECT_DB,
+	DBT_TRACE_SCHEMAS,
+	DBT_TRACE_TABLES,
+	DBT_TRACE_COLUMNS,
+	DBT_TRACE_PERFORM,
+	DBT_TRACE_PROPERTIES,
+	DBT_TRACE_OPEN,
+	DBT_TRACE_SEND,
+	DBT_TRACE_POLL,
+	DBT_TRACE_FETCH,
+	DBT_TRACE_KINDS
+};
+
+
+/* On-disk record header, followed by "arg\0data\0" (padded to 8 bytes); keys keep their code in status */
+struct dbt_trace_record {
+	uint32_t length;
+	uint32_t kind;
+	uint32_t conn;
+	int32_t status;
+	uint64_t time_us;
+	uint64_t duration_us;
+	uint32_t arg_len;
+	uint32_t data_len;
+};
+
+
+/* Replayed connection, its timer fires when the recorded result is due */
+struct dbt_trace_conn {
+	uint32_t id;
+	int timer_fd;
+	size_t pending;
+};
+
+
+/* Trace state (process wide like the plugin registry, adapters are created without a session) */
+static struct {
+	int recording;
+	int replaying;
+	int fast;
+	struct timespec started;
+
+	/* Recording: functions of wrapped backends, connections by id */
+	FILE *out;
+	struct dbt_adapter backends[DBT_TRACE_MAX_BACKENDS];
+	size_t backend_count;
+	struct {
+		void *conn;
+		uint32_t id;
+		struct timespec sent;
+	} conns[DBT_TRACE_MAX_CONNS];
+	size_t conn_count;
+	uint32_t next_conn;
+
+	/* Replay: mapped trace, record offsets in file order, records grouped by kind and by kind plus connection (file
+	   order within a group), each group's cursor skips the records consumed at its front */
+	void *map;
+	size_t map_size;
+	size_t *offsets;
+	uint8_t *used;
+	size_t count;
+	size_t *by_kind;
+	size_t kind_end[DBT_TRACE_KINDS];
+	size_t cursors[DBT_TRACE_KINDS];
+	size_t *by_conn;
+	size_t *conn_cursors;
+	struct dbt_trace_conn *live[DBT_TRACE_MAX_CONNS];
+	size_t live_count;
+
+	/* Replay report */
+	size_t keys;
+	size_t calls;
+	size_t mismatches;
+	uint64_t handled_us;
+	uint64_t handled_max_us;
+} trace_state;
+
+
+/* Helper functions */
+static uint64_t trace_elapsed_us(const struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) * 1000000ull + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+static void trace_write(enum dbt_trace_kind kind, uint32_t conn, int status, const struct timespec *started, const char *arg, const char *data, size_t data_len) {
+	/* Serialize and append (buffered, flushed on close) */
+	struct dbt_trace_record record = {0};
+	record.kind = kind;
+	record.conn = conn;
+	record.status = status;
+	record.time_us = trace_elapsed_us(&trace_state.started);
+	record.duration_us = started ? trace_elapsed_us(started) : 0;
+	record.arg_len = arg ? (uint32_t)strlen(arg) : 0;
+	record.data_len = data ? (uint32_t)data_len : 0;
+
+	size_t payload_len = record.arg_len + 1 + record.data_len + 1;
+	record.length = (uint32_t)((sizeof(record) + payload_len + 7) & ~(size_t)7);
+
+	char padding[8] = {0};
+	fwrite(&record, sizeof(record), 1, trace_state.out);
+	fwrite(arg ? arg : "", 1, record.arg_len + 1, trace_state.out);
+	if (data) fwrite(data, 1, record.data_len, trace_state.out);
+	fwrite(padding, 1, record.length - sizeof(record) - payload_len + 1, trace_state.out);
+}
+
+static void trace_write_json(enum dbt_trace_kind kind, uint32_t conn, const struct timespec *started, const char *arg, json_t *result) {
+	/* Null results are recorded as failures (dumped text belongs to the json allocator) */
+	char *data = result ? json_dumps(result, JSON_COMPACT) : 0;
+	trace_write(kind, conn, !data, started, arg, data, data ? strlen(data) : 0);
+
+	json_free_t json_free;
+	json_get_alloc_funcs(0, &json_free);
+	if (data) json_free(data);
+}
+
+static uint32_t trace_conn_id(void *conn) {
+	/* Connections opened before recording or beyond the table are not traced (0) */
+	for (size_t i=0; conn && i < trace_state.conn_count; i++) {
+		if (trace_state.conns[i].conn == conn) return trace_state.conns[i].id;
+	}
+
+
+	return 0;
+}
+
+static struct timespec *trace_conn_sent(void *conn) {
+	for (size_t i=0; i < trace_state.conn_count; i++) {
+		if (trace_state.conns[i].conn == conn) return &trace_state.conns[i].sent;
+	}
+
+
+	return 0;
+}
+
+static const char *trace_record_at(size_t ind, struct dbt_trace_record *record) {
+	/* Header plus arg (data follows the arg terminator) */
+	const char *base = (const char *)trace_state.map + trace_state.offsets[ind];
+	memcpy(record, base, sizeof(*record));
+
+	return base + sizeof(*record);
+}
+
+static int trace_compare_conn(const void *a, const void *b) {
+	/* Kind, then connection, then file order */
+	struct dbt_trace_record left, right;
+	size_t left_ind = *(const size_t *)a, right_ind = *(const size_t *)b;
+	trace_record_at(left_ind, &left);
+	trace_record_at(right_ind, &right);
+
+	if (left.kind != right.kind) return left.kind < right.kind ? -1 : 1;
+	else if (left.conn != right.conn) return left.conn < right.conn ? -1 : 1;
+	return left_ind < right_ind ? -1 : left_ind > right_ind;
+}
+
+static int trace_conn_group_before(size_t ind, enum dbt_trace_kind kind, uint32_t conn) {
+	struct dbt_trace_record record;
+	trace_record_at(ind, &record);
+
+	return record.kind < kind || (record.kind == kind && record.conn < conn);
+}
+
+static int trace_conn_group_is(size_t ind, enum dbt_trace_kind kind, uint32_t conn) {
+	struct dbt_trace_record record;
+	trace_record_at(ind, &record);
+
+	return record.kind == kind && record.conn == conn;
+}
+
+static size_t trace_find(enum dbt_trace_kind kind, uint32_t conn, int match_conn, struct dbt_trace_record *record, const char **arg) {
+	/* Next unused record of this kind (and connection), marked as used */
+	size_t ind = DBT_TRACE_NONE;
+	if (!match_conn) {
+		size_t *cursor = &trace_state.cursors[kind];
+		while (*cursor < trace_state.kind_end[kind] && trace_state.used[trace_state.by_kind[*cursor]]) (*cursor)++;
+		if (*cursor < trace_state.kind_end[kind]) ind = trace_state.by_kind[*cursor];
+	} else {
+		/* Group of the connection by binary search, its cursor sits at the front position */
+		size_t low = 0, high = trace_state.count;
+		while (low < high) {
+			size_t mid = low + (high - low) / 2;
+			if (trace_conn_group_before(trace_state.by_conn[mid], kind, conn)) low = mid + 1;
+			else high = mid;
+		}
+
+		size_t *cursor = &trace_state.conn_cursors[low];
+		while (*cursor < trace_state.count && trace_conn_group_is(trace_state.by_conn[*cursor], kind, conn) && trace_state.used[trace_state.by_conn[*cursor]]) (*cursor)++;
+		if (*cursor < trace_state.count && trace_conn_group_is(trace_state.by_conn[*cursor], kind, conn)) ind = trace_state.by_conn[*cursor];
+	}
+	if (ind == DBT_TRACE_NONE) return DBT_TRACE_NONE;
+
+	*arg = trace_record_at(ind, record);
+	trace_state.used[ind] = 1;
+
+
+	return ind;
+}
+
+static size_t trace_take(enum dbt_trace_kind kind, uint32_t conn, int match_conn, const char *arg, struct dbt_trace_record *record, const char **data) {
+	/* Replayed call, a missing record or different argument counts as mismatch */
+	trace_state.calls++;
+
+	const char *record_arg;
+	size_t ind = trace_find(kind, conn, match_conn, record, &record_arg);
+	if (ind == DBT_TRACE_NONE || (arg && strcmp(arg, record_arg))) trace_state.mismatches++;
+	if (ind != DBT_TRACE_NONE) *data = record_arg + record->arg_len + 1;
+
+
+	return ind;
+}
+
+static void trace_wait(const struct dbt_trace_record *record) {
+	/* Blocking calls take as long as they did (skipped in fast mode) */
+	if (trace_state.fast || !record->duration_us) return;
+
+	struct timespec delay = { (time_t)(record->duration_us / 1000000), (long)(record->duration_us % 1000000) * 1000 };
+	while (nanosleep(&delay, &delay) && errno == EINTR);
+}
+
+static void trace_arm(struct dbt_trace_conn *conn, size_t ind) {
+	/* Result becomes readable after its recorded duration (right away in fast mode) */
+	struct dbt_trace_record record;
+	trace_record_at(ind, &record);
+
+	uint64_t due_ns = trace_state.fast ? 1 : record.duration_us * 1000 + 1;
+	struct itimerspec timer = { { 0, 0 }, { (time_t)(due_ns / 1000000000), (long)(due_ns % 1000000000) } };
+	timerfd_settime(conn->timer_fd, 0, &timer, 0);
+
+	conn->pending = ind;
+}
+
+static char *trace_names_blob(const struct dbt_name_list *list, const struct dbt_strings *strings, size_t *blob_len) {
+	/* Names as consecutive NUL terminated strings */
+	*blob_len = 0;
+	for (size_t i=0; i < list->count; i++) *blob_len += strlen(dbt_strings_get(strings, list->names[i])) + 1;
+
+	char *blob = (char *)malloc(*blob_len + 1);
+	if (!blob) return 0;
+
+	char *cursor = blob;
+	for (size_t i=0; i < list->count; i++) cursor = stpcpy(cursor, dbt_strings_get(strings, list->names[i])) + 1;
+
+
+	return blob;
+}
+
+static int trace_names_load(const char *data, size_t data_len, struct dbt_name_list *list, struct dbt_strings *strings) {
+	list->count = 0;
+	for (const char *name = data; name < data + data_len; name += strlen(name) + 1) {
+		if (dbt_catalog_names_append(list, dbt_strings_intern(strings, name, strlen(name)))) return 1;
+	}
+
+
+	return 0;
+}
+
+
+/* Recording wrappers (call the backend, then append what it returned) */
+static int record_load_database_list(struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	int failed = adapter->traced->load_database_list(list, strings, adapter);
+
+	size_t blob_len;
+	char *blob = trace_names_blob(list, strings, &blob_len);
+	trace_write(DBT_TRACE_DATABASES, 0, failed, &started, "", blob, blob_len);
+	free(blob);
+
+	return failed;
+}
+
+static int record_connect_to_db(const char *database, struct dbt_adapter *adapter) {
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	int failed = adapter->traced->connect_to_db(database, adapter);
+
+	trace_write(DBT_TRACE_CONNECT_DB, 0, failed, &started, database, 0, 0);
+
+	return failed;
+}
+
+static int record_load_schema_list(struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	int failed = adapter->traced->load_schema_list(list, strings, adapter);
+
+	size_t blob_len;
+	char *blob = trace_names_blob(list, strings, &blob_len);
+	trace_write(DBT_TRACE_SCHEMAS, 0, failed, &started, "", blob, blob_len);
+	free(blob);
+
+	return failed;
+}
+
+static int record_load_table_list(const char *schema, struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	int failed = adapter->traced->load_table_list(schema, list, strings, adapter);
+
+	size_t blob_len;
+	char *blob = trace_names_blob(list, strings, &blob_len);
+	trace_write(DBT_TRACE_TABLES, 0, failed, &started, schema, blob, blob_len);
+	free(blob);
+
+	return failed;
+}
+
+static int record_load_column_list(const char *schema, const char *table, struct dbt_column_table *columns, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	int failed = adapter->traced->load_column_list(schema, table, columns, strings, adapter);
+
+
+	/* Four strings per column: name, type, max length, flags */
+	size_t blob_len = 0;
+	for (size_t i=0; i < columns->count; i++) blob_len += strlen(dbt_strings_get(strings, columns->names[i])) + strlen(dbt_strings_get(strings, columns->datatypes[i])) + 32;
+
+	char *blob = (char *)malloc(blob_len + 1);
+	char *cursor = blob;
+	for (size_t i=0; blob && i < columns->count; i++) {
+		cursor = stpcpy(cursor, dbt_strings_get(strings, columns->names[i])) + 1;
+		cursor = stpcpy(cursor, dbt_strings_get(strings, columns->datatypes[i])) + 1;
+		cursor += sprintf(cursor, "%d", columns->max_lengths[i]) + 1;
+		cursor += sprintf(cursor, "%u", columns->flags[i]) + 1;
+	}
+
+	char arg[256];
+	snprintf(arg, sizeof(arg), "%s.%s", schema, table);
+	trace_write(DBT_TRACE_COLUMNS, 0, failed, &started, arg, blob, blob ? (size_t)(cursor - blob) : 0);
+	free(blob);
+
+	return failed;
+}
+
+static json_t *record_perform_query(const char *query, struct dbt_adapter *adapter) {
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	json_t *result = adapter->traced->perform_query(query, adapter);
+
+	trace_write_json(DBT_TRACE_PERFORM, 0, &started, query, result);
+
+	return result;
+}
+
+static json_t *record_load_table_properties(const char *schema, const char *table, struct dbt_adapter *adapter) {
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	json_t *properties = adapter->traced->load_table_properties(schema, table, adapter);
+
+	char arg[256];
+	snprintf(arg, sizeof(arg), "%s.%s", schema, table);
+	trace_write_json(DBT_TRACE_PROPERTIES, 0, &started, arg, properties);
+
+	return properties;
+}
+
+static void *record_open_connection(const char *database, struct dbt_adapter *adapter) {
+	/* Ids follow open order, replay opens in the same order */
+	struct timespec started;
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	void *conn = adapter->traced->open_connection(database, adapter);
+
+	uint32_t id = ++trace_state.next_conn;
+	if (conn && trace_state.conn_count < DBT_TRACE_MAX_CONNS) {
+		trace_state.conns[trace_state.conn_count].conn = conn;
+		trace_state.conns[trace_state.conn_count].id = id;
+		trace_state.conn_count++;
+	}
+	trace_write(DBT_TRACE_OPEN, id, !conn, &started, database, 0, 0);
+
+	return conn;
+}
+
+static void record_close_connection(void *conn, struct dbt_adapter *adapter) {
+	for (size_t i=0; conn && i < trace_state.conn_count; i++) {
+		if (trace_state.conns[i].conn == conn) trace_state.conns[i] = trace_state.conns[--trace_state.conn_count];
+	}
+
+	adapter->traced->close_connection(conn, adapter);
+}
+
+static int record_send_query(const char *query, void *conn, struct dbt_adapter *adapter) {
+	int failed = adapter->traced->send_query(query, conn, adapter);
+
+	struct timespec *sent = trace_conn_sent(conn);
+	if (sent) {
+		clock_gettime(CLOCK_MONOTONIC, sent);
+		trace_write(DBT_TRACE_SEND, trace_conn_id(conn), failed, 0, query, 0, 0);
+	}
+
+	return failed;
+}
+
+static int record_poll_query(void *conn, json_t **result, struct dbt_adapter *adapter) {
+	/* Only finished results are kept, duration counts from send (or fetch more) */
+	int busy = adapter->traced->poll_query(conn, result, adapter);
+
+	struct timespec *sent = trace_conn_sent(conn);
+	if (!busy && sent) trace_write_json(DBT_TRACE_POLL, trace_conn_id(conn), sent, "", *result);
+
+	return busy;
+}
+
+static int record_fetch_more(void *conn, json_t *result, struct dbt_adapter *adapter) {
+	int failed = adapter->traced->fetch_more(conn, result, adapter);
+
+	struct timespec *sent = trace_conn_sent(conn);
+	if (sent) {
+		clock_gettime(CLOCK_MONOTONIC, sent);
+		trace_write(DBT_TRACE_FETCH, trace_conn_id(conn), failed, 0, "", 0, 0);
+	}
+
+	return failed;
+}
+
+
+/* Replay adapter (answers from the trace, no server) */
+static struct dbt_trace_conn *replay_conn_new(uint32_t id) {
+	struct dbt_trace_conn *conn = (struct dbt_trace_conn *)calloc(1, sizeof(struct dbt_trace_conn));
+	if (!conn) return 0;
+
+	conn->id = id;
+	conn->pending = DBT_TRACE_NONE;
+	conn->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (conn->timer_fd < 0 || trace_state.live_count >= DBT_TRACE_MAX_CONNS) {
+		if (conn->timer_fd >= 0) close(conn->timer_fd);
+		free(conn);
+		return 0;
+	}
+
+	trace_state.live[trace_state.live_count++] = conn;
+
+	return conn;
+}
+
+static void replay_close_connection(void *conn_handle, struct dbt_adapter *adapter) {
+	struct dbt_trace_conn *conn = (struct dbt_trace_conn *)conn_handle;
+	if (!conn) return;
+
+	for (size_t i=0; i < trace_state.live_count; i++) {
+		if (trace_state.live[i] == conn) trace_state.live[i] = trace_state.live[--trace_state.live_count];
+	}
+
+	close(conn->timer_fd);
+	free(conn);
+}
+
+static int replay_names(enum dbt_trace_kind kind, const char *arg, struct dbt_name_list *list, struct dbt_strings *strings) {
+	struct dbt_trace_record record;
+	const char *data;
+	if (trace_take(kind, 0, 0, arg, &record, &data) == DBT_TRACE_NONE) return 1;
+
+	trace_wait(&record);
+	if (record.status) return record.status;
+
+	return trace_names_load(data, record.data_len, list, strings);
+}
+
+static int replay_load_database_list(struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	return replay_names(DBT_TRACE_DATABASES, "", list, strings);
+}
+
+static int replay_connect_to_db(const char *database, struct dbt_adapter *adapter) {
+	struct dbt_trace_record record;
+	const char *data;
+	if (trace_take(DBT_TRACE_CONNECT_DB, 0, 0, database, &record, &data) == DBT_TRACE_NONE) return 1;
+
+	trace_wait(&record);
+	replay_close_connection(adapter->db_conn_handle, adapter);
+	adapter->db_conn_handle = record.status ? 0 : replay_conn_new(0);
+
+	return record.status != 0;
+}
+
+static int replay_load_schema_list(struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	return replay_names(DBT_TRACE_SCHEMAS, "", list, strings);
+}
+
+static int replay_load_table_list(const char *schema, struct dbt_name_list *list, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	return replay_names(DBT_TRACE_TABLES, schema, list, strings);
+}
+
+static int replay_load_column_list(const char *schema, const char *table, struct dbt_column_table *columns, struct dbt_strings *strings, struct dbt_adapter *adapter) {
+	char arg[256];
+	snprintf(arg, sizeof(arg), "%s.%s", schema, table);
+
+	struct dbt_trace_record record;
+	const char *data;
+	if (trace_take(DBT_TRACE_COLUMNS, 0, 0, arg, &record, &data) == DBT_TRACE_NONE) return 1;
+
+	trace_wait(&record);
+	if (record.status) return record.status;
+
+
+	/* Name, type, max length and flags per column */
+	columns->count = 0;
+	const char *end = data + record.data_len;
+	while (data < end) {
+		const char *name = data;
+		const char *datatype = name + strlen(name) + 1;
+		const char *max_length = datatype + strlen(datatype) + 1;
+		const char *flags = max_length + strlen(max_length) + 1;
+		if (flags >= end) break;
+		data = flags + strlen(flags) + 1;
+
+		uint32_t name_id = dbt_strings_intern(strings, name, strlen(name));
+		uint32_t datatype_id = dbt_strings_intern(strings, datatype, strlen(datatype));
+		if (dbt_catalog_columns_append(columns, name_id, datatype_id, atoi(max_length), (uint8_t)atoi(flags))) return 1;
+	}
+
+
+	return 0;
+}
+
+static json_t *replay_json(enum dbt_trace_kind kind, const char *arg) {
+	struct dbt_trace_record record;
+	const char *data;
+	if (trace_take(kind, 0, 0, arg, &record, &data) == DBT_TRACE_NONE) return 0;
+
+	trace_wait(&record);
+
+	return record.status ? 0 : json_loadb(data, record.data_len, 0, 0);
+}
+
+static json_t *replay_perform_query(const char *query, struct dbt_adapter *adapter) {
+	return replay_json(DBT_TRACE_PERFORM, query);
+}
+
+static json_t *replay_load_table_properties(const char *schema, const char *table, struct dbt_adapter *adapter) {
+	char arg[256];
+	snprintf(arg, sizeof(arg), "%s.%s", schema, table);
+
+	return replay_json(DBT_TRACE_PROPERTIES, arg);
+}
+
+static void *replay_open_connection(const char *database, struct dbt_adapter *adapter) {
+	uint32_t id = ++trace_state.next_conn;
+
+	struct dbt_trace_record record;
+	const char *data;
+	if (trace_take(DBT_TRACE_OPEN, id, 1, database, &record, &data) == DBT_TRACE_NONE || record.status) return 0;
+
+	trace_wait(&record);
+
+	return replay_conn_new(id);
+}
+
+static int replay_connection_fd(void *conn, struct dbt_adapter *adapter) {
+	return ((struct dbt_trace_conn *)conn)->timer_fd;
+}
+
+static int replay_send_query(const char *query, void *conn_handle, struct dbt_adapter *adapter) {
+	struct dbt_trace_conn *conn = (struct dbt_trace_conn *)conn_handle;
+
+	struct dbt_trace_record record;
+	const char *data;
+	if (trace_take(DBT_TRACE_SEND, conn->id, 1, query, &record, &data) == DBT_TRACE_NONE || record.status) return 1;
+
+
+	/* Result is the next one recorded on this connection */
+	size_t result = trace_find(DBT_TRACE_POLL, conn->id, 1, &record, &data);
+	if (result != DBT_TRACE_NONE) trace_arm(conn, result);
+
+
+	return 0;
+}
+
+static int replay_poll_query(void *conn_handle, json_t **result, struct dbt_adapter *adapter) {
+	struct dbt_trace_conn *conn = (struct dbt_trace_conn *)conn_handle;
+
+
+	/* Busy until the timer fired */
+	uint64_t expirations;
+	if (conn->pending != DBT_TRACE_NONE && read(conn->timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return 1;
+
+	json_decref(*result);
+	*result = 0;
+	if (conn->pending != DBT_TRACE_NONE) {
+		struct dbt_trace_record record;
+		const char *data = trace_record_at(conn->pending, &record);
+		data += record.arg_len + 1;
+		*result = record.status ? 0 : json_loadb(data, record.data_len, 0, 0);
+	}
+	if (!*result) {
+		*result = json_object();
+		json_object_set_new(*result, "error", json_string("no recorded result"));
+	}
+	conn->pending = DBT_TRACE_NONE;
+
+
+	return 0;
+}
+
+static int replay_fetch_more(void *conn_handle, json_t *result, struct dbt_adapter *adapter) {
+	struct dbt_trace_conn *conn = (struct dbt_trace_conn *)conn_handle;
+
+	struct dbt_trace_record record;
+	const char *data;
+	if (trace_take(DBT_TRACE_FETCH, conn->id, 1, 0, &record, &data) == DBT_TRACE_NONE || record.status) return 1;
+
+	size_t more = trace_find(DBT_TRACE_POLL, conn->id, 1, &record, &data);
+	if (more != DBT_TRACE_NONE) trace_arm(conn, more);
+
+
+	return 0;
+}
+
+static int replay_cancel_query(void *conn, struct dbt_adapter *adapter) {
+	/* Recorded result already carries the cancellation */
+	return 0;
+}
+
+
+
+
+int dbt_trace_start(const char *record_path, const char *replay_path, int fast) {
+	/* Check input (neither path leaves tracing off) */
+	if (record_path && replay_path) return 1;
+	clock_gettime(CLOCK_MONOTONIC, &trace_state.started);
+	trace_state.fast = fast;
+
+
+	/* Start new trace file */
+	if (record_path) {
+		trace_state.out = fopen(record_path, "wb");
+		if (!trace_state.out || fwrite(DBT_TRACE_MAGIC, 1, DBT_TRACE_MAGIC_LEN, trace_state.out) != DBT_TRACE_MAGIC_LEN) return 1;
+		trace_state.recording = 1;
+
+		return 0;
+	} else if (!replay_path) return 0;
+
+
+	/* Map trace to replay, reject foreign files */
+	int fd = open(replay_path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) || st.st_size < DBT_TRACE_MAGIC_LEN) {
+		if (fd >= 0) close(fd);
+		return 1;
+	}
+
+	void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) return 1;
+	trace_state.map = map;
+	trace_state.map_size = st.st_size;
+	if (memcmp(map, DBT_TRACE_MAGIC, DBT_TRACE_MAGIC_LEN)) return 1;
+
+
+	/* Index records (a torn trailing record is ignored) */
+	size_t offset = DBT_TRACE_MAGIC_LEN, cap = 0;
+	while (offset + sizeof(struct dbt_trace_record) <= trace_state.map_size) {
+		struct dbt_trace_record record;
+		memcpy(&record, (const char *)map + offset, sizeof(record));
+		if (record.length < sizeof(record) || offset + record.length > trace_state.map_size || record.kind >= DBT_TRACE_KINDS) break;
+
+		if (trace_state.count == cap) {
+			cap = cap ? cap * 2 : 1024;
+			size_t *offsets = (size_t *)realloc(trace_state.offsets, cap * sizeof(size_t));
+			if (!offsets) return 1;
+			trace_state.offsets = offsets;
+		}
+		trace_state.offsets[trace_state.count++] = offset;
+		offset += record.length;
+	}
+
+	trace_state.used = (uint8_t *)calloc(trace_state.count + 1, sizeof(uint8_t));
+	if (!trace_state.used) return 1;
+
+
+	/* Group records by kind (counting sort keeps file order) and by kind plus connection, so lookups never rescan consumed records */
+	trace_state.by_kind = (size_t *)malloc((trace_state.count + 1) * sizeof(size_t));
+	trace_state.by_conn = (size_t *)malloc((trace_state.count + 1) * sizeof(size_t));
+	trace_state.conn_cursors = (size_t *)malloc((trace_state.count + 1) * sizeof(size_t));
+	if (!trace_state.by_kind || !trace_state.by_conn || !trace_state.conn_cursors) return 1;
+
+	struct dbt_trace_record record;
+	for (size_t i=0; i < trace_state.count; i++) {
+		trace_record_at(i, &record);
+		trace_state.kind_end[record.kind]++;
+	}
+	for (size_t k=1; k < DBT_TRACE_KINDS; k++) trace_state.kind_end[k] += trace_state.kind_end[k-1];
+	for (size_t k=0; k < DBT_TRACE_KINDS; k++) trace_state.cursors[k] = k ? trace_state.kind_end[k-1] : 0;
+
+	size_t fill[DBT_TRACE_KINDS];
+	memcpy(fill, trace_state.cursors, sizeof(fill));
+	for (size_t i=0; i < trace_state.count; i++) {
+		trace_record_at(i, &record);
+		trace_state.by_kind[fill[record.kind]++] = i;
+		trace_state.by_conn[i] = i;
+		trace_state.conn_cursors[i] = i;
+	}
+	qsort(trace_state.by_conn, trace_state.count, sizeof(size_t), trace_compare_conn);
+	trace_state.replaying = 1;
+
+
+	return 0;
+}
+
+
+int dbt_trace_replaying(void) {
+	return trace_state.replaying;
+}
+
+
+void dbt_trace_wrap(struct dbt_adapter *adapter) {
+	/* Check input */
+	if (!trace_state.recording || !adapter || adapter->traced) return;
+
+
+	/* Keep backend functions once per backend */
+	size_t ind = 0;
+	while (ind < trace_state.backend_count && trace_state.backends[ind].load_database_list != adapter->load_database_list) ind++;
+	if (ind == trace_state.backend_count) {
+		if (trace_state.backend_count == DBT_TRACE_MAX_BACKENDS) return;
+		trace_state.backends[trace_state.backend_count++] = *adapter;
+	}
+	adapter->traced = &trace_state.backends[ind];
+
+
+	/* Route traced calls through the recorder */
+	if (adapter->load_database_list) adapter->load_database_list = record_load_database_list;
+	if (adapter->connect_to_db) adapter->connect_to_db = record_connect_to_db;
+	if (adapter->load_schema_list) adapter->load_schema_list = record_load_schema_list;
+	if (adapter->load_table_list) adapter->load_table_list = record_load_table_list;
+	if (adapter->load_column_list) adapter->load_column_list = record_load_column_list;
+	if (adapter->perform_query) adapter->perform_query = record_perform_query;
+	if (adapter->load_table_properties) adapter->load_table_properties = record_load_table_properties;
+	if (adapter->open_connection) adapter->open_connection = record_open_connection;
+	if (adapter->close_connection) adapter->close_connection = record_close_connection;
+	if (adapter->send_query) adapter->send_query = record_send_query;
+	if (adapter->poll_query) adapter->poll_query = record_poll_query;
+	if (adapter->fetch_more) adapter->fetch_more = record_fetch_more;
+
+
+	/* Features replay cannot serve stay off while recording (keeps connection ids in step with replay) */
+	adapter->start_connection = 0;
+	adapter->poll_connection = 0;
+	adapter->check_connection = 0;
+	adapter->install_change_feed = 0;
+	adapter->open_change_feed = 0;
+	adapter->plan_export = 0;
+	adapter->start_import = 0;
+	adapter->pipeline_send = 0;
+}
+
+
+int dbt_trace_replay_init(json_t *server_info, struct dbt_adapter *adapter) {
+	/* Check input */
+	if (!server_info || !adapter) return 1;
+
+
+	/* Same policy as the recorded backend, answers come from the trace */
+	memset(adapter, 0, sizeof(*adapter));
+	adapter->row_limit = json_integer_value(json_object_get(server_info, "row_limit"));
+	adapter->load_database_list = replay_load_database_list;
+	adapter->connect_to_db = replay_connect_to_db;
+	adapter->load_schema_list = replay_load_schema_list;
+	adapter->load_table_list = replay_load_table_list;
+	adapter->load_column_list = replay_load_column_list;
+	adapter->perform_query = replay_perform_query;
+	adapter->load_table_properties = replay_load_table_properties;
+	adapter->open_connection = replay_open_connection;
+	adapter->close_connection = replay_close_connection;
+	adapter->connection_fd = replay_connection_fd;
+	adapter->send_query = replay_send_query;
+	adapter->poll_query = replay_poll_query;
+	adapter->fetch_more = replay_fetch_more;
+	adapter->cancel_query = replay_cancel_query;
+
+
+	return 0;
+}
+
+
+void dbt_trace_key(int input) {
+	/* Keys are recorded with their time only */
+	if (trace_state.recording) trace_write(DBT_TRACE_KEY, 0, input, 0, "", 0, 0);
+}
+
+
+int dbt_trace_next_key(int *input, int *wait_ms) {
+	/* Check input (-1 once the trace has no more keys) */
+	if (!input || !wait_ms || !trace_state.replaying) return -1;
+
+	if (trace_state.cursors[DBT_TRACE_KEY] == trace_state.kind_end[DBT_TRACE_KEY]) return -1;
+	size_t ind = trace_state.by_kind[trace_state.cursors[DBT_TRACE_KEY]];
+	struct dbt_trace_record record;
+	trace_record_at(ind, &record);
+
+
+	/* Results that arrived before the key was pressed must have arrived again */
+	*wait_ms = 250;
+	for (size_t i=0; i < trace_state.live_count; i++) {
+		if (trace_state.live[i]->pending != DBT_TRACE_NONE && trace_state.live[i]->pending < ind) return 1;
+	}
+
+
+	/* Keep recorded pace unless fast */
+	uint64_t now_us = trace_elapsed_us(&trace_state.started);
+	if (!trace_state.fast && now_us < record.time_us) {
+		*wait_ms = (int)((record.time_us - now_us + 999) / 1000);
+		return 1;
+	}
+
+	trace_state.used[ind] = 1;
+	trace_state.cursors[DBT_TRACE_KEY]++;
+	trace_state.keys++;
+	*input = record.status;
+	*wait_ms = 0;
+
+
+	return 0;
+}
+
+
+void dbt_trace_handled(const struct timespec *since) {
+	/* Check input */
+	if (!since || !trace_state.replaying) return;
+
+
+	/* Time spent handling one replayed key (render and materialization included) */
+	uint64_t handled_us = trace_elapsed_us(since);
+	trace_state.handled_us += handled_us;
+	if (handled_us > trace_state.handled_max_us) trace_state.handled_max_us = handled_us;
+}
+
+
+int dbt_trace_close(FILE *report) {
+	/* Finish recording */
+	if (trace_state.out) fclose(trace_state.out);
+	trace_state.out = 0;
+	if (!trace_state.replaying) {
+		memset(&trace_state, 0, sizeof(trace_state));
+		return 0;
+	}
+
+
+	/* Report replay cost and divergence (fails when calls did not match the trace) */
+	size_t unreplayed = 0;
+	for (size_t i=0; i < trace_state.count; i++) {
+		struct dbt_trace_record record;
+		trace_record_at(i, &record);
+		if (!trace_state.used[i] && record.kind != DBT_TRACE_KEY) unreplayed++;
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	double cpu_ms = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+	int diverged = trace_state.mismatches != 0;
+
+	if (report) {
+		fprintf(report, "replay: %zu keys, %zu calls, %zu mismatched, %zu recorded calls not replayed\n", trace_state.keys, trace_state.calls, trace_state.mismatches, unreplayed);
+		fprintf(report, "replay: %.1fms wall, %.1fms cpu, key handling %.1fms (max %.1fms)\n",
+			trace_elapsed_us(&trace_state.started) / 1000.0, cpu_ms, trace_state.handled_us / 1000.0, trace_state.handled_max_us / 1000.0);
+	}
+
+
+	/* Release mapping */
+	for (size_t i=0; i < trace_state.live_count; i++) {
+		close(trace_state.live[i]->timer_fd);
+		free(trace_state.live[i]);
+	}
+	munmap(trace_state.map, trace_state.map_size);
+	free(trace_state.offsets);
+	free(trace_state.used);
+	free(trace_state.by_kind);
+	free(trace_state.by_conn);
+	free(trace_state.conn_cursors);
+	memset(&trace_state, 0, sizeof(trace_state));
+
+
+	return diverged;
+}
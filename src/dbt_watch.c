@@ -0,0 +1,148 @@
+#include <string.h>
+
+#include "dbt.h"
+
+
+/* Definitions */
+#define DBT_WATCH_DEFAULT_INTERVAL_MS 5000
+#define DBT_WATCH_MAX_CHANGES 64
+
+
+/* Helper functions */
+static int64_t watch_elapsed_ms(const struct timespec *since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (now.tv_sec - since->tv_sec) * 1000ll + (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+
+
+
+int dbt_watch_start(const char *mode, struct dbt_session *session) {
+	/* Check input */
+	if (!mode || !session) return 1;
+	else if (!session->current_server || !session->current_database) return 1;
+	else if (!session->adapter_handle.open_change_feed) return 1;
+
+
+	/* Replace previous feed */
+	dbt_watch_stop(session);
+
+
+	/* Open feed on its own connection (watch keeps an adapter copy, like tabs) */
+	struct dbt_watch *watch = &session->watch;
+	watch->adapter = session->adapter_handle;
+	watch->adapter.conn_handle = 0;
+	watch->adapter.db_conn_handle = 0;
+	watch->feed = watch->adapter.open_change_feed(session->current_database, mode, &watch->adapter);
+	if (!watch->feed) return 1;
+
+	strncpy(watch->mode, mode, sizeof(watch->mode) - 1);
+
+
+	/* Poll interval (poll mode only, 'change_feed_interval' in seconds) */
+	json_t *interval = json_object_get(session->current_server, "change_feed_interval");
+	watch->interval_ms = json_is_number(interval) && json_number_value(interval) > 0 ? (int)(json_number_value(interval) * 1000) : DBT_WATCH_DEFAULT_INTERVAL_MS;
+
+
+	/* First poll round records the baseline snapshot once its answers arrive */
+	clock_gettime(CLOCK_MONOTONIC, &watch->last_poll);
+	if (watch->adapter.change_feed_fd(watch->feed, &watch->adapter) < 0) {
+		struct dbt_catalog_change changes[1];
+		watch->adapter.poll_change_feed(watch->feed, session->current_schema, changes, 0, &watch->adapter);
+	}
+
+
+	return 0;
+}
+
+
+void dbt_watch_stop(struct dbt_session *session) {
+	/* Check input */
+	if (!session) return;
+	struct dbt_watch *watch = &session->watch;
+
+
+	/* Close feed connection */
+	if (watch->feed) watch->adapter.close_change_feed(watch->feed, &watch->adapter);
+	memset(watch, 0, sizeof(*watch));
+}
+
+
+int dbt_watch_command(const char *input, struct dbt_session *session) {
+	/* Check input */
+	if (!input || !session) return 1;
+
+
+	/* 'off' stops, 'install' adds the DDL event triggers then listens, otherwise input is the mode */
+	if (!strcmp(input, "off")) {
+		dbt_watch_stop(session);
+		return 0;
+	} else if (!strcmp(input, "install")) {
+		if (!session->adapter_handle.install_change_feed || session->adapter_handle.install_change_feed(&session->adapter_handle)) return 1;
+		return dbt_watch_start("notify", session);
+	}
+
+
+	return dbt_watch_start(input, session);
+}
+
+
+size_t dbt_watch_collect_fds(struct pollfd *fds, size_t max, struct dbt_session *session) {
+	/* Check input */
+	if (!fds || !max || !session || !session->watch.feed) return 0;
+	struct dbt_watch *watch = &session->watch;
+
+
+	/* Notification socket (poll mode only while a round is in flight) */
+	int fd = watch->adapter.change_feed_fd(watch->feed, &watch->adapter);
+	if (fd < 0) return 0;
+
+	fds[0].fd = fd;
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+
+
+	return 1;
+}
+
+
+int dbt_watch_service(struct dbt_session *session) {
+	/* Check input */
+	if (!session || !session->watch.feed) return 0;
+	struct dbt_watch *watch = &session->watch;
+
+
+	/* Poll mode starts a fingerprint round once per interval, socket readiness completes it */
+	if (watch->adapter.change_feed_fd(watch->feed, &watch->adapter) < 0) {
+		if (watch_elapsed_ms(&watch->last_poll) < watch->interval_ms) return 0;
+		clock_gettime(CLOCK_MONOTONIC, &watch->last_poll);
+	}
+
+
+	/* Collect changes */
+	struct dbt_catalog_change changes[DBT_WATCH_MAX_CHANGES];
+	size_t change_count = watch->adapter.poll_change_feed(watch->feed, session->current_schema, changes, DBT_WATCH_MAX_CHANGES, &watch->adapter);
+	if (!change_count) return 0;
+
+
+	/* Patch only what is cached: schema list, current schema's tables and current table's columns */
+	int reload_schemas = 0, reload_columns = 0;
+	for (size_t i=0; i < change_count; i++) {
+		struct dbt_catalog_change *change = &changes[i];
+		if (!change->table[0]) {
+			reload_schemas = 1;
+			continue;
+		} else if (!session->current_schema || strcmp(change->schema, session->current_schema)) continue;
+
+		if (change->op == 'A' && session->current_table && !strcmp(change->table, session->current_table)) reload_columns = 1;
+		else dbt_tables_apply_change(change, session);
+	}
+
+	if (reload_schemas) dbt_schemas_refresh(session);
+	if (reload_columns && session->current_table) dbt_columns_refresh(session);
+
+
+	return 1;
+}
@@ -1,3 +1,4 @@
+#include <locale.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -14,13 +15,22 @@ static void app_exit(int reason) {
 
 /* Entry point */
 int main(int argc, const char **argv) {
-	/* Init ncurses */
+	/* Count json allocations by subsystem (must precede the first json value) */
+	dbt_memory_init();
+
+
+	/* Init ncurses (locale enables UTF-8 output) */
+	setlocale(LC_ALL, "");
 	initscr();
 	raw();
 	noecho();
 	refresh();
 
 
+	/* Record or replay a trace (DBT_RECORD / DBT_REPLAY paths, DBT_REPLAY_FAST replays without recorded delays) */
+	if (dbt_trace_start(getenv("DBT_RECORD"), getenv("DBT_REPLAY"), getenv("DBT_REPLAY_FAST") != 0)) app_exit(3);
+
+
 	/* Init session */
 	struct dbt_session session;
 	if (dbt_session_init(argc > 1 ? argv[1] : 0, &session)) app_exit(1);
@@ -30,10 +40,29 @@ int main(int argc, const char **argv) {
 	if (dbt_servers_refresh(&session)) app_exit(2);
 
 
+	/* Read keys unbuffered so poll() sees every pending byte */
+	setvbuf(stdin, 0, _IONBF, 0);
+
+
 	/* Start main loop */
 	for (;;) {
-		/* Get input */
-		int input = getchar();
+		/* Replayed keys wait until results that preceded them arrived again (typed keys are dropped) */
+		int input;
+		if (dbt_trace_replaying()) {
+			int wait_ms;
+			int next = dbt_trace_next_key(&input, &wait_ms);
+			if (next < 0) break;
+			else if (dbt_session_poll(wait_ms, &session)) getchar();
+			if (next) continue;
+		} else {
+			/* Wait for input while servicing background queries */
+			if (!dbt_session_poll(250, &session)) continue;
+
+
+			/* Get input */
+			input = getchar();
+			dbt_trace_key(input);
+		}
 
 
 		/* Handle quit or mode-quit */
@@ -60,13 +89,37 @@ int main(int argc, const char **argv) {
 		}
 
 
-		/* Handle input */
-		if (dbt_session_handle_input(input, &session)) break;
+		/* Handle input (timed for replay reports) */
+		struct timespec handle_started;
+		clock_gettime(CLOCK_MONOTONIC, &handle_started);
+		int quit = dbt_session_handle_input(input, &session);
+		dbt_trace_handled(&handle_started);
+		if (quit) break;
 	}
 
 
 	/* Cleanup */
-	if (session.config) json_decref(session.config);
+	dbt_watch_stop(&session);
+	dbt_dashboard_stop(&session);
+	dbt_export_stop(&session);
+	dbt_import_stop(&session);
+	dbt_profile_stop(&session);
+	dbt_properties_stop(&session);
+	dbt_tabs_close(&session);
+	dbt_plan_close(&session);
+	dbt_adapter_close(&session.adapter_handle);
+	dbt_adapter_unload();
+	dbt_history_close(&session);
+	dbt_catalog_names_free(&session.database_list);
+	dbt_catalog_names_free(&session.schema_list);
+	dbt_catalog_names_free(&session.table_list);
+	dbt_catalog_columns_free(&session.column_list);
+	dbt_complete_free(&session.complete);
+	dbt_strings_free(&session.strings);
+	dbt_config_close(&session.config);
 	endwin();
-	return 0;
+
+
+	/* Finish trace (replays report their cost and fail when calls diverged from the recording) */
+	return dbt_trace_close(stderr);
 }